@@ -26,10 +26,17 @@ int main(int argc, char **argv)
 	virg_table_addcolumn(v, 0, "normalf5", VIRG_FLOAT);
 	virg_table_addcolumn(v, 0, "normalf20", VIRG_FLOAT); 
 
-	int i;
-	void *buff = malloc(4 * 6);
+	int i, j;
+	int rows = atoi(argv[2]);
+	int batch = 65536;
+	int *keys = malloc(batch * sizeof(int));
+	void *buff = malloc(batch * 4 * 6);
 	int *buff_i = (int*)buff;
 	float *buff_f = (float*)buff;
+	const char *columns[6];
+
+	for(j = 0; j < 6; j++)
+		columns[j] = (char*)buff + j * batch * 4;
 
 	const gsl_rng_type *type;
 	gsl_rng *ran;
@@ -38,22 +45,27 @@ int main(int argc, char **argv)
 	ran = gsl_rng_alloc(type);
 	gsl_rng_set(ran, time(0));
 
-	for(i = 0; i < atoi(argv[2]); i++) {
-		buff_i[0] = (int)gsl_ran_flat(ran, -100, 100);
-		buff_i[1] = (int)gsl_ran_gaussian(ran, 5);
-		buff_i[2] = (int)gsl_ran_gaussian(ran, 20);
-		buff_f[3] = (float)gsl_ran_flat(ran, -100, 100);
-		buff_f[4] = (float)gsl_ran_gaussian(ran, 5);
-		buff_f[5] = (float)gsl_ran_gaussian(ran, 20);
-		virg_table_insert(v, 0, (char*)&i, buff, NULL);
+	// generate the rows a batch of columns at a time
+	for(i = 0; i < rows; i += batch) {
+		int n = rows - i < batch ? rows - i : batch;
 
-		if(i % 10000 == 0) {
-			printf("%i,", i);
-			fflush(stdout);
+		for(j = 0; j < n; j++) {
+			keys[j] = i + j;
+			buff_i[j] = (int)gsl_ran_flat(ran, -100, 100);
+			buff_i[batch + j] = (int)gsl_ran_gaussian(ran, 5);
+			buff_i[batch * 2 + j] = (int)gsl_ran_gaussian(ran, 20);
+			buff_f[batch * 3 + j] = (float)gsl_ran_flat(ran, -100, 100);
+			buff_f[batch * 4 + j] = (float)gsl_ran_gaussian(ran, 5);
+			buff_f[batch * 5 + j] = (float)gsl_ran_gaussian(ran, 20);
 		}
+		virg_table_append_batch(v, 0, (char*)keys, columns, n);
+
+		printf("%i,", i);
+		fflush(stdout);
 	}
 	printf("\n");
 
+	free(keys);
 	free(buff);
 
 	virg_db_close(v);
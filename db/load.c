@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <virginian.h>
+
+int main(int argc, char **argv)
+{
+	if(argc < 4 || argc > 6) {
+		fprintf(stderr, "%s <database name> <table> <file> [csv|binary] "
+			"[threads]\n", argv[0]);
+		exit(1);
+	}
+
+	virginian virg;
+	virginian *v = &virg;
+	virg_format format = VIRG_CSV;
+	unsigned threads = 0;
+	unsigned table_id, rows;
+	struct timeval start, end;
+
+	if(argc > 4 && strcmp(argv[4], "binary") == 0)
+		format = VIRG_BINARY;
+	if(argc > 5)
+		threads = atoi(argv[5]);
+
+	virg_init(v);
+	if(virg_db_open(v, argv[1]) == VIRG_FAIL ||
+		virg_table_getid(v, argv[2], &table_id) == VIRG_FAIL) {
+		virg_close(v);
+		exit(1);
+	}
+
+	gettimeofday(&start, NULL);
+	int r = virg_table_load(v, table_id, argv[3], format, threads, &rows);
+	gettimeofday(&end, NULL);
+
+	if(r == VIRG_SUCCESS)
+		printf("%u rows in %f seconds\n", rows, (end.tv_sec - start.tv_sec) +
+			(end.tv_usec - start.tv_usec) / 1000000.0);
+
+	virg_db_close(v);
+	virg_close(v);
+
+	return r == VIRG_SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+#include "virginian.h"
+
+/**
+ * @ingroup appender
+ * @brief Publish the rows appended with an appender to queries
+ *
+ * Rows appended with virg_appender_row() are only copied into the appender's
+ * tablet. This makes them visible to queries by updating the tablet's row
+ * count and zone map, and marks the tablet dirty so that they are written to
+ * disk. It is called whenever the appender moves to the next tablet and when
+ * it is closed, and can be called in between to publish rows sooner.
+ *
+ * @param v     Pointer to the state struct of the database system
+ * @param a     Pointer to the appender state
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_appender_flush(virginian *v, virg_appender *a)
+{
+	virg_tablet_meta *tab = a->tab;
+
+	if(tab == NULL || a->rows == tab->rows)
+		return VIRG_SUCCESS;
+
+	// the rows must be written before queries see them
+	unsigned first = tab->rows;
+	__sync_synchronize();
+	tab->rows = a->rows;
+	virg_tablet_zones(tab, first);
+	VIRG_CHECK(virg_tablet_dirty(v, tab) == VIRG_FAIL,
+		"Could not mark tablet dirty")
+
+	return VIRG_SUCCESS;
+}
+
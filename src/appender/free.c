@@ -0,0 +1,31 @@
+#include "virginian.h"
+
+/**
+ * @ingroup appender
+ * @brief Close an append session
+ *
+ * Publishes the rows appended to the appender's tablet to queries with
+ * virg_appender_flush(), unlocks the tablet and gives up the append lane. This
+ * must be called before virg_db_close().
+ *
+ * @param v     Pointer to the state struct of the database system
+ * @param a     Pointer to the appender state
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_appender_free(virginian *v, virg_appender *a)
+{
+	int r = VIRG_SUCCESS;
+
+	if(a->tab != NULL) {
+		r = virg_appender_flush(v, a);
+		virg_tablet_unlock(v, a->tab->id);
+		a->tab = NULL;
+	}
+
+	v->append_session[a->table_id][a->lane] = 0;
+	pthread_mutex_unlock(&v->append_lane_lock[a->table_id][a->lane]);
+
+	return r;
+}
+
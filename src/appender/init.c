@@ -0,0 +1,49 @@
+#include "virginian.h"
+
+/**
+ * @ingroup appender
+ * @brief Open an append session on a table
+ *
+ * Each row inserted with virg_table_insert() locks the calling thread's
+ * append lane and looks up and locks the tablet it fills. An appender does
+ * this once, keeping its tablet locked and pointers to where the next row's
+ * key and fixed-size column values go, so that virg_appender_row() only copies
+ * values until the tablet is full and virg_appender_next() moves on to the
+ * next one. The appender holds the calling thread's append lane of the table
+ * until it is closed with virg_appender_free(), so threads sharing the lane
+ * wait for it before inserting into the table, and must only be used by the
+ * thread that opened it. The thread may insert into other tables and open
+ * appenders on them meanwhile, but inserting into the same table or opening a
+ * second appender on it fails, see virg_table_lanelock(). The rows appended
+ * are published to queries each time the appender moves to a new tablet and
+ * when it is closed, see virg_appender_flush().
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param a			Pointer to the appender state
+ * @param table_id	ID of the table that rows are appended to
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_appender_init(virginian *v, virg_appender *a, unsigned table_id)
+{
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+
+	a->table_id = table_id;
+	a->lane = virg_table_lane(v);
+	a->tab = NULL;
+
+	VIRG_CHECK(virg_table_lanelock(v, table_id, a->lane) == VIRG_FAIL,
+		"Could not open appender")
+	if(virg_appender_next(v, a) == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->append_lane_lock[table_id][a->lane]);
+		VIRG_CHECK(1, "Could not open appender")
+	}
+
+	// so that the thread can't wait for its own lock
+	v->append_owner[table_id][a->lane] = pthread_self();
+	v->append_session[table_id][a->lane] = 1;
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,46 @@
+#include "virginian.h"
+
+/**
+ * @ingroup appender
+ * @brief Publish the rows of an appender and move it to the next tablet
+ *
+ * Makes the rows appended to the appender's tablet visible to queries with
+ * virg_appender_flush(), then unlocks it and moves the appender to the next
+ * tablet of its append lane with virg_table_tail(), which is the only time an
+ * appender goes to the tablet slots. This is called by virg_appender_row()
+ * when the tablet is full, and with no tablet by virg_appender_init().
+ *
+ * @param v     Pointer to the state struct of the database system
+ * @param a     Pointer to the appender state
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_appender_next(virginian *v, virg_appender *a)
+{
+	virg_tablet_meta *tab = a->tab;
+	unsigned i;
+
+	if(tab != NULL) {
+		virg_appender_flush(v, a);
+		virg_tablet_unlock(v, tab->id);
+		a->tab = NULL;
+	}
+
+	VIRG_CHECK(virg_table_tail(v, a->table_id, a->lane, &tab) == VIRG_FAIL,
+		"Could not find tablet to append to")
+
+	a->tab = tab;
+	a->rows = tab->rows;
+	a->possible_rows = tab->possible_rows;
+	a->columns = tab->fixed_columns;
+	a->key_stride = tab->key_stride;
+	a->key = (char*)tab + tab->key_block + tab->rows * tab->key_stride;
+	for(i = 0; i < tab->fixed_columns; i++) {
+		a->fixed_stride[i] = tab->fixed_stride[i];
+		a->fixed[i] = (char*)tab + tab->fixed_block + tab->fixed_offset[i] +
+			tab->rows * tab->fixed_stride[i];
+	}
+
+	return VIRG_SUCCESS;
+}
+
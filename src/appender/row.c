@@ -0,0 +1,42 @@
+#include "virginian.h"
+
+/**
+ * @ingroup appender
+ * @brief Append a row with an appender
+ *
+ * Copies a row to the end of the appender's tablet, moving on to the next
+ * tablet with virg_appender_next() if it is full. The key and data buffers are
+ * laid out as for virg_table_insert(), with the data buffer holding the values
+ * of each of the fixed-size columns in order. The row isn't seen by queries
+ * until the appender moves to the next tablet or is closed.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param a		Pointer to the appender state
+ * @param key	Buffer containing the key value of the row
+ * @param data	Buffer containing the row data
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_appender_row(virginian *v, virg_appender *a, const char *key,
+	const char *data)
+{
+	unsigned i;
+
+	if(a->rows == a->possible_rows)
+		VIRG_CHECK(virg_appender_next(v, a) == VIRG_FAIL,
+			"Could not append row")
+
+	memcpy(a->key, key, a->key_stride);
+	a->key += a->key_stride;
+
+	for(i = 0; i < a->columns; i++) {
+		memcpy(a->fixed[i], data, a->fixed_stride[i]);
+		a->fixed[i] += a->fixed_stride[i];
+		data += a->fixed_stride[i];
+	}
+
+	a->rows++;
+
+	return VIRG_SUCCESS;
+}
+
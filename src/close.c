@@ -14,26 +14,30 @@
  */
 int virg_close(virginian *v)
 {
-	int i;
-	cudaError_t r;
+	unsigned i, j;
 
 	virg_db_close(v);
 
-	// free each tablet slot, use cuda free depending on if its pinned
-	for(i = 0; i < VIRG_MEM_TABLETS; i++) {
-#ifndef VIRG_NOPINNED
-		r = cudaFreeHost(v->tablet_slots[i]);
-		VIRG_CHECK(r != cudaSuccess, "Problem freeing slot")
-#else
-		free(v->tablet_slots[i]);
-#endif
-	}
+	// free the tablet slots
+	VIRG_CHECK(virg_db_slots(v, 0) == VIRG_FAIL, "Problem freeing slots")
 
-	// free gpu slots
-	r = cudaFree(v->gpu_slots);
-	VIRG_CHECK(r != cudaSuccess, "Problem freeing slot")
+	virg_io_free(&v->io);
+
+	virg_index_free(&v->slot_index);
+	virg_index_free(&v->ghost_index);
+	virg_index_free(&v->prefetch_next);
 
 	VIRG_CHECK(pthread_mutex_destroy(&v->slot_lock), "Could not destroy mutex")
+	VIRG_CHECK(pthread_cond_destroy(&v->slot_cond), "Could not destroy cond")
+	VIRG_CHECK(pthread_mutex_destroy(&v->append_lock), "Could not destroy mutex")
+	for(i = 0; i < VIRG_MAX_TABLES; i++)
+		for(j = 0; j < VIRG_APPEND_LANES; j++)
+			VIRG_CHECK(pthread_mutex_destroy(&v->append_lane_lock[i][j]),
+				"Could not destroy mutex")
+	VIRG_CHECK(pthread_mutex_destroy(&v->prefetch_lock),
+		"Could not destroy mutex")
+	VIRG_CHECK(pthread_cond_destroy(&v->prefetch_cond),
+		"Could not destroy cond")
 
 	return VIRG_SUCCESS;
 }
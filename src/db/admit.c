@@ -0,0 +1,31 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Set the replacement policy state of a newly filled tablet slot
+ *
+ * Called whenever a tablet is placed in a tablet slot, either by loading it
+ * from disk or by allocating a new one, after its id has been set. The slot's
+ * reference bit is cleared and it is stamped with its arrival order. Under 2Q,
+ * a tablet that was recently evicted from the probationary queue has been
+ * reused and goes straight into the main queue, while any other tablet starts
+ * on probation. The queue is tracked regardless of the policy so that
+ * virginian.slot_policy can be changed at any time. The tablet slot mutex must
+ * be held while calling this.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param slot The tablet slot that has been filled
+ */
+void virg_db_admit(virginian *v, unsigned slot)
+{
+	unsigned id = v->tablet_slot_ids[slot];
+
+	v->tablet_slot_ref[slot] = 0;
+	v->tablet_slot_age[slot] = v->tablet_age_counter++;
+
+	if(virg_index_remove(&v->ghost_index, id) == VIRG_SUCCESS)
+		v->tablet_slot_queue[slot] = 1;
+	else
+		v->tablet_slot_queue[slot] = 0;
+}
+
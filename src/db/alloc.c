@@ -7,7 +7,9 @@
  * Find a free main-memory tablet slot using the virg_db_findslot() function,
  * assign the passed ID to this tablet slot, and return a pointer to the slot
  * through the 2nd argument. This function is called whenever a data or
- * result tablet needs to be placed in memory.
+ * result tablet needs to be placed in memory. Result tablets, whose ids have
+ * VIRG_RESULT_ID set, are given a slot in the result arena with
+ * virg_db_resultslot() instead.
  *
  * @param v Pointer to the state struct of the database system
  * @param meta Pointer to a pointer to a tablet, set during allocation
@@ -15,7 +17,7 @@
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
  * call
  */
-int virg_db_alloc(virginian *v, virg_tablet_meta **meta, int id)
+int virg_db_alloc(virginian *v, virg_tablet_meta **meta, unsigned id)
 {
 	// lock tablet slots
 	pthread_mutex_lock(&v->slot_lock);
@@ -23,12 +25,31 @@ int virg_db_alloc(virginian *v, virg_tablet_meta **meta, int id)
 	unsigned slot;
 
 	// locate empty tablet slot
-	virg_db_findslot(v, &slot);
+	int r = VIRG_IS_RESULT(id) ? virg_db_resultslot(v, &slot) :
+		virg_db_findslot(v, &slot);
+	if(r == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Could not find tablet slot")
+	}
+
+	// new tablets are always built in the slot's own memory, even if the
+	// previous occupant was accessed in place in the file mapping
+	v->tablet_slots[slot] = v->tablet_slot_alloc[slot];
 
 	// set id of this tablet slot, and return a ptr to it
 	meta[0] = v->tablet_slots[slot];
 	v->tablet_slot_ids[slot] = id;
+	virg_index_insert(&v->slot_index, id, slot);
 	meta[0]->id = id;
+	meta[0]->info = NULL;
+	v->tablet_slot_dirty[slot] = 1;
+	v->tablet_slot_cols[slot] = VIRG_ALL_COLUMNS;
+	if(slot < VIRG_MEM_TABLETS)
+		virg_db_admit(v, slot);
+
+	// release the claim on the slot, leaving the new tablet with one lock
+	__sync_synchronize();
+	v->tablet_slot_status[slot] = 2;
 
 	// unloc
 	pthread_mutex_unlock(&v->slot_lock);
@@ -0,0 +1,87 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Write the Bloom filters of the tablet in a tablet slot to disk
+ *
+ * Table scans with equality conditions, such as point lookups on the key, use
+ * Bloom filters to skip the tablets that can't contain the values they look for
+ * without reading them from disk, see virg_db_bloomtest(). The filters are kept
+ * in a file next to the database file, opened with virg_db_bloomopen(), which
+ * has a VIRG_BLOOM_REGION area for each disk slot. A region starts with a
+ * header block holding the id of the tablet that its filters were built from
+ * and the set of filters stored, followed by a filter for the key and one for
+ * each fixed-size column. Every table tablet gets a filter for its key and for
+ * each of the columns in its table's virg_db.bloom_columns. The filters are
+ * rebuilt from every row whenever a tablet is written to its disk slot, and the
+ * header is cleared while they are being written so that the filters of one
+ * tablet are never used for another.
+ *
+ * @param v	Pointer to the state struct of the database system
+ * @param slot	Tablet slot of a tablet that has been given a disk slot
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_bloom(virginian *v, unsigned slot)
+{
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	unsigned header[2];
+	unsigned f, row, k;
+
+	if(v->bloomfd == -1 || !tab->in_table)
+		return VIRG_SUCCESS;
+
+	off_t region = (off_t)tab->info->disk_slot * VIRG_BLOOM_REGION;
+
+	// the key always has a filter
+	unsigned filters = (1u << VIRG_BLOOM_KEY) |
+		(v->db.bloom_columns[tab->table_id] & ((1u << tab->fixed_columns) - 1));
+
+	// forget the filters of the tablet previously in the disk slot
+	header[0] = VIRG_INDEX_EMPTY;
+	header[1] = 0;
+	VIRG_CHECK(pwrite(v->bloomfd, header, sizeof(header), region) <
+		(ssize_t)sizeof(header), "Failed to write Bloom filter")
+
+	unsigned char *bits = (unsigned char*)malloc(VIRG_BLOOM_SIZE);
+	VIRG_CHECK(bits == NULL, "Out of memory")
+
+	for(f = 0; f <= VIRG_BLOOM_KEY; f++) {
+		if(!((filters >> f) & 1))
+			continue;
+
+		virg_t type = f == VIRG_BLOOM_KEY ? tab->key_type : tab->fixed_type[f];
+		size_t stride = f == VIRG_BLOOM_KEY ? tab->key_stride :
+			tab->fixed_stride[f];
+		char *col = (char*)tab + (f == VIRG_BLOOM_KEY ? tab->key_block :
+			tab->fixed_block + tab->fixed_offset[f]);
+
+		// set the bits chosen by double hashing for each row
+		memset(bits, 0, VIRG_BLOOM_SIZE);
+		for(row = 0; row < tab->rows; row++) {
+			unsigned long long h = virg_bloom_hash(type, col + stride * row);
+			unsigned h1 = (unsigned)h, h2 = (unsigned)(h >> 32) | 1;
+			for(k = 0; k < VIRG_BLOOM_HASHES; k++) {
+				unsigned bit = (h1 + k * h2) & ((1u << VIRG_BLOOM_BITS) - 1);
+				bits[bit >> 3] |= 1 << (bit & 7);
+			}
+		}
+
+		if(pwrite(v->bloomfd, bits, VIRG_BLOOM_SIZE,
+			region + (off_t)(f + 1) * VIRG_BLOOM_SIZE) < VIRG_BLOOM_SIZE) {
+			free(bits);
+			VIRG_CHECK(1, "Failed to write Bloom filter")
+		}
+	}
+
+	free(bits);
+
+	// now that the filters are complete, note whose they are
+	header[0] = tab->id;
+	header[1] = filters;
+	VIRG_CHECK(pwrite(v->bloomfd, header, sizeof(header), region) <
+		(ssize_t)sizeof(header), "Failed to write Bloom filter")
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,33 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Open the Bloom filter file of a database
+ *
+ * The Bloom filters written by virg_db_bloom() are kept in a file named after
+ * the database file with a .bloom suffix, which is created if it doesn't
+ * exist, so that databases without one can still be opened.
+ *
+ * @param v	Pointer to the state struct of the database system
+ * @param file	Path of the database file
+ * @param flags	Flags passed to open() along with O_RDWR and O_CREAT, such as
+ * O_TRUNC to discard the filters of a previous database
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_bloomopen(virginian *v, const char *file, int flags)
+{
+	size_t n = strlen(file);
+	char *path = (char*)malloc(n + sizeof(".bloom"));
+	VIRG_CHECK(path == NULL, "Out of memory")
+
+	memcpy(path, file, n);
+	memcpy(path + n, ".bloom", sizeof(".bloom"));
+
+	v->bloomfd = open(path, O_RDWR | O_CREAT | flags, S_IRUSR | S_IWUSR);
+	free(path);
+	VIRG_CHECK(v->bloomfd == -1, "Problem opening Bloom filter file")
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,56 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Test whether a tablet on disk may contain a value
+ *
+ * Reads the bits of a tablet's Bloom filter written by virg_db_bloom() that
+ * stand for a value, without reading the tablet itself. Since the filters are
+ * only rewritten when a tablet is written, the tablet must not be in memory
+ * with changes that haven't been written. A value that the filter doesn't
+ * contain is certainly not in the column, but one that it does contain may not
+ * be. If the disk slot has no filter for the tablet and column, for instance
+ * because the column was given a filter with virg_table_bloom() after the
+ * tablet was written, the value is assumed to be there.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param tablet_id	ID of the tablet
+ * @param disk_slot	Disk slot of the tablet
+ * @param filter	Column number, or VIRG_BLOOM_KEY for the key
+ * @param type		Type of the column
+ * @param val		Value to look for
+ * @return VIRG_FAIL if the value certainly isn't in the column, otherwise
+ * VIRG_SUCCESS
+ */
+int virg_db_bloomtest(virginian *v, unsigned tablet_id, unsigned disk_slot,
+	unsigned filter, virg_t type, virg_var *val)
+{
+	unsigned header[2];
+	unsigned char byte;
+	unsigned k;
+
+	if(v->bloomfd == -1 || filter > VIRG_BLOOM_KEY)
+		return VIRG_SUCCESS;
+
+	off_t region = (off_t)disk_slot * VIRG_BLOOM_REGION;
+
+	if(pread(v->bloomfd, header, sizeof(header), region) <
+		(ssize_t)sizeof(header) || header[0] != tablet_id ||
+		!((header[1] >> filter) & 1))
+		return VIRG_SUCCESS;
+
+	region += (off_t)(filter + 1) * VIRG_BLOOM_SIZE;
+
+	unsigned long long h = virg_bloom_hash(type, val);
+	unsigned h1 = (unsigned)h, h2 = (unsigned)(h >> 32) | 1;
+	for(k = 0; k < VIRG_BLOOM_HASHES; k++) {
+		unsigned bit = (h1 + k * h2) & ((1u << VIRG_BLOOM_BITS) - 1);
+		if(pread(v->bloomfd, &byte, 1, region + (bit >> 3)) < 1)
+			return VIRG_SUCCESS;
+		if(!(byte & (1 << (bit & 7))))
+			return VIRG_FAIL;
+	}
+
+	return VIRG_SUCCESS;
+}
+
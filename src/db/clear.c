@@ -23,13 +23,16 @@ int virg_db_clear(virginian *v, unsigned slot)
 	if(v->tablet_slot_status[slot] == 0)
 		return VIRG_SUCCESS;
 
-	// check to make sure that the tablet isn't locked
-	VIRG_CHECK(v->tablet_slot_status[slot] > 1, "Trying to clear a locked slot")
+	// check to make sure that the tablet isn't locked, and claim it so that
+	// it can't be locked while it is written
+	VIRG_CHECK(!VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], 1,
+		VIRG_SLOT_CLAIMED), "Trying to clear a locked slot")
 
 	// write the contents of the tablet to disk
 	virg_db_write(v, slot);
 
 	// Note that the tablet slot is now empty
+	virg_index_remove(&v->slot_index, v->tablet_slot_ids[slot]);
 	v->tablet_slot_status[slot] = 0;
 	v->tablet_slots_taken--;
 
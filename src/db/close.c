@@ -5,13 +5,16 @@
  * @brief Close the currently opened database
  *
  * Close the open database. This is accomplished by clearing every single
- * main-memory tablet slot, thus ensuring the changes to every tablet are
- * reflected on disk, then writing the fixed-size virg_db struct stored in the
- * virginian state struct to the head of the database file, then writing the
- * variable-sized meta information between this fixed-size area and the start of
- * the actual tablets. The variable-size meta information is a list of all the
- * tablets in the file. This function should be called only if no tablets are
- * locked in memory.
+ * main-memory tablet slot with virg_db_flush(), thus ensuring the changes to
+ * every tablet are reflected on disk, then writing the fixed-size virg_db struct
+ * stored in the virginian state struct to the head of the database file, then
+ * writing the variable-sized meta information to the head of each extent of
+ * disk slots, see virg_db. The variable-size meta information is a list of all
+ * the tablets in the file. Result tablets left in the result arena are dropped
+ * along with the spill file, see virg_db_spill(). The prefetch thread is
+ * stopped first. This function should be called only if no tablets are locked
+ * in memory. If the tablets can't all be written, such as when one is still
+ * locked, the database is left open and VIRG_FAIL is returned.
  *
  * @param v Pointer to the state struct of the database system
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
@@ -25,32 +28,67 @@ int virg_db_close(virginian *v) {
 	if(v->dbfd == -1)
 		return VIRG_SUCCESS;
 
-	// set size to the meta area of the file
-	size = sizeof(virg_db);
-	size += v->db.alloced_tablets * sizeof(virg_tablet_info);
+	// stop reading ahead, the prefetch thread may have tablets locked, and
+	// wait for any reads it started to complete
+	virg_db_prefetch_stop(v);
+	virg_io_drain(&v->io);
 
 	// clear every tablet slot, thus writing every in-memory tablet to disk
-	for(i = 0; i < VIRG_MEM_TABLETS; i++)
-		if(v->tablet_slot_status[i])
-			virg_db_clear(v, i);
+	VIRG_CHECK(virg_db_flush(v) == VIRG_FAIL, "Could not write tablets to disk")
+
+	// result tablets don't outlive the database, so empty the result arena
+	// and drop the spill file
+	for(i = VIRG_MEM_TABLETS; i < VIRG_TABLET_SLOTS; i++)
+		if(v->tablet_slot_status[i] == 1) {
+			virg_index_remove(&v->slot_index, v->tablet_slot_ids[i]);
+			v->tablet_slot_status[i] = 0;
+			v->tablet_slot_dirty[i] = 0;
+		}
+	close(v->spillfd);
+	v->spillfd = -1;
+	virg_index_free(&v->spill_index);
+	free(v->spill_free);
+	v->spill_free = NULL;
+	v->spill_free_count = 0;
+	v->spill_slots = 0;
+
+	// forget the tablets that rows were inserted into and evicted tablets,
+	// their ids mean nothing to the next database
+	memset(v->append_tablet, 0xFF, sizeof(v->append_tablet));
+	virg_index_clear(&v->ghost_index);
+	for(i = 0; i < VIRG_2Q_GHOSTS; i++)
+		v->ghost_ids[i] = VIRG_INDEX_EMPTY;
 
 	// write the fixed-size meta information in the virg_db struct to disk
 	r = pwrite(v->dbfd, &v->db, sizeof(virg_db), 0);
 	VIRG_CHECK(r < sizeof(virg_db), "Problem writing db meta info");
 
 	// write the variable-sized meta information (the tablet slot use and ids)
-	// to disk
-	size = v->db.alloced_tablets * sizeof(virg_tablet_info);
-	r = pwrite(v->dbfd, v->db.tablet_info, size, sizeof(virg_db));
-	VIRG_CHECK(r < size, "Problem writing db meta info");
+	// to the head of each extent
+	size = VIRG_EXTENT_TABLETS * sizeof(virg_tablet_info);
+	for(i = 0; i < v->db.alloced_tablets; i += VIRG_EXTENT_TABLETS) {
+		r = pwrite(v->dbfd, &v->db.tablet_info[i], size,
+			VIRG_EXTENT_OFFSET(&v->db, i));
+		VIRG_CHECK(r != size, "Problem writing db meta info");
+	}
+
+	// tablet slots no longer point into the file, so the mapping can go
+	virg_db_unmap(v);
 
 	// close the database file
 	r = close(v->dbfd);
 	VIRG_CHECK(r != 0, "Problem closing file");
 	v->dbfd = -1;
+	close(v->bloomfd);
+	v->bloomfd = -1;
 
-	// free the variable size meta information block
+	// free the variable size meta information block, its index and the stack
+	// of unused disk slots
 	free(v->db.tablet_info);
+	virg_index_free(&v->disk_index);
+	free(v->disk_free);
+	v->disk_free = NULL;
+	v->disk_free_count = 0;
 
 	return VIRG_SUCCESS;
 }
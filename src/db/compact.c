@@ -0,0 +1,331 @@
+#include "virginian.h"
+
+/**
+ * Claim a loaded tablet that we hold the only lock on, so that no other thread
+ * can lock it while it is changed, returning 0 if another thread holds it
+ */
+static int compact_claim(virginian *v, unsigned id, unsigned *slot)
+{
+	pthread_mutex_lock(&v->slot_lock);
+	int found = virg_index_find(&v->slot_index, id, slot);
+	pthread_mutex_unlock(&v->slot_lock);
+
+	return found && VIRG_ATOMIC_CAS(v->tablet_slot_status[slot[0]], 2,
+		VIRG_SLOT_CLAIMED);
+}
+
+/**
+ * Give up the claim on a tablet slot, keeping our lock on it and handing locks
+ * to the threads that waited for it, like the end of a read
+ */
+static void compact_release(virginian *v, unsigned slot)
+{
+	pthread_mutex_lock(&v->slot_lock);
+	v->tablet_slot_status[slot] = 2 + v->tablet_slot_waiters[slot];
+	v->tablet_slot_waiters[slot] = 0;
+	pthread_cond_broadcast(&v->slot_cond);
+	pthread_mutex_unlock(&v->slot_lock);
+}
+
+/**
+ * Keep queries from starting while tablets are joined, returning 0 if one is
+ * being executed, or let them start again
+ */
+static int compact_gate(virginian *v, int joining)
+{
+	pthread_mutex_lock(&v->slot_lock);
+	if(joining && v->scans > 0)
+		joining = 0;
+	else {
+		v->joining = joining;
+		pthread_cond_broadcast(&v->slot_cond);
+	}
+	pthread_mutex_unlock(&v->slot_lock);
+
+	return joining;
+}
+
+/**
+ * Move the rows of the claimed tablet b onto the end of the claimed tablet a,
+ * which comes before it in the same table, and remove b from the table and the
+ * database, returning 0 if the rows don't fit into a
+ */
+static int compact_join(virginian *v, virg_tablet_meta *a, unsigned a_slot,
+	virg_tablet_meta *b, unsigned b_slot)
+{
+	unsigned i;
+	unsigned rows = a->rows;
+
+	// grow the fixed-size columns of the first tablet if the rows don't fit,
+	// but only if that doesn't add a tablet to the table
+	if(rows + b->rows > a->possible_rows) {
+		unsigned need = (rows + b->rows - a->possible_rows - 1 + 16) &
+			0xFFFFFFF0;
+		unsigned max = ((v->db.tablet_size - a->size) / a->row_stride) &
+			0xFFFFFFF0;
+		if(need >= max)
+			return 0;
+		virg_tablet_addrows(v, a, need);
+	}
+
+	// copy the key and each of the fixed-size columns after the rows of a
+	memcpy((char*)a + a->key_block + rows * a->key_stride,
+		(char*)b + b->key_block, b->rows * b->key_stride);
+	for(i = 0; i < a->fixed_columns; i++)
+		memcpy((char*)a + a->fixed_block + a->fixed_offset[i] +
+			rows * a->fixed_stride[i],
+			(char*)b + b->fixed_block + b->fixed_offset[i],
+			b->rows * b->fixed_stride[i]);
+
+	a->rows += b->rows;
+	a->next = b->next;
+	virg_tablet_zones(a, rows);
+	virg_tablet_dirty(v, a);
+
+	if(v->db.table_tablets[a->table_id] > 0)
+		v->db.table_tablets[a->table_id]--;
+
+	// remove the second tablet like virg_tablet_remove() would, except that it
+	// is still claimed, so the threads waiting for it are failed like they are
+	// when a read fails, and the last of them empties the slot
+	pthread_mutex_lock(&v->slot_lock);
+	if(b->info != NULL) {
+		b->info->used = 0;
+		virg_index_remove(&v->disk_index, b->id);
+		v->disk_free[v->disk_free_count++] = b->info->disk_slot;
+	}
+	virg_index_remove(&v->slot_index, b->id);
+	v->tablet_slot_dirty[b_slot] = 0;
+	if(v->tablet_slot_waiters[b_slot] > 0) {
+		v->tablet_slot_ids[b_slot] = VIRG_INDEX_EMPTY;
+		pthread_cond_broadcast(&v->slot_cond);
+	}
+	else {
+		v->tablet_slot_status[b_slot] = 0;
+		v->tablet_slots_taken--;
+	}
+	pthread_mutex_unlock(&v->slot_lock);
+
+	compact_release(v, a_slot);
+
+	return 1;
+}
+
+/**
+ * Move a tablet that we hold to the lowest unused disk slot if that is before
+ * its own, so that tablets are packed into the head of the file in the order
+ * of their tables. The tablet is written to its new disk slot when it is
+ * evicted. A tablet used in place in the file mapping is copied into the
+ * memory of its slot first, which it must be ours alone for
+ */
+static void compact_move(virginian *v, virg_tablet_meta **tab, unsigned *to)
+{
+	virg_tablet_meta *t = tab[0];
+	unsigned slot, i;
+
+	if(t->info == NULL)
+		return;
+
+	pthread_mutex_lock(&v->slot_lock);
+	while(*to < v->db.alloced_tablets && v->db.tablet_info[*to].used)
+		(*to)++;
+	unsigned from = t->info->disk_slot;
+	virg_index_find(&v->slot_index, t->id, &slot);
+	pthread_mutex_unlock(&v->slot_lock);
+
+	if(*to >= from)
+		return;
+
+	if(t != v->tablet_slot_alloc[slot]) {
+		if(!compact_claim(v, t->id, &slot))
+			return;
+		memcpy(v->tablet_slot_alloc[slot], t, v->db.tablet_size);
+		t = tab[0] = v->tablet_slots[slot] = v->tablet_slot_alloc[slot];
+		compact_release(v, slot);
+	}
+
+	pthread_mutex_lock(&v->slot_lock);
+
+	// a tablet may have been placed in the disk slot since it was found
+	if(v->db.tablet_info[*to].used) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return;
+	}
+
+	// swap the disk slots on the stack of unused disk slots, leaving the
+	// tablet where it is if its new disk slot isn't on the stack
+	for(i = 0; i < v->disk_free_count && v->disk_free[i] != *to; i++);
+	if(i == v->disk_free_count) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return;
+	}
+	v->disk_free[i] = from;
+
+	v->db.tablet_info[*to].used = 1;
+	v->db.tablet_info[*to].id = t->id;
+	v->db.tablet_info[from].used = 0;
+	virg_index_remove(&v->disk_index, t->id);
+	virg_index_insert(&v->disk_index, t->id, *to);
+	t->info = &v->db.tablet_info[*to];
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	virg_tablet_dirty(v, t);
+}
+
+/**
+ * Join neighbouring tablets of a table whose rows fit into one tablet, never
+ * touching the last tablet or the one that rows are being inserted into
+ */
+static int compact_table(virginian *v, unsigned table_id)
+{
+	virg_tablet_meta *a, *b;
+	unsigned a_slot, b_slot;
+
+	VIRG_CHECK(virg_db_load(v, v->db.first_tablet[table_id], &a) == VIRG_FAIL,
+		"Could not load tablet")
+
+	while(!a->last_tablet) {
+		if(virg_db_load(v, a->next, &b) == VIRG_FAIL) {
+			virg_tablet_unlock(v, a->id);
+			VIRG_CHECK(1, "Could not load tablet")
+		}
+
+		// only join tablets whose rows could fit into one, and only while no
+		// query is scanning the tables
+		if(!b->last_tablet && b->id != v->db.write_cursor[table_id] &&
+			a->rows + b->rows <= (v->db.tablet_size - sizeof(virg_tablet_meta) -
+			VIRG_TABLET_INITIAL_FIXED) / a->row_stride &&
+			compact_gate(v, 1)) {
+			int joined = 0;
+			if(compact_claim(v, a->id, &a_slot)) {
+				if(compact_claim(v, b->id, &b_slot)) {
+					joined = compact_join(v, a, a_slot, b, b_slot);
+					if(!joined)
+						compact_release(v, b_slot);
+				}
+				if(!joined)
+					compact_release(v, a_slot);
+			}
+			compact_gate(v, 0);
+
+			// keep joining tablets onto the first one
+			if(joined)
+				continue;
+		}
+
+		virg_tablet_unlock(v, a->id);
+		a = b;
+	}
+
+	virg_tablet_unlock(v, a->id);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Move each tablet of a table to the lowest unused disk slot before its own
+ */
+static int compact_pack(virginian *v, unsigned table_id, unsigned *to)
+{
+	virg_tablet_meta *tab;
+
+	VIRG_CHECK(virg_db_load(v, v->db.first_tablet[table_id], &tab) ==
+		VIRG_FAIL, "Could not load tablet")
+
+	while(1) {
+		compact_move(v, &tab, to);
+		if(tab->last_tablet)
+			break;
+		VIRG_CHECK(virg_db_loadnext(v, &tab) == VIRG_FAIL,
+			"Could not load tablet")
+	}
+
+	virg_tablet_unlock(v, tab->id);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup database
+ * @brief Shrink the open database file to the tablets that it holds
+ *
+ * Tablets removed with virg_tablet_remove() and tables built by inserts with
+ * few rows per tablet leave the database file bigger than its data, which
+ * makes scans from disk read more than they need to. This walks each table,
+ * joining each pair of neighbouring tablets whose rows fit into one tablet and
+ * removing the second, then walks them again moving each tablet to the lowest
+ * unused disk slot before it, and truncates the file and its Bloom filter file
+ * after the last tablet left, dropping the extents that are no longer needed.
+ *
+ * Queries may run while the database is compacted. Tablets are only joined
+ * while no query is being executed, see virginian.joining, so queries never
+ * wait for more than one pair of tablets to be joined, and tablets are only
+ * changed or moved out of the file mapping while no other thread holds them,
+ * so those that are in use are left as they are. Rows must not be inserted
+ * while the database is compacted, and inserts afterwards start again from
+ * the write cursor of each table, see virg_table_tail().
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_compact(virginian *v)
+{
+	unsigned i;
+	unsigned to = 0;
+
+	// the tablets that append lanes were filling may be joined into others,
+	// so later inserts start again from the write cursors
+	pthread_mutex_lock(&v->append_lock);
+	memset(v->append_tablet, 0xFF, sizeof(v->append_tablet));
+	pthread_mutex_unlock(&v->append_lock);
+
+	for(i = 0; i < VIRG_MAX_TABLES; i++)
+		if(v->db.table_status[i])
+			VIRG_CHECK(compact_table(v, i) == VIRG_FAIL,
+				"Could not join tablets")
+
+	// once the tablets have been joined, the disk slots that they leave can
+	// be filled in the order of the tables
+	for(i = 0; i < VIRG_MAX_TABLES; i++)
+		if(v->db.table_status[i])
+			VIRG_CHECK(compact_pack(v, i, &to) == VIRG_FAIL,
+				"Could not move tablets")
+
+	pthread_mutex_lock(&v->slot_lock);
+
+	// drop the extents after the last used disk slot
+	for(i = v->db.alloced_tablets; i > 0; i--)
+		if(v->db.tablet_info[i - 1].used)
+			break;
+	unsigned alloced = VIRG_MAX((i + VIRG_EXTENT_TABLETS - 1) /
+		VIRG_EXTENT_TABLETS, 1) * VIRG_EXTENT_TABLETS;
+
+	// cut the file after the last tablet, tablets used in place in the file
+	// mapping may grow to the full tablet size
+	off_t size = i == 0 ? VIRG_DISK_OFFSET(&v->db, 0) :
+		VIRG_DISK_OFFSET(&v->db, i - 1) + (off_t)v->db.tablet_size;
+	struct stat st;
+	int r = VIRG_SUCCESS;
+	if(fstat(v->dbfd, &st) == 0 && st.st_size > size) {
+		if(ftruncate(v->dbfd, size) == 0)
+			v->dbmap_filesize = size;
+		else
+			r = VIRG_FAIL;
+	}
+	if(v->bloomfd != -1 && fstat(v->bloomfd, &st) == 0 &&
+		st.st_size > (off_t)(alloced * VIRG_BLOOM_REGION) &&
+		ftruncate(v->bloomfd, alloced * VIRG_BLOOM_REGION) != 0)
+		r = VIRG_FAIL;
+
+	v->db.alloced_tablets = alloced;
+	if(virg_db_freeslots(v) == VIRG_FAIL)
+		r = VIRG_FAIL;
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	VIRG_CHECK(r == VIRG_FAIL, "Problem truncating database file")
+
+	return VIRG_SUCCESS;
+}
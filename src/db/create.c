@@ -10,7 +10,10 @@
  * opened and has not yet been closed. Within the database struct we initialize
  * our listing of tables and tablets, showing that each is empty. Additionally,
  * we open the database file based on the the file argument, since we may need
- * to write to it before virg_db_close() is called.
+ * to write to it before virg_db_close() is called. The tablets of the database
+ * have the size in virginian.tablet_size, which is recorded in the database so
+ * that it is kept when the database is opened again, and the tablet slots are
+ * resized to match.
  *
  * @param v Pointer to the state struct of the database system
  * @param file Location on disk where the database file should be written
@@ -22,6 +25,16 @@ int virg_db_create(virginian *v, const char *file)
 	unsigned i;
 
 	virg_db *db = &v->db;
+
+	// tablet sizes are powers of two within the supported range
+	size_t tablet_size = v->tablet_size;
+	VIRG_CHECK(tablet_size < VIRG_TABLET_MIN_SIZE ||
+		tablet_size > VIRG_TABLET_MAX_SIZE ||
+		(tablet_size & (tablet_size - 1)) != 0, "Invalid tablet size")
+	VIRG_CHECK(virg_db_slots(v, tablet_size) == VIRG_FAIL,
+		"Could not allocate tablet slots")
+
+	db->tablet_size = tablet_size;
 	db->num_tablets = 0;
 	db->tablet_id_counter = 0;
 	v->dbfd = -1;
@@ -32,14 +45,14 @@ int virg_db_create(virginian *v, const char *file)
 		db->table_status[i] = 0;
 		db->table_tablets[i] = 0;
 		db->write_cursor[i] = 0;
+		db->bloom_columns[i] = 0;
 	}
 
-	// initialize tablet information
-	db->alloced_tablets = VIRG_TABLET_INFO_SIZE;
-	size_t size = VIRG_TABLET_INFO_SIZE * sizeof(virg_tablet_info);
+	// initialize tablet information for the first extent of the file
+	db->alloced_tablets = VIRG_EXTENT_TABLETS;
+	size_t size = VIRG_EXTENT_TABLETS * sizeof(virg_tablet_info);
 	db->tablet_info = malloc(size);
 	VIRG_CHECK(db->tablet_info == NULL, "Out of memory");
-	db->block_size = sizeof(virg_db) + size;
 
 #ifdef VIRG_DEBUG
 	// zero out malloced block for valgrind
@@ -47,13 +60,31 @@ int virg_db_create(virginian *v, const char *file)
 #endif
 
 	// make sure every tablet slot is noted as not being used
-	for(i = 0; i < db->alloced_tablets; i++)
+	for(i = 0; i < db->alloced_tablets; i++) {
 		db->tablet_info[i].used = 0;
+		db->tablet_info[i].disk_slot = i;
+	}
+
+	// the disk slot index starts out empty, with every disk slot unused
+	VIRG_CHECK(virg_index_init(&v->disk_index, VIRG_INDEX_INITIAL_SIZE) ==
+		VIRG_FAIL, "Could not init disk index")
+	VIRG_CHECK(virg_db_freeslots(v) == VIRG_FAIL, "Could not list disk slots")
 
 	// open database file on disk
 	v->dbfd = open(file, O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
 	VIRG_CHECK(v->dbfd < 0, "Problem creating file")
 
+	// start a Bloom filter file, discarding any left by an old database
+	VIRG_CHECK(virg_db_bloomopen(v, file, O_TRUNC) == VIRG_FAIL,
+		"Problem creating Bloom filter file")
+
+	// result tablets are spilled to a file of their own
+	VIRG_CHECK(virg_db_spillopen(v, file) == VIRG_FAIL,
+		"Problem opening spill file")
+
+	// map the file for in-place tablet access if enabled
+	virg_db_map(v);
+
 	return VIRG_SUCCESS;
 }
 
@@ -4,11 +4,18 @@
  * @ingroup database
  * @brief Find an empty or unlocked tablet slot
  *
- * Attempt to find a tablet slot that is unoccupied. If all tablet slots are
- * occupied, then attempt to find one that is not locked. If one is found, the
+ * Attempt to find a tablet slot that is unoccupied, out of the
+ * virginian.slot_count slots in use, giving it memory with virg_db_slotalloc()
+ * if it hasn't been used before. Slots on the NUMA node of the calling thread
+ * are tried first, see virg_db_localnode(). If all tablet slots are
+ * occupied, then attempt to find one that is not locked using
+ * virg_db_victim(), which applies the replacement policy. If one is found, the
  * contents of that tablet are written to disk, and the slot number is returned.
- * Otherwise return a failure. This function is not thread-safe, so the tablet
- * slot array must be locked outside of it in a multi-threaded environment.
+ * Otherwise return a failure. The returned slot has a status of
+ * VIRG_SLOT_CLAIMED so that it can't be locked until the caller has set its new
+ * tablet and raised its status to 2. This function is not thread-safe, so the
+ * tablet slot array must be locked outside of it in a multi-threaded
+ * environment.
  *
  * @param v Pointer to the state struct of the database system
  * @param slot Pointer to an unsigned integer through which the found slot will be returned
@@ -20,36 +27,39 @@ int virg_db_findslot(virginian *v, unsigned *slot_)
 {
 	unsigned slot;
 
-	if(v->tablet_slots_taken < VIRG_MEM_TABLETS) { // theres an empty slot
-		for(slot = 0; ; slot++) { // assume we'll find empty slot before end
-			// check that this assumption is true
-			assert(slot < VIRG_MEM_TABLETS);
-
-			// if the tablet is empty, break bc we found our slot
-			if(v->tablet_slot_status[slot] == 0)
+	if(v->tablet_slots_taken < v->slot_count) { // theres an empty slot
+		// prefer an empty slot in memory local to this thread
+		unsigned node = virg_db_localnode(v);
+		for(slot = 0; slot < v->slot_count; slot++)
+			if(v->tablet_slot_status[slot] == 0 &&
+				VIRG_SLOT_NODE(v, slot) == node)
 				break;
-		}
-		// lock the tablet
-		v->tablet_slots_taken++;
-		v->tablet_slot_status[slot] = 2;
-	}
-	else {
-		// get our round-robin starting location and increment it
-		slot = v->tablet_slot_counter++;
-		if(v->tablet_slot_counter >= VIRG_MEM_TABLETS)
-			v->tablet_slot_counter = 0;
 
-		unsigned checked = 0;
+		if(slot == v->slot_count)
+			for(slot = 0; ; slot++) { // assume we'll find empty slot before end
+				// check that this assumption is true
+				assert(slot < v->slot_count);
 
-		// search for an occupied but unlocked tablet
-		for( ; checked < VIRG_MEM_TABLETS && v->tablet_slot_status[slot] > 1;
-			checked++, slot = (slot + 1) % VIRG_MEM_TABLETS);
+				// if the tablet is empty, break bc we found our slot
+				if(v->tablet_slot_status[slot] == 0)
+					break;
+			}
 
-		// fail if everything is locked
-		VIRG_CHECK(slot == VIRG_MEM_TABLETS, "All tablets locked")
+		// slots are given memory the first time they are used
+		VIRG_CHECK(virg_db_slotalloc(v, slot) == VIRG_FAIL,
+			"Could not allocate tablet slot")
+
+		// claim the slot, empty slots can't be locked so no atomics needed
+		v->tablet_slots_taken++;
+		v->tablet_slot_status[slot] = VIRG_SLOT_CLAIMED;
+	}
+	else {
+		// claim an unlocked tablet using the replacement policy, failing if
+		// everything is locked
+		VIRG_CHECK(virg_db_victim(v, &slot) == VIRG_FAIL, "All tablets locked")
 
-		assert(v->tablet_slot_status[slot] == 1);
-		v->tablet_slot_status[slot]++;
+		// the evicted tablet can no longer be found in memory
+		virg_index_remove(&v->slot_index, v->tablet_slot_ids[slot]);
 
 		// write the slot contents to disk but don't assign new id bc we don't
 		// know it
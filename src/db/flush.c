@@ -0,0 +1,86 @@
+#include "virginian.h"
+
+/**
+ * Note a failed tablet write on an I/O thread
+ */
+static void flush_done(virg_io_req *req)
+{
+	if(req->result != (ssize_t)req->len)
+		((int*)req->arg)[0] = 1;
+}
+
+/**
+ * @ingroup database
+ * @brief Write every tablet in memory to disk and empty the tablet slots
+ *
+ * This is used by virg_db_close() in place of calling virg_db_clear() on every
+ * slot, so that the tablets are written concurrently by the asynchronous I/O
+ * engine rather than one after another. Tablets that have never been written
+ * are first given disk slots with virg_db_place(), then every tablet is
+ * submitted to be written and all the writes are waited for. Clean tablets and
+ * tablets accessed in place in the file mapping don't need to be written. This
+ * function is not thread-safe and no tablets may be locked or still being
+ * read.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_flush(virginian *v)
+{
+	unsigned i;
+	int failed = 0;
+
+	// make sure nothing is locked, then find disk slots for new tablets
+	for(i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			VIRG_CHECK(v->tablet_slot_status[i] != 1,
+				"Trying to clear a locked slot")
+			if(v->tablet_slots[i]->info == NULL)
+				VIRG_CHECK(virg_db_place(v, i) == VIRG_FAIL,
+					"Could not place tablet on disk")
+		}
+
+	// write every changed tablet at once
+	for(i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0 && v->tablet_slot_dirty[i]) {
+			virg_tablet_meta *tab = v->tablet_slots[i];
+			virg_io_req *req = &v->tablet_slot_io[i]->req[0];
+			size_t offset = VIRG_DISK_OFFSET(&v->db, tab->info->disk_slot);
+
+			// the Bloom filters are written like in virg_db_write()
+			if(virg_db_bloom(v, i) == VIRG_FAIL)
+				failed = 1;
+
+			if(v->dbmap != NULL && (char*)tab == v->dbmap + offset)
+				continue;
+
+			// packed like in virg_db_write()
+			tab->packed = tab->rows < tab->possible_rows;
+			req->fd = v->dbfd;
+			req->write = 1;
+			req->iov = v->tablet_slot_io[i]->iov;
+			req->iovcnt = virg_tablet_iov(tab, VIRG_ALL_COLUMNS, req->iov,
+				NULL, &req->len);
+			req->offset = offset;
+			req->done = flush_done;
+			req->arg = &failed;
+			virg_io_submit(&v->io, req);
+		}
+
+	virg_io_drain(&v->io);
+
+	// Note that the tablet slots are now empty
+	for(i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			virg_index_remove(&v->slot_index, v->tablet_slot_ids[i]);
+			v->tablet_slot_status[i] = 0;
+			v->tablet_slot_dirty[i] = 0;
+			v->tablet_slots_taken--;
+		}
+
+	VIRG_CHECK(failed, "Failed to write tablet")
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,34 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Rebuild the stack of unused disk slots from the tablet info
+ *
+ * The unused disk slots of the open database file are kept on a stack so that
+ * virg_db_place() can find a disk slot for a tablet in constant time, rather
+ * than searching the tablet info for one. The stack is built with the lowest
+ * disk slot on top, so that tablets are packed towards the head of the file,
+ * and after that virg_tablet_remove() pushes the disk slots it frees. This is
+ * called when a database is created or opened and after virg_db_compact(), and
+ * the stack always has room for virg_db.alloced_tablets disk slots.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_freeslots(virginian *v)
+{
+	unsigned i;
+
+	unsigned *stack = realloc(v->disk_free,
+		v->db.alloced_tablets * sizeof(unsigned));
+	VIRG_CHECK(stack == NULL, "Out of memory")
+	v->disk_free = stack;
+	v->disk_free_count = 0;
+
+	for(i = v->db.alloced_tablets - 1; i < v->db.alloced_tablets; i--)
+		if(v->db.tablet_info[i].used == 0)
+			v->disk_free[v->disk_free_count++] = i;
+
+	return VIRG_SUCCESS;
+}
@@ -1,99 +1,204 @@
+#define _GNU_SOURCE // preadv()
 #include "virginian.h"
 
+/**
+ * Read the parts of a locked tablet in the cols column set that aren't in
+ * memory yet, since it was loaded with fewer columns. Threads doing this at the
+ * same time read the same data into the same place, and the parts are only
+ * noted as being in memory once they have been read.
+ */
+static int load_fill(virginian *v, unsigned slot, unsigned cols)
+{
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	unsigned missing = cols & ~v->tablet_slot_cols[slot];
+	struct iovec iov[VIRG_TABLET_IOV];
+	off_t pos[VIRG_TABLET_IOV];
+	size_t len;
+	unsigned i;
+	int n, k, j;
+
+	if(missing == 0)
+		return VIRG_SUCCESS;
+
+	// the disk slot can only be looked up safely with the slot mutex
+	pthread_mutex_lock(&v->slot_lock);
+	int found = virg_index_find(&v->disk_index, tab->id, &i);
+	pthread_mutex_unlock(&v->slot_lock);
+	VIRG_CHECK(!found, "Could not find tablet id")
+	off_t x = VIRG_DISK_OFFSET(&v->db, i);
+
+	// the meta information and key column are always in memory
+	n = virg_tablet_iov(tab, missing, iov, pos, &len);
+	for(k = 2; k < n; k = j) {
+		for(j = k + 1; j < n && pos[j] == pos[j-1] + (off_t)iov[j-1].iov_len; j++);
+		for(len = 0, i = k; i < (unsigned)j; i++)
+			len += iov[i].iov_len;
+
+		VIRG_CHECK(preadv(v->dbfd, &iov[k], j - k, x + pos[k]) < (ssize_t)len,
+			"Failed to read tablet")
+	}
+
+	__sync_fetch_and_or(&v->tablet_slot_cols[slot], missing);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Wait for the read of a tablet into a slot to complete, with the tablet slot
+ * mutex held and this thread counted as one of the slot's waiters, then release
+ * the mutex and return the tablet, which the read has locked for us
+ */
+static int load_wait(virginian *v, unsigned tablet_id, unsigned slot,
+	virg_tablet_meta **tab)
+{
+	// a failed read sets the id of the still claimed slot to VIRG_INDEX_EMPTY
+	while(v->tablet_slot_status[slot] == VIRG_SLOT_CLAIMED &&
+		v->tablet_slot_ids[slot] == tablet_id)
+		pthread_cond_wait(&v->slot_cond, &v->slot_lock);
+
+	if(v->tablet_slot_ids[slot] != tablet_id) {
+		// the last thread waiting for the failed read empties the slot
+		if(--v->tablet_slot_waiters[slot] == 0) {
+			v->tablet_slot_status[slot] = 0;
+			if(slot < VIRG_MEM_TABLETS)
+				v->tablet_slots_taken--;
+		}
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Failed to read tablet")
+	}
+
+	// return a pointer to the loaded tablet
+	if(tab != NULL)
+		tab[0] = v->tablet_slots[slot];
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Finish loading a tablet that has been locked, reading any of the columns in
+ * the cols column set that aren't in memory and unlocking it if that fails
+ */
+static int load_cols(virginian *v, unsigned slot, unsigned cols)
+{
+	if(load_fill(v, slot, cols) == VIRG_FAIL) {
+		virg_tablet_unlock(v, v->tablet_slot_ids[slot]);
+		return VIRG_FAIL;
+	}
+
+	return VIRG_SUCCESS;
+}
+
 /**
  * @ingroup database
- * @brief Load a tablet into a slot based on its ID and return a pointer
+ * @brief Load some of the columns of a tablet into a slot and return a pointer
  *
  * This function is used when you are attempting to access a tablet based on its
  * ID. It will add a read-lock for the tablet and return a pointer to it. For
  * efficiency, it first checks to see if the tablet already resides in a
  * main-memory tablet slot. If it does, we simple add the lock and return the
  * pointer. Otherwise we must fetch the tablet from the database file on disk
- * and read it into a tablet slot. This function is thread-safe and performs
- * several checks to ensure that the tablet ID actually exists and that the
- * expected size of the tablet is actually read.
+ * and read it into a tablet slot, or, if the database file is mapped with
+ * virg_db_map(), point the tablet slot directly at the tablet in the mapping.
+ * The read is started with virg_db_read() and done by the asynchronous I/O
+ * engine without holding the tablet slot mutex, and other threads loading the
+ * same tablet, such as a scan catching up with the prefetch thread, wait for it
+ * to finish rather than reading it again. This function is thread-safe and
+ * performs several checks to ensure that the tablet ID actually exists and that
+ * the expected size of the tablet is actually read.
+ *
+ * Only the meta information, the key column and the parts of the tablet in the
+ * cols column set are guaranteed to be in memory, with bit i of the set
+ * standing for fixed-size column i and VIRG_OTHER_BLOCKS for the key pointer and
+ * variable blocks. This lets queries read only the columns they use. If the
+ * tablet is already in memory without some of these columns, they are read
+ * before returning. A tablet loaded without all of its columns must not be
+ * changed, so anything that changes tablets loads them with virg_db_load().
  *
  * @param v Pointer to the state struct of the database system
  * @param tablet_id The ID of the tablet being loaded
+ * @param cols Column set of the parts of the tablet that must be in memory
  * @param tab A pointer to a tablet pointer through which the location of the loaded tablet is returned
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
  * call
  */
-int virg_db_load(virginian *v, unsigned tablet_id, virg_tablet_meta **tab)
+int virg_db_loadcols(virginian *v, unsigned tablet_id, unsigned cols,
+	virg_tablet_meta **tab)
 {
 	unsigned i;
 	unsigned slot;
 
+	// if the tablet is already loaded, lock it without taking the mutex
+	if(virg_tablet_pin(v, tablet_id, &i) == VIRG_SUCCESS) {
+		if(tab != NULL)
+			tab[0] = v->tablet_slots[i];
+
+		// note the reuse for the replacement policy
+		v->tablet_slot_ref[i] = 1;
+		VIRG_ATOMIC_ADD(v->tablet_hits, 1);
+		return load_cols(v, i, cols);
+	}
+
 	// lock all the tablet slots
 	pthread_mutex_lock(&v->slot_lock);
 
-	// check if the tablet is already loaded
-	for(i = 0; i < VIRG_MEM_TABLETS; i++)
-		if(v->tablet_slot_status[i] != 0 && v->tablet_slot_ids[i] == tablet_id) {
-			if(tab != NULL)
-				tab[0] = v->tablet_slots[i];
+	// check if the tablet is already loaded, another thread may have loaded
+	// it since we tried to lock it
+	if(virg_index_find(&v->slot_index, tablet_id, &i) == VIRG_SUCCESS) {
+		VIRG_ATOMIC_ADD(v->tablet_hits, 1);
 
-			// if so, add an extra tablet lock and return the pointer
-			v->tablet_slot_status[i]++;
-			pthread_mutex_unlock(&v->slot_lock);
-			return VIRG_SUCCESS;
+		// if it is still being read, wait for the read to lock it for us
+		if(v->tablet_slot_status[i] == VIRG_SLOT_CLAIMED) {
+			v->tablet_slot_waiters[i]++;
+			if(load_wait(v, tablet_id, i, tab) == VIRG_FAIL)
+				return VIRG_FAIL;
+			return load_cols(v, i, cols);
 		}
 
-	// if not already loaded, find an empty slot
-	virg_db_findslot(v, &slot);
-
-	// find tablet on disk using the virg_db meta information
-	for(i = 0; i < v->db.alloced_tablets; i++)
-		if(v->db.tablet_info[i].used == 1
-			&& v->db.tablet_info[i].id == tablet_id)
-			break;
-
-	// make sure the tablet id was found
-	// the tablet should never not be found, and it indicates a corrupt database
-	// file
-#ifdef VIRG_DEBUG
-	if(i == v->db.alloced_tablets) {
-		fprintf(stderr, "LOOKING FOR %u\n", tablet_id);
-		virg_print_tablet_info(v);
-	}
-#endif
-	VIRG_CHECK(i == v->db.alloced_tablets, "Could not find tablet id")
-
-	// get tablet meta information from disk
-	off_t x = v->db.block_size + i * VIRG_TABLET_SIZE;
-	unsigned r = pread(v->dbfd, v->tablet_slots[slot], sizeof(virg_tablet_meta), x);
-	VIRG_CHECK(r < (int)sizeof(virg_tablet_meta), "Failed to get tablet meta data")
-
-	// get the rest of the tablet from disk
-	r = pread(v->dbfd,
-		(char*)v->tablet_slots[slot] + sizeof(virg_tablet_meta),
-		v->tablet_slots[slot]->size - sizeof(virg_tablet_meta),
-		x + sizeof(virg_tablet_meta));
-
-	// if for some reason the pread() call returned fewer bytes than it was
-	// supposed to, complain because the database file is corrupted
-#ifdef VIRG_DEBUG
-	if(r < v->tablet_slots[slot]->size - sizeof(virg_tablet_meta)) {
-		fprintf(stderr, "COULDN'T GET TABLET DATA\n");
-		fprintf(stderr, "LOOKING FOR %u\n", tablet_id);
-		virg_print_tablet_meta(v->tablet_slots[slot]);
-		virg_print_tablet_info(v);
+		if(tab != NULL)
+			tab[0] = v->tablet_slots[i];
+
+		// if so, add an extra tablet lock and return the pointer
+		VIRG_ATOMIC_ADD(v->tablet_slot_status[i], 1);
+		v->tablet_slot_ref[i] = 1;
+		pthread_mutex_unlock(&v->slot_lock);
+		return load_cols(v, i, cols);
 	}
-#endif
-	VIRG_CHECK(r < v->tablet_slots[slot]->size -
-		sizeof(virg_tablet_meta), "Failed to get tablet data")
 
-	// set the appropriate tablet data
-	v->tablet_slots[slot]->info = &v->db.tablet_info[i];
-	v->tablet_slot_ids[slot] = tablet_id;
+	// if not already loaded, find an empty slot, result tablets being read
+	// back from the spill file into the result arena
+	if((VIRG_IS_RESULT(tablet_id) ? virg_db_resultslot(v, &slot) :
+		virg_db_findslot(v, &slot)) == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_FAIL;
+	}
 
-	// return a pointer to the loaded tablet
-	if(tab != NULL)
-		tab[0] = v->tablet_slots[slot];
+	// start reading the tablet into the slot, which releases the mutex, then
+	// wait for the read as its only waiter
+	if(virg_db_read(v, tablet_id, slot, 1, cols, NULL) == VIRG_FAIL)
+		return VIRG_FAIL;
 
-	// unlock tablet array lock
-	pthread_mutex_unlock(&v->slot_lock);
+	pthread_mutex_lock(&v->slot_lock);
+	return load_wait(v, tablet_id, slot, tab);
+}
 
-	return VIRG_SUCCESS;
+/**
+ * @ingroup database
+ * @brief Load a tablet into a slot based on its ID and return a pointer
+ *
+ * Loads all of a tablet with virg_db_loadcols(), which must be done before the
+ * tablet is changed.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param tablet_id The ID of the tablet being loaded
+ * @param tab A pointer to a tablet pointer through which the location of the
+ * loaded tablet is returned
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_load(virginian *v, unsigned tablet_id, virg_tablet_meta **tab)
+{
+	return virg_db_loadcols(v, tablet_id, VIRG_ALL_COLUMNS, tab);
 }
 
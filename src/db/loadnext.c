@@ -8,27 +8,55 @@
  * unlocking as we walk along a string of tablets by using the
  * virg_tablet_meta.next information. It uses a temporary pointer to safely load
  * the next tablet before unlocking the current one. It then advances the passed
- * pointer to this new tablet. Note that a check to ensure that the current
- * tablet is not the last in the tablet string should be performed before
- * calling this function.
+ * pointer to this new tablet. When walking the tablets of a table, the tablets
+ * after the new one are read ahead with virg_db_prefetch(). Note that a check
+ * to ensure that the current tablet is not the last in the tablet string should
+ * be performed before calling this function. Only the columns in the cols
+ * column set are loaded, as with virg_db_loadcols(), and read ahead. If the
+ * next tablet can't be loaded, the passed pointer is left at the current
+ * tablet, which is still locked.
  *
  * @param v Pointer to the state struct of the database system
  * @param tab Pointer to a tablet pointer to be pointed to the next tablet
+ * @param cols Column set of the parts of the tablet that must be in memory
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
  * call
  */
 
-int virg_db_loadnext(virginian *v, virg_tablet_meta **tab)
+int virg_db_loadnextcols(virginian *v, virg_tablet_meta **tab, unsigned cols)
 {
 	// temporary tablet pointer
-	virg_tablet_meta *t = tab[0];
+	virg_tablet_meta *t;
 
 	// load the next pointer while the current one is still locked
-	virg_db_load(v, t->next, tab);
+	VIRG_CHECK(virg_db_loadcols(v, tab[0]->next, cols, &t) == VIRG_FAIL,
+		"Could not load tablet")
 
 	// unlock the old tablet
-	virg_tablet_unlock(v, t->id);
+	virg_tablet_unlock(v, tab[0]->id);
+	tab[0] = t;
+
+	// have the tablets after it read while this one is processed if we are
+	// scanning a table
+	if(tab[0]->in_table && !tab[0]->last_tablet)
+		virg_db_prefetch(v, tab[0]->id, cols);
 
 	return VIRG_SUCCESS;
 }
 
+/**
+ * @ingroup database
+ * @brief Advance a tablet pointer to all of the next tablet in its string
+ *
+ * Calls virg_db_loadnextcols() to load all of the next tablet.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param tab Pointer to a tablet pointer to be pointed to the next tablet
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_loadnext(virginian *v, virg_tablet_meta **tab)
+{
+	return virg_db_loadnextcols(v, tab, VIRG_ALL_COLUMNS);
+}
+
@@ -0,0 +1,34 @@
+#define _GNU_SOURCE // sched_getcpu()
+#include "virginian.h"
+#include <sched.h>
+
+/**
+ * @ingroup database
+ * @brief Get the NUMA node of the CPU that the calling thread is running on
+ *
+ * Used by virg_db_findslot() to prefer tablet slots backed by memory local to
+ * the thread loading a tablet, which is the thread that will go on to scan it.
+ * The prefetch thread loads tablets for other threads, so on it this returns
+ * the node of the thread whose read-ahead request it is handling, see
+ * virg_db_prefetch(). Returns 0 if NUMA placement is turned off with
+ * virginian.use_numa or the CPU can't be found.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return Index of the NUMA node in virginian.numa_node_ids
+ */
+unsigned virg_db_localnode(virginian *v)
+{
+	if(!v->use_numa || v->numa_nodes < 2)
+		return 0;
+
+	// the prefetch thread's id is set before it takes its first request
+	if(v->prefetch_running && pthread_equal(pthread_self(), v->prefetch_thread))
+		return v->prefetch_node;
+
+	int cpu = sched_getcpu();
+	if(cpu < 0 || cpu >= VIRG_NUMA_CPUS ||
+		v->numa_cpu_node[cpu] == VIRG_NUMA_NONE)
+		return 0;
+
+	return v->numa_cpu_node[cpu];
+}
@@ -0,0 +1,63 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Map the open database file into memory
+ *
+ * If the use_filemap option is set, the open database file is mapped with a
+ * shared mapping that reserves VIRG_FILEMAP_SIZE bytes of address space so that
+ * the file can grow without being remapped. While the mapping exists,
+ * virg_db_load() points tablet slots directly at tablets in the mapping rather
+ * than copying them into the slot memory, and virg_db_write() skips writing
+ * these tablets back since their changes are already in the page cache. If the
+ * mapping can not be created, an error is printed and tablets continue to be
+ * copied in and out of slots.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_map(virginian *v)
+{
+	struct stat st;
+	void *map;
+
+	v->dbmap = NULL;
+	if(!v->use_filemap)
+		return VIRG_SUCCESS;
+
+	VIRG_CHECK(fstat(v->dbfd, &st) != 0, "Problem getting database file size")
+
+	map = mmap(NULL, VIRG_FILEMAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+		v->dbfd, 0);
+	VIRG_CHECK(map == MAP_FAILED, "Could not map database file")
+
+	v->dbmap = (char*)map;
+	v->dbmap_filesize = st.st_size;
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup database
+ * @brief Remove the mapping of the database file
+ *
+ * Unmaps the database file if it was mapped by virg_db_map(). This must only be
+ * called once every tablet slot pointing into the mapping has been cleared,
+ * which virg_db_close() does before calling this.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_unmap(virginian *v)
+{
+	if(v->dbmap == NULL)
+		return VIRG_SUCCESS;
+
+	int r = munmap(v->dbmap, VIRG_FILEMAP_SIZE);
+	v->dbmap = NULL;
+	VIRG_CHECK(r != 0, "Problem unmapping database file")
+
+	return VIRG_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Find the NUMA nodes of the machine and the CPUs local to each
+ *
+ * Reads the online nodes and the CPUs of each from sysfs, filling
+ * virginian.numa_node_ids and virginian.numa_cpu_node. Tablet slots are dealt
+ * out to these nodes in turn by virg_db_slotalloc(), see VIRG_SLOT_NODE(), and
+ * the threads of multi-core execution are pinned to them in turn by
+ * virg_vm_bindthread(), so that on a machine with several sockets each thread
+ * scans tablets from memory local to it as often as possible. If NUMA
+ * information isn't available, or there are more than VIRG_NUMA_NODES nodes,
+ * every CPU is treated as being in a single node. This is called by
+ * virg_init().
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_numa(virginian *v)
+{
+	unsigned node, cpu, last;
+	char path[64];
+	FILE *f;
+	int c;
+
+	v->numa_nodes = 0;
+	memset(v->numa_cpu_node, VIRG_NUMA_NONE, VIRG_NUMA_CPUS);
+
+	for(node = 0; node < VIRG_NUMA_CPUS; node++) {
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist",
+			node);
+		f = fopen(path, "r");
+		if(f == NULL)
+			continue;
+
+		// too many nodes to keep track of, so treat them as one
+		if(v->numa_nodes == VIRG_NUMA_NODES) {
+			fclose(f);
+			v->numa_nodes = 0;
+			break;
+		}
+
+		// the cpu list is a comma separated list of ranges, like 0-3,8-11
+		while(fscanf(f, "%u", &cpu) == 1) {
+			last = cpu;
+			c = fgetc(f);
+			if(c == '-') {
+				if(fscanf(f, "%u", &last) != 1)
+					break;
+				c = fgetc(f);
+			}
+			for( ; cpu <= last && cpu < VIRG_NUMA_CPUS; cpu++)
+				v->numa_cpu_node[cpu] = v->numa_nodes;
+			if(c != ',')
+				break;
+		}
+		fclose(f);
+
+		v->numa_node_ids[v->numa_nodes] = node;
+		v->numa_nodes++;
+	}
+
+	// without node information, every cpu is local to everything
+	if(v->numa_nodes == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_CONF);
+		if(cpus < 1)
+			cpus = 1;
+		memset(v->numa_cpu_node, 0, VIRG_MIN((size_t)cpus, VIRG_NUMA_CPUS));
+		v->numa_node_ids[0] = 0;
+		v->numa_nodes = 1;
+	}
+
+	return VIRG_SUCCESS;
+}
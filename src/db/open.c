@@ -10,7 +10,8 @@
  * function and created with the virg_db_create() function. This function sets
  * the information in the virg_db struct stored within the passed virginian
  * struct. Only one database can be open at a time, so this function should only
- * be called if there are no other open databases.
+ * be called if there are no other open databases. The tablet slots are resized
+ * for the tablet size that the database was created with.
  *
  * @param v Pointer to the state struct of the database system
  * @param file Location on disk of the database file
@@ -21,6 +22,7 @@ int virg_db_open(virginian *v, const char *file)
 {
 	int fd;
 	size_t r;
+	unsigned i;
 
 	// ensure that no database is currently open
 	VIRG_CHECK(v->dbfd != -1, "Database already open")
@@ -30,20 +32,54 @@ int virg_db_open(virginian *v, const char *file)
 	VIRG_CHECK(fd == -1, "Problem opening database file")
 	v->dbfd = fd;
 
+	// open the Bloom filter file alongside it
+	VIRG_CHECK(virg_db_bloomopen(v, file, 0) == VIRG_FAIL,
+		"Problem opening Bloom filter file")
+
+	// result tablets are spilled to a file of their own
+	VIRG_CHECK(virg_db_spillopen(v, file) == VIRG_FAIL,
+		"Problem opening spill file")
+
 	// read the fixed size meta information into our virg_db struct
 	r = read(fd, &v->db, sizeof(virg_db));
 	VIRG_CHECK(r < sizeof(virg_db), "Corrupt database file")
 
+	// make the tablet slots as big as the database's tablets
+	size_t tablet_size = v->db.tablet_size;
+	VIRG_CHECK(tablet_size < VIRG_TABLET_MIN_SIZE ||
+		tablet_size > VIRG_TABLET_MAX_SIZE ||
+		(tablet_size & (tablet_size - 1)) != 0, "Corrupt database file")
+	VIRG_CHECK(virg_db_slots(v, tablet_size) == VIRG_FAIL,
+		"Could not allocate tablet slots")
+
 	// allocate an area for the variable-size tablet tracking information
 	// even if there are no tablets, alloced_tablets is set to non-zero when the
 	// database is created
+	VIRG_CHECK(v->db.alloced_tablets == 0 ||
+		v->db.alloced_tablets % VIRG_EXTENT_TABLETS != 0, "Corrupt database file")
 	size_t size = v->db.alloced_tablets * sizeof(virg_tablet_info);
 	v->db.tablet_info = (virg_tablet_info*) malloc(size);
 	VIRG_CHECK(v->db.tablet_info == NULL, "Out of memory")
 
-	// read the meta-information from disk
-	r = read(fd, v->db.tablet_info, size);
-	VIRG_CHECK(r < size, "Problem reading tablet info")
+	// read the meta-information from the head of each extent
+	size = VIRG_EXTENT_TABLETS * sizeof(virg_tablet_info);
+	for(i = 0; i < v->db.alloced_tablets; i += VIRG_EXTENT_TABLETS) {
+		r = pread(fd, &v->db.tablet_info[i], size,
+			VIRG_EXTENT_OFFSET(&v->db, i));
+		VIRG_CHECK(r != size, "Problem reading tablet info")
+	}
+
+	// build the index of disk slots and the stack of unused ones from the
+	// tablet info
+	VIRG_CHECK(virg_index_init(&v->disk_index, VIRG_INDEX_INITIAL_SIZE) ==
+		VIRG_FAIL, "Could not init disk index")
+	for(i = 0; i < v->db.alloced_tablets; i++)
+		if(v->db.tablet_info[i].used == 1)
+			virg_index_insert(&v->disk_index, v->db.tablet_info[i].id, i);
+	VIRG_CHECK(virg_db_freeslots(v) == VIRG_FAIL, "Could not list disk slots")
+
+	// map the file for in-place tablet access if enabled
+	virg_db_map(v);
 
 	return VIRG_SUCCESS;
 }
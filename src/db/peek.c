@@ -0,0 +1,62 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Read the meta information of a tablet that isn't in memory
+ *
+ * Lets table scans decide whether a tablet is worth loading, with its zone map
+ * and Bloom filters, and follow the string of tablets past it if it isn't,
+ * without reading the rest of it. Tablets that are in a tablet slot may have
+ * changes that haven't been written, so VIRG_FAIL is returned for them and
+ * they should be loaded with virg_db_load() as usual. The tablet is found on
+ * disk with the tablet slot mutex held, but it is released during the read so
+ * that other threads can go on loading tablets. The copy is thrown away, and
+ * VIRG_FAIL returned, if the tablet was loaded or moved, or any tablet was
+ * written to disk, while it was being read, since it could then be torn.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param tablet_id	ID of the tablet
+ * @param meta		Pointer through which a copy of the tablet's meta
+ * information is returned
+ * @param disk_slot	Pointer through which the tablet's disk slot is returned
+ * @return VIRG_SUCCESS, or VIRG_FAIL if the tablet is in memory or can't be
+ * read
+ */
+int virg_db_peek(virginian *v, unsigned tablet_id, virg_tablet_meta *meta,
+	unsigned *disk_slot)
+{
+	unsigned long long writes;
+	unsigned slot;
+	size_t offset;
+	ssize_t r;
+
+	// find the tablet on disk, and what has been written, under the mutex
+	pthread_mutex_lock(&v->slot_lock);
+
+	if(virg_index_find(&v->slot_index, tablet_id, NULL) == VIRG_SUCCESS ||
+		virg_index_find(&v->disk_index, tablet_id, disk_slot) == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_FAIL;
+	}
+	offset = VIRG_DISK_OFFSET(&v->db, disk_slot[0]);
+	writes = v->disk_writes;
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	r = pread(v->dbfd, meta, sizeof(virg_tablet_meta), offset);
+
+	// the tablet can only have changed on disk by being loaded, and then
+	// written or still in memory, or by being moved to another disk slot
+	pthread_mutex_lock(&v->slot_lock);
+
+	if(v->disk_writes != writes ||
+		virg_index_find(&v->slot_index, tablet_id, NULL) == VIRG_SUCCESS ||
+		virg_index_find(&v->disk_index, tablet_id, &slot) == VIRG_FAIL ||
+		slot != disk_slot[0])
+		r = 0;
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	return r == (ssize_t)sizeof(virg_tablet_meta) ? VIRG_SUCCESS : VIRG_FAIL;
+}
+
@@ -0,0 +1,94 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Find a place on disk for a tablet that has never been written
+ *
+ * This function assigns a disk slot to the tablet in a tablet slot, which must
+ * not yet have a virg_tablet_info, and points the tablet's info at it. It is
+ * used by virg_db_write() and virg_db_flush() before the tablet is written, and
+ * like them is not thread-safe, so the tablet slot array should be locked in a
+ * multi-threaded environment. The disk slot is taken from the top of the stack
+ * of unused disk slots, see virg_db_freeslots(), so this takes constant time
+ * however many tablets the file holds.
+ *
+ * The listing of the tablets in the database file has a variable size because
+ * we can have an arbitrarily large number of tablets stored in the file. It is
+ * stored in memory while the database is open and written to the head of each
+ * extent of the file when the database closes, see virg_db. If every disk slot
+ * is used, another extent's worth of tablet info is allocated in memory, which
+ * adds an extent to the end of the file when its first tablet is written. The
+ * disk slots already in use stay where they are, so nothing on disk is moved
+ * and only the tablet info pointers of the tablets in memory need to be
+ * updated for the new allocation.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param slot The number of the tablet slot holding the tablet
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_place(virginian *v, unsigned slot)
+{
+	unsigned i;
+
+	// ptr to tablet slot
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+
+	// if no empty spot, add an extent, the file expands implicitly
+	if(v->disk_free_count == 0) {
+		unsigned new_alloced_tablets = v->db.alloced_tablets +
+			VIRG_EXTENT_TABLETS;
+
+		// allocate a bigger area in memory
+		virg_tablet_info *info = malloc(new_alloced_tablets *
+			sizeof(virg_tablet_info));
+		VIRG_CHECK(info == NULL, "Out of memory")
+		unsigned *stack = realloc(v->disk_free, new_alloced_tablets *
+			sizeof(unsigned));
+		if(stack == NULL)
+			free(info);
+		VIRG_CHECK(stack == NULL, "Out of memory")
+		v->disk_free = stack;
+
+		// copy the tablet info in memory into the newly allocated block
+		memcpy(info, v->db.tablet_info, v->db.alloced_tablets *
+			sizeof(virg_tablet_info));
+
+		// update pointers in in-memory tablets to the new tablet info
+		// block, tablets still being read get theirs when the read ends
+		for(i = 0; i < VIRG_MEM_TABLETS; i++)
+			if(v->tablet_slot_status[i] > 0 &&
+				v->tablet_slots[i]->info != NULL)
+				v->tablet_slots[i]->info =
+					&info[v->tablet_slots[i]->info->disk_slot];
+
+		// free the old tablet info block
+		free(v->db.tablet_info);
+		v->db.tablet_info = info;
+
+		// initialize the new extent of the tablet info block and push its
+		// disk slots, the first of them on top
+		for(i = new_alloced_tablets - 1; i >= v->db.alloced_tablets; i--) {
+			v->db.tablet_info[i].used = 0;
+			v->db.tablet_info[i].disk_slot = i;
+#ifdef VIRG_DEBUG
+			v->db.tablet_info[i].id = 0xDEADBEEF;
+#endif
+			v->disk_free[v->disk_free_count++] = i;
+		}
+
+		v->db.alloced_tablets = new_alloced_tablets;
+	}
+
+	// take the empty spot on top of the stack of unused disk slots
+	i = v->disk_free[--v->disk_free_count];
+
+	// set the tablet info of the disk slot and point the tablet at it
+	v->db.tablet_info[i].used = 1;
+	v->db.tablet_info[i].id = tab->id;
+	v->db.tablet_info[i].disk_slot = i;
+	virg_index_insert(&v->disk_index, tab->id, i);
+	tab->info = &v->db.tablet_info[i];
+
+	return VIRG_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Request that the tablets following a tablet be read ahead
+ *
+ * Table scans walk a string of tablets with virg_db_loadnext(), which would
+ * otherwise stall on a read from disk at every tablet boundary. This queues a
+ * request for the prefetch thread to load the virginian.readahead tablets that
+ * follow the passed tablet in its string, so that they are already in tablet
+ * slots, or being read into them, when the scan reaches them. The prefetch
+ * thread is started with virg_db_prefetch_start() the first time it is needed.
+ * The request never blocks on disk; if the queue is full, or if the same
+ * tablet was just requested, it is dropped. Nothing is done if
+ * virginian.readahead is 0. Only the parts of the tablets in the cols column
+ * set are read, and they are placed in tablet slots on the NUMA node of the
+ * calling thread, see virg_db_localnode().
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param tablet_id ID of the tablet whose successors should be read ahead
+ * @param cols Column set of the parts of the tablets to be read
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_prefetch(virginian *v, unsigned tablet_id, unsigned cols)
+{
+	if(v->readahead == 0)
+		return VIRG_SUCCESS;
+
+	if(!v->prefetch_running)
+		VIRG_CHECK(virg_db_prefetch_start(v) == VIRG_FAIL,
+			"Could not start prefetch thread")
+
+	unsigned node = virg_db_localnode(v);
+
+	pthread_mutex_lock(&v->prefetch_lock);
+
+	unsigned last = (v->prefetch_head + VIRG_PREFETCH_QUEUE - 1) %
+		VIRG_PREFETCH_QUEUE;
+	unsigned next = (v->prefetch_head + 1) % VIRG_PREFETCH_QUEUE;
+
+	// add the request unless the queue is full or it repeats the last one
+	if(next != v->prefetch_tail && (v->prefetch_head == v->prefetch_tail ||
+		v->prefetch_queue[last] != tablet_id)) {
+		v->prefetch_queue[v->prefetch_head] = tablet_id;
+		v->prefetch_cols[v->prefetch_head] = cols;
+		v->prefetch_nodes[v->prefetch_head] = node;
+		v->prefetch_head = next;
+		pthread_cond_signal(&v->prefetch_cond);
+	}
+
+	pthread_mutex_unlock(&v->prefetch_lock);
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,162 @@
+#include "virginian.h"
+
+/**
+ * Count the tablet slots that could take a tablet without waiting for a lock to
+ * be released, the count is only a guess since it is made without the mutex
+ */
+static unsigned prefetch_room(virginian *v)
+{
+	unsigned i, room = 0;
+
+	for(i = 0; i < v->slot_count; i++)
+		if(v->tablet_slot_status[i] == 0 || v->tablet_slot_status[i] == 1)
+			room++;
+
+	return room;
+}
+
+/**
+ * Start reading the tablets following a tablet in its string without waiting
+ * for them, remembering where the string goes from each tablet being read since
+ * it can't be locked until the read is done, only the parts of the tablets in
+ * the cols column set are read
+ */
+static void prefetch_walk(virginian *v, unsigned tablet_id, unsigned cols)
+{
+	virg_tablet_meta meta;
+	unsigned i, next, slot;
+
+	for(i = 0; i < v->readahead && !v->prefetch_stop; i++) {
+		// find the next tablet from a tablet this thread has started reading
+		// or from the tablet in memory
+		if(virg_index_find(&v->prefetch_next, tablet_id, &next) == VIRG_FAIL) {
+			if(virg_tablet_pin(v, tablet_id, &slot) == VIRG_FAIL)
+				return;
+			next = v->tablet_slots[slot]->last_tablet ? VIRG_INDEX_EMPTY :
+				v->tablet_slots[slot]->next;
+			virg_tablet_unlock(v, tablet_id);
+		}
+		if(next == VIRG_INDEX_EMPTY)
+			return;
+
+		// leave a quarter of the slots to the threads that are scanning, and
+		// stop if a tablet can't be read ahead
+		if(prefetch_room(v) <= v->slot_count / 4 ||
+			virg_db_readahead(v, next, cols, &meta) == VIRG_FAIL)
+			return;
+
+		// a last tablet may be added to, so it's looked up in memory instead
+		if(v->prefetch_next.used >= v->slot_count)
+			virg_index_clear(&v->prefetch_next);
+		if(!meta.last_tablet)
+			virg_index_insert(&v->prefetch_next, next, meta.next);
+
+		tablet_id = next;
+	}
+}
+
+/**
+ * Main loop of the prefetch thread, which handles read-ahead requests from
+ * virg_db_prefetch() until virg_db_prefetch_stop() is called
+ */
+static void *prefetcher(void *arg)
+{
+	virginian *v = (virginian*)arg;
+	unsigned tablet_id, cols;
+
+	// the thread may run anywhere, the tablets it reads are placed on the node
+	// of the thread that asked for them instead of its own
+	pthread_mutex_lock(&v->prefetch_lock);
+
+	while(!v->prefetch_stop) {
+		if(v->prefetch_head == v->prefetch_tail) {
+			pthread_cond_wait(&v->prefetch_cond, &v->prefetch_lock);
+			continue;
+		}
+
+		tablet_id = v->prefetch_queue[v->prefetch_tail];
+		cols = v->prefetch_cols[v->prefetch_tail];
+		v->prefetch_node = v->prefetch_nodes[v->prefetch_tail];
+		v->prefetch_tail = (v->prefetch_tail + 1) % VIRG_PREFETCH_QUEUE;
+
+		// read from disk without holding the queue lock
+		pthread_mutex_unlock(&v->prefetch_lock);
+		prefetch_walk(v, tablet_id, cols);
+		pthread_mutex_lock(&v->prefetch_lock);
+	}
+
+	pthread_mutex_unlock(&v->prefetch_lock);
+
+	return NULL;
+}
+
+/**
+ * @ingroup database
+ * @brief Start the thread that reads tablets ahead of table scans
+ *
+ * Starts the background thread that handles the read-ahead requests made with
+ * virg_db_prefetch(). It starts reading tablets with virg_db_readahead(), so
+ * that up to virginian.readahead reads are in flight at once. Tablets being
+ * read ahead occupy tablet slots which other threads wait on rather than
+ * reading them again, and once read they are left unlocked in their slots to
+ * be found by the scan. This is called by virg_db_prefetch()
+ * when needed, and does nothing if the thread is already running.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_prefetch_start(virginian *v)
+{
+	int r = 0;
+
+	pthread_mutex_lock(&v->prefetch_lock);
+
+	if(!v->prefetch_running) {
+		v->prefetch_stop = 0;
+		v->prefetch_head = 0;
+		v->prefetch_tail = 0;
+		virg_index_clear(&v->prefetch_next);
+		r = pthread_create(&v->prefetch_thread, NULL, prefetcher, v);
+		v->prefetch_running = (r == 0);
+	}
+
+	pthread_mutex_unlock(&v->prefetch_lock);
+
+	VIRG_CHECK(r != 0, "Could not create prefetch thread")
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup database
+ * @brief Stop the thread that reads tablets ahead of table scans
+ *
+ * Drops any waiting read-ahead requests, tells the prefetch thread to exit
+ * after the tablet it is currently loading, and waits for it. This is called by
+ * virg_db_close() before the tablet slots are cleared, since the prefetch
+ * thread may be holding tablet locks while it runs. It does nothing if the
+ * thread isn't running.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_prefetch_stop(virginian *v)
+{
+	if(!v->prefetch_running)
+		return VIRG_SUCCESS;
+
+	pthread_mutex_lock(&v->prefetch_lock);
+	v->prefetch_stop = 1;
+	v->prefetch_tail = v->prefetch_head;
+	pthread_cond_signal(&v->prefetch_cond);
+	pthread_mutex_unlock(&v->prefetch_lock);
+
+	VIRG_CHECK(pthread_join(v->prefetch_thread, NULL) != 0,
+		"Could not join prefetch thread")
+	v->prefetch_running = 0;
+
+	return VIRG_SUCCESS;
+}
+
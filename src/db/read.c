@@ -0,0 +1,291 @@
+#define _GNU_SOURCE // madvise()
+#include "virginian.h"
+
+/**
+ * Finish a tablet read, making the tablet lockable with a lock for each thread
+ * waiting for it, or forgetting it if the read failed
+ */
+static void read_done(virginian *v, unsigned slot, int failed)
+{
+	unsigned tablet_id = v->tablet_slot_ids[slot];
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	unsigned i;
+
+	// a tablet read from disk is clean, unless the zone map of a table tablet
+	// isn't valid, in which case it is rebuilt if all of the tablet was read
+	// and the tablet has to be written with the new one
+	if(!failed) {
+		v->tablet_slot_dirty[slot] = 0;
+		if(tab->in_table && !tab->zones &&
+			v->tablet_slot_cols[slot] == VIRG_ALL_COLUMNS) {
+			virg_tablet_zones(tab, 0);
+			v->tablet_slot_dirty[slot] = 1;
+		}
+	}
+
+	pthread_mutex_lock(&v->slot_lock);
+
+	if(!failed) {
+		// look up the disk slot again since the tablet info may have been
+		// reorganized during the read, result tablets have none
+		if(VIRG_IS_RESULT(tablet_id))
+			tab->info = NULL;
+		else {
+			virg_index_find(&v->disk_index, tablet_id, &i);
+			tab->info = &v->db.tablet_info[i];
+			virg_db_admit(v, slot);
+			VIRG_ATOMIC_ADD(v->tablet_misses, 1);
+		}
+
+		// release the claim on the slot
+		__sync_synchronize();
+		v->tablet_slot_status[slot] = 1 + v->tablet_slot_waiters[slot];
+		v->tablet_slot_waiters[slot] = 0;
+	}
+	else {
+		// the slot is emptied by the last thread to see that the read failed
+		virg_index_remove(&v->slot_index, tablet_id);
+		v->tablet_slot_ids[slot] = VIRG_INDEX_EMPTY;
+		if(v->tablet_slot_waiters[slot] == 0) {
+			v->tablet_slot_status[slot] = 0;
+			if(slot < VIRG_MEM_TABLETS)
+				v->tablet_slots_taken--;
+		}
+	}
+
+	pthread_cond_broadcast(&v->slot_cond);
+	pthread_mutex_unlock(&v->slot_lock);
+}
+
+/**
+ * Finish one of the requests of a tablet read on an I/O thread, finishing the
+ * read once all of them are done
+ */
+static void read_part_done(virg_io_req *req)
+{
+	virg_slot_io *io = (virg_slot_io*)req->arg;
+	virginian *v = io->v;
+	unsigned slot = io->slot;
+
+	if(req->result != (ssize_t)req->len)
+		v->tablet_slot_failed[slot] = 1;
+
+	if(__sync_sub_and_fetch(&v->tablet_slot_pending[slot], 1) == 0)
+		read_done(v, slot, v->tablet_slot_failed[slot]);
+}
+
+/**
+ * Read a result tablet back from the spill file into a claimed slot of the
+ * result arena, see virg_db_spill(), releasing the tablet slot mutex
+ */
+static int read_spilled(virginian *v, unsigned tablet_id, unsigned slot,
+	unsigned waiters, virg_tablet_meta *meta)
+{
+	unsigned place;
+
+	if(virg_index_find(&v->spill_index, tablet_id, &place) == VIRG_FAIL) {
+		v->tablet_slot_status[slot] = 0;
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Could not find result tablet id")
+	}
+
+	v->tablet_slots[slot] = v->tablet_slot_alloc[slot];
+	v->tablet_slot_ids[slot] = tablet_id;
+	v->tablet_slot_waiters[slot] = waiters;
+	v->tablet_slot_cols[slot] = VIRG_ALL_COLUMNS;
+	virg_index_insert(&v->slot_index, tablet_id, slot);
+	pthread_mutex_unlock(&v->slot_lock);
+
+	// result tablets are spilled whole, so read the meta information to find
+	// out how much follows it
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	off_t x = (off_t)place * v->db.tablet_size;
+	ssize_t r = pread(v->spillfd, tab, sizeof(virg_tablet_meta), x);
+	int failed = r < (ssize_t)sizeof(virg_tablet_meta) ||
+		tab->size > v->db.tablet_size;
+	if(!failed) {
+		size_t rest = tab->size - sizeof(virg_tablet_meta);
+		r = pread(v->spillfd, (char*)tab + sizeof(virg_tablet_meta), rest,
+			x + sizeof(virg_tablet_meta));
+		failed = r < (ssize_t)rest;
+	}
+	if(!failed && meta != NULL)
+		memcpy(meta, tab, sizeof(virg_tablet_meta));
+
+	read_done(v, slot, failed);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup database
+ * @brief Start reading a tablet from disk into a claimed tablet slot
+ *
+ * This is used by virg_db_load() and virg_db_readahead() once they have
+ * claimed a slot with virg_db_findslot(), and must be called with the tablet
+ * slot mutex held, which it releases. The tablet is found on disk and put in
+ * the slot index while its slot is still claimed, so that it can't be locked
+ * and other threads looking for it wait for the read instead of starting
+ * another. The tablet's meta information is read immediately, so that the rest
+ * of the tablet can be read asynchronously with virg_io_submit(), directly into
+ * the tablet's layout if it was stored packed by virg_db_write(). Only the
+ * parts of the tablet in the cols column set are read, with a request for each
+ * contiguous part of the file, and the set is noted in the slot's
+ * virginian.tablet_slot_cols. When the read completes the slot is given a lock
+ * for each of the threads counted in its virginian.tablet_slot_waiters,
+ * starting with the waiters argument. If
+ * the database file is mapped with virg_db_map(), the slot is pointed at the
+ * tablet in the mapping instead and the read is left to the page cache, unless
+ * the tablet is packed, in which case it is copied out of the mapping. Either
+ * way all of the tablet is then in memory. A table tablet read without a valid
+ * zone map has it rebuilt with virg_tablet_zones() once all of it is in memory.
+ * Result tablets are read whole from the spill file instead, before returning.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param tablet_id	ID of the tablet to be read
+ * @param slot		Tablet slot claimed for the tablet
+ * @param waiters	Number of locks to be added when the read is complete
+ * @param cols		Column set of the parts of the tablet to be read
+ * @param meta		If not NULL, the tablet's meta information is copied here
+ * @return VIRG_FAIL if the tablet isn't in the database file, in which case the
+ * slot is released, otherwise VIRG_SUCCESS even if the read fails later
+ */
+int virg_db_read(virginian *v, unsigned tablet_id, unsigned slot,
+	unsigned waiters, unsigned cols, virg_tablet_meta *meta)
+{
+	unsigned i;
+	int n, k;
+
+	if(VIRG_IS_RESULT(tablet_id))
+		return read_spilled(v, tablet_id, slot, waiters, meta);
+
+	// find tablet on disk using the disk slot index
+	int found = virg_index_find(&v->disk_index, tablet_id, &i);
+
+	// make sure the tablet id was found
+	// the tablet should never not be found, and it indicates a corrupt database
+	// file
+	if(!found) {
+#ifdef VIRG_DEBUG
+		fprintf(stderr, "LOOKING FOR %u\n", tablet_id);
+		virg_print_tablet_info(v);
+#endif
+		v->tablet_slot_status[slot] = 0;
+		v->tablet_slots_taken--;
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Could not find tablet id")
+	}
+
+	off_t x = VIRG_DISK_OFFSET(&v->db, i);
+
+	// if the database file is mapped, point the slot directly at the tablet in
+	// the mapping rather than copying it into the slot's memory
+	if(v->dbmap != NULL && (size_t)x + v->db.tablet_size <= VIRG_FILEMAP_SIZE) {
+		// the tablet may grow in place up to the full tablet size, so make
+		// sure the file covers all of it to avoid faulting past its end
+		// writes may have extended the file since the size was last noted, so
+		// check the real size before extending it to avoid truncating tablets
+		if((size_t)x + v->db.tablet_size > v->dbmap_filesize) {
+			struct stat st;
+			if(fstat(v->dbfd, &st) == 0)
+				v->dbmap_filesize = st.st_size;
+
+			if((size_t)x + v->db.tablet_size > v->dbmap_filesize &&
+				ftruncate(v->dbfd, x + v->db.tablet_size) == 0)
+				v->dbmap_filesize = x + v->db.tablet_size;
+		}
+
+		// fall back to reading the tablet if the file couldn't be extended
+		if((size_t)x + v->db.tablet_size <= v->dbmap_filesize)
+			v->tablet_slots[slot] = (virg_tablet_meta*)(v->dbmap + x);
+		else
+			v->tablet_slots[slot] = v->tablet_slot_alloc[slot];
+	}
+	else
+		v->tablet_slots[slot] = v->tablet_slot_alloc[slot];
+
+	// the slot stays claimed during the read, but it is put in the slot index
+	// so that other threads loading the same tablet wait for this read
+	v->tablet_slot_ids[slot] = tablet_id;
+	v->tablet_slot_waiters[slot] = waiters;
+	virg_index_insert(&v->slot_index, tablet_id, slot);
+	pthread_mutex_unlock(&v->slot_lock);
+
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	struct iovec *iov = v->tablet_slot_io[slot]->iov;
+	off_t pos[VIRG_TABLET_IOV];
+	size_t len;
+
+	if(tab != v->tablet_slot_alloc[slot]) {
+		// a packed tablet can't be used in place, so it is unpacked from the
+		// mapping into the slot's memory, the slot is still claimed so no
+		// other thread looks at its tablet pointer
+		if(tab->packed) {
+			char *src = (char*)tab;
+			tab = v->tablet_slot_alloc[slot];
+			memcpy(tab, src, sizeof(virg_tablet_meta));
+
+			n = virg_tablet_iov(tab, VIRG_ALL_COLUMNS, iov, pos, &len);
+			for(k = 1; k < n; k++)
+				memcpy(iov[k].iov_base, src + pos[k], iov[k].iov_len);
+			v->tablet_slots[slot] = tab;
+		}
+		// otherwise start reading the tablet from disk ahead of the scan, the
+		// advice must start on a page boundary
+		else {
+			off_t page = x & ~(off_t)(getpagesize() - 1);
+			madvise(v->dbmap + page, x - page + tab->size, MADV_WILLNEED);
+		}
+		if(meta != NULL)
+			memcpy(meta, tab, sizeof(virg_tablet_meta));
+		v->tablet_slot_cols[slot] = VIRG_ALL_COLUMNS;
+		read_done(v, slot, 0);
+		return VIRG_SUCCESS;
+	}
+
+	// get tablet meta information from disk
+	ssize_t r = pread(v->dbfd, tab, sizeof(virg_tablet_meta), x);
+	if(r < (ssize_t)sizeof(virg_tablet_meta)) {
+		read_done(v, slot, 1);
+		return VIRG_SUCCESS;
+	}
+	if(meta != NULL)
+		memcpy(meta, tab, sizeof(virg_tablet_meta));
+	v->tablet_slot_cols[slot] = cols;
+
+	// list the rest of the parts to be read, scattering the columns of a
+	// packed tablet to their places in the slot
+	n = virg_tablet_iov(tab, cols, iov, pos, &len);
+
+	// count the requests for the contiguous parts of the file before any of
+	// them can complete
+	v->tablet_slot_pending[slot] = 1;
+	v->tablet_slot_failed[slot] = 0;
+	for(k = 2; k < n; k++)
+		if(pos[k] != pos[k-1] + (off_t)iov[k-1].iov_len)
+			v->tablet_slot_pending[slot]++;
+
+	// read them asynchronously
+	for(k = 1, i = 0; k < n; i++) {
+		virg_io_req *req = &v->tablet_slot_io[slot]->req[i];
+		req->fd = v->dbfd;
+		req->write = 0;
+		req->arg = v->tablet_slot_io[slot];
+		req->done = read_part_done;
+		req->iov = &iov[k];
+		req->iovcnt = 0;
+		req->len = 0;
+		req->offset = x + pos[k];
+
+		do {
+			req->iovcnt++;
+			req->len += iov[k].iov_len;
+			k++;
+		} while(k < n && pos[k] == pos[k-1] + (off_t)iov[k-1].iov_len);
+
+		virg_io_submit(&v->io, req);
+	}
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,62 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Start reading a tablet into memory without waiting for it
+ *
+ * This is used by the prefetch thread to keep several tablet reads in flight at
+ * once. If the tablet isn't in memory, a slot is claimed for it and the read is
+ * started with virg_db_read(), and the tablet becomes available, unlocked, once
+ * the read completes. The tablet's meta information is returned either way so
+ * that the caller can follow the string of tablets without waiting for the
+ * rest of the tablet. A tablet that another thread is already reading can't be
+ * waited for without defeating the purpose, so VIRG_FAIL is returned without
+ * an error in that case. Only the parts of the tablet in the cols column set
+ * are read, as with virg_db_loadcols().
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param tablet_id	ID of the tablet to be read
+ * @param cols		Column set of the parts of the tablet to be read
+ * @param meta		Pointer through which a copy of the tablet's meta
+ * information is returned
+ * @return VIRG_SUCCESS or VIRG_FAIL if the tablet can't be read ahead
+ */
+int virg_db_readahead(virginian *v, unsigned tablet_id, unsigned cols,
+	virg_tablet_meta *meta)
+{
+	unsigned slot;
+
+	// if the tablet is already in memory, just copy its meta information
+	if(virg_tablet_pin(v, tablet_id, &slot) == VIRG_SUCCESS) {
+		memcpy(meta, v->tablet_slots[slot], sizeof(virg_tablet_meta));
+		virg_tablet_unlock(v, tablet_id);
+		return VIRG_SUCCESS;
+	}
+
+	pthread_mutex_lock(&v->slot_lock);
+
+	// another thread may have loaded it since we tried to lock it, or may be
+	// reading it
+	if(virg_index_find(&v->slot_index, tablet_id, &slot) == VIRG_SUCCESS) {
+		if(v->tablet_slot_status[slot] == VIRG_SLOT_CLAIMED) {
+			pthread_mutex_unlock(&v->slot_lock);
+			return VIRG_FAIL;
+		}
+
+		VIRG_ATOMIC_ADD(v->tablet_slot_status[slot], 1);
+		pthread_mutex_unlock(&v->slot_lock);
+
+		memcpy(meta, v->tablet_slots[slot], sizeof(virg_tablet_meta));
+		virg_tablet_unlock(v, tablet_id);
+		return VIRG_SUCCESS;
+	}
+
+	if(virg_db_findslot(v, &slot) == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_FAIL;
+	}
+
+	// start the read with no threads waiting for it, releasing the mutex
+	return virg_db_read(v, tablet_id, slot, 0, cols, meta);
+}
+
@@ -0,0 +1,106 @@
+#define _GNU_SOURCE // madvise()
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Change the memory budget of the tablet slots
+ *
+ * Sets the number of tablet slots in use to as many tablets of the open
+ * database as fit in budget bytes, from VIRG_MEM_MIN_TABLETS to
+ * VIRG_MEM_TABLETS. This can be called at any time, such as just after
+ * virg_init() to set the budget before any memory is used, since slots are
+ * only given memory when they are first used. When the number of slots grows,
+ * the new slots are used as tablets are loaded. When it shrinks, the tablets in
+ * the slots being removed are written to disk if they have changed and their
+ * memory is given back to the operating system, with madvise() or, if it is
+ * pinned or reserved huge pages, by freeing it with virg_db_slotfree(). This
+ * fails, changing nothing, if any of these tablets is locked or being read or
+ * written.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param budget	Bytes of memory that the tablet slots may use
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_resize(virginian *v, size_t budget)
+{
+	unsigned i, count;
+	int failed = 0;
+
+	// the number of slots is worked out once they have a size
+	if(v->slot_size == 0) {
+		v->mem_budget = budget;
+		return VIRG_SUCCESS;
+	}
+
+	size_t n = budget / v->slot_size;
+	count = (unsigned)VIRG_MIN(VIRG_MAX(n, VIRG_MEM_MIN_TABLETS),
+		VIRG_MEM_TABLETS);
+
+	pthread_mutex_lock(&v->slot_lock);
+
+	// claim the tablets in the slots being removed so that they can't be
+	// locked, giving up if one already is
+	for(i = count; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0 &&
+			!VIRG_ATOMIC_CAS(v->tablet_slot_status[i], 1, VIRG_SLOT_CLAIMED))
+			break;
+
+	// write the claimed tablets, which is only needed if they have changed
+	if(i == VIRG_MEM_TABLETS) {
+		for(i = count; i < VIRG_MEM_TABLETS && !failed; i++)
+			if(v->tablet_slot_status[i] != 0)
+				failed = virg_db_write(v, i) == VIRG_FAIL;
+		i = VIRG_MEM_TABLETS;
+	}
+	else
+		failed = 1;
+
+	// let go of the claimed tablets if they have to stay
+	if(failed) {
+		while(i-- > count)
+			if(v->tablet_slot_status[i] == VIRG_SLOT_CLAIMED)
+				v->tablet_slot_status[i] = 1;
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Could not empty the tablet slots being removed")
+	}
+
+	for(i = count; i < VIRG_MEM_TABLETS; i++) {
+		// empty the slot
+		if(v->tablet_slot_status[i] != 0) {
+			virg_index_remove(&v->slot_index, v->tablet_slot_ids[i]);
+			v->tablet_slot_status[i] = 0;
+			v->tablet_slots_taken--;
+		}
+
+		// give its memory back, keeping the mapping if it isn't pinned and can
+		// be emptied
+		if(v->tablet_slot_alloc[i] == NULL)
+			continue;
+#ifdef VIRG_NOPINNED
+		if(v->tablet_slot_pages[i] != VIRG_PAGES_HUGETLB) {
+			madvise(v->tablet_slot_alloc[i], v->slot_size, MADV_DONTNEED);
+			v->tablet_slots[i] = v->tablet_slot_alloc[i];
+			continue;
+		}
+#endif
+		virg_db_slotfree(v, i);
+	}
+
+	// the replacement policy state depends on the number of slots
+	if(count != v->slot_count) {
+		virg_index_clear(&v->ghost_index);
+		for(i = 0; i < VIRG_2Q_GHOSTS; i++)
+			v->ghost_ids[i] = VIRG_INDEX_EMPTY;
+		v->ghost_head = 0;
+		if(v->tablet_slot_counter >= count)
+			v->tablet_slot_counter = 0;
+	}
+
+	v->slot_count = count;
+	v->mem_budget = budget;
+
+	pthread_mutex_unlock(&v->slot_lock);
+
+	return VIRG_SUCCESS;
+}
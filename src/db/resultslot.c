@@ -0,0 +1,74 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Find an empty or unlocked tablet slot in the result arena
+ *
+ * Result tablets are kept in their own tablet slots after the
+ * VIRG_MEM_TABLETS slots of data tablets, so that the results of a query never
+ * evict the tablets it is scanning and are never written to the database file.
+ * An empty slot is taken out of the first virginian.result_slots slots of the
+ * arena if there is one, giving it memory with virg_db_slotalloc(). Otherwise
+ * an unlocked result tablet is picked in clock order and spilled to the spill
+ * file with virg_db_spill(), from which virg_db_read() reads it back when it
+ * is next loaded. Only if every result tablet is locked is the arena grown, up
+ * to VIRG_RESULT_TABLETS slots. Like virg_db_findslot(), the returned slot has
+ * a status of VIRG_SLOT_CLAIMED and the tablet slot mutex must be held. The
+ * arena isn't part of the memory budget, the replacement policy or
+ * virginian.tablet_slots_taken.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param slot Pointer to an unsigned integer through which the found slot will
+ * be returned
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_resultslot(virginian *v, unsigned *slot_)
+{
+	unsigned i, slot;
+	unsigned count = VIRG_MIN(VIRG_MAX(v->result_slots, 1),
+		VIRG_RESULT_TABLETS);
+
+	for(i = 0; i < count; i++)
+		if(v->tablet_slot_status[VIRG_MEM_TABLETS + i] == 0)
+			break;
+
+	// spill the next unlocked result tablet if the arena is full
+	if(i == count) {
+		for(i = 0; i < count; i++) {
+			slot = VIRG_MEM_TABLETS + (v->result_slot_counter + i) % count;
+			if(VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], 1,
+				VIRG_SLOT_CLAIMED))
+				break;
+		}
+
+		if(i < count) {
+			v->result_slot_counter = (slot - VIRG_MEM_TABLETS + 1) % count;
+			virg_index_remove(&v->slot_index, v->tablet_slot_ids[slot]);
+			if(virg_db_spill(v, slot) == VIRG_FAIL) {
+				v->tablet_slot_status[slot] = 0;
+				VIRG_CHECK(1, "Could not spill result tablet")
+			}
+
+			slot_[0] = slot;
+			return VIRG_SUCCESS;
+		}
+
+		// every result tablet is locked, so go past the arena's usual size
+		for(i = count; i < VIRG_RESULT_TABLETS; i++)
+			if(v->tablet_slot_status[VIRG_MEM_TABLETS + i] == 0)
+				break;
+		VIRG_CHECK(i == VIRG_RESULT_TABLETS, "All result tablets locked")
+	}
+
+	slot = VIRG_MEM_TABLETS + i;
+	VIRG_CHECK(virg_db_slotalloc(v, slot) == VIRG_FAIL,
+		"Could not allocate tablet slot")
+
+	// claim the slot, empty slots can't be locked so no atomics needed
+	v->tablet_slot_status[slot] = VIRG_SLOT_CLAIMED;
+	slot_[0] = slot;
+
+	return VIRG_SUCCESS;
+}
+
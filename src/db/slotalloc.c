@@ -0,0 +1,162 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE, syscall()
+#include "virginian.h"
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+/**
+ * Map memory for a tablet slot backed by huge pages, reserved ones if there are
+ * any, otherwise transparent huge pages, returning NULL if neither can be had
+ */
+static void *slotalloc_huge(size_t size, virg_pages *pages)
+{
+	void *p;
+
+#ifdef MAP_HUGETLB
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if(p != MAP_FAILED) {
+		pages[0] = VIRG_PAGES_HUGETLB;
+		return p;
+	}
+#endif
+
+#ifdef MADV_HUGEPAGE
+	// transparent huge pages must be aligned, so map an extra huge page and
+	// trim the mapping to a huge page boundary
+	size_t len = size + VIRG_HUGE_PAGE;
+	char *m = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(m == MAP_FAILED)
+		return NULL;
+
+	char *start = (char*)(((size_t)m + VIRG_HUGE_PAGE - 1) &
+		~(size_t)(VIRG_HUGE_PAGE - 1));
+	if(start > m)
+		munmap(m, start - m);
+	munmap(start + size, m + len - (start + size));
+
+	if(madvise(start, size, MADV_HUGEPAGE) == 0) {
+		pages[0] = VIRG_PAGES_THP;
+		return start;
+	}
+	munmap(start, size);
+#endif
+
+	(void)pages;
+	return NULL;
+}
+
+/**
+ * Ask for the memory of a tablet slot to be placed on the NUMA node that the
+ * slot belongs to, before the memory is first touched. This is only a
+ * preference, so the memory is placed elsewhere if the node is full, and
+ * nothing is done if the policy can't be set
+ */
+static void slotalloc_bind(virginian *v, void *p, unsigned slot)
+{
+#ifdef SYS_mbind
+	if(!v->use_numa || v->numa_nodes < 2)
+		return;
+
+	unsigned long mask[VIRG_NUMA_CPUS / (8 * sizeof(unsigned long))];
+	unsigned node = v->numa_node_ids[VIRG_SLOT_NODE(v, slot)];
+	memset(mask, 0, sizeof(mask));
+	mask[node / (8 * sizeof(unsigned long))] |=
+		1UL << (node % (8 * sizeof(unsigned long)));
+
+	syscall(SYS_mbind, p, v->slot_size, MPOL_PREFERRED, mask,
+		8 * sizeof(mask), 0);
+#else
+	(void)v; (void)p; (void)slot;
+#endif
+}
+
+/**
+ * @ingroup database
+ * @brief Give a tablet slot its memory if it doesn't have any yet
+ *
+ * Tablet slots are given their memory the first time that they are used by
+ * virg_db_findslot(), so that only as much memory as the tablets in use need
+ * is taken from the memory budget. The memory is an anonymous mapping, placed
+ * on the NUMA node of the slot given by VIRG_SLOT_NODE() if
+ * virginian.use_numa is set, and then pinned with cudaHostRegister() unless
+ * Virginian is compiled with VIRG_NOPINNED, in which case virg_db_resize() can
+ * give the memory back to the operating system while keeping the mapping for
+ * when the slot is used again.
+ *
+ * If virginian.use_hugepages is set and the tablet size is a multiple of
+ * VIRG_HUGE_PAGE, slots are backed by huge pages reserved with MAP_HUGETLB,
+ * or failing that by transparent huge pages. This cuts the TLB misses of
+ * scans striding across columns. When neither is available, normal pages are
+ * used. The kind of memory that each slot got is noted in
+ * virginian.tablet_slot_pages. The slot is also given the requests and memory
+ * ranges of its transfers, see virg_slot_io. The tablet slot mutex must be
+ * held.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param slot	The tablet slot
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_slotalloc(virginian *v, unsigned slot)
+{
+	virg_pages pages = VIRG_PAGES_SMALL;
+	void *p = NULL;
+
+	if(v->tablet_slot_alloc[slot] != NULL)
+		return VIRG_SUCCESS;
+
+	if(v->tablet_slot_io[slot] == NULL) {
+		v->tablet_slot_io[slot] = malloc(sizeof(virg_slot_io));
+		VIRG_CHECK(v->tablet_slot_io[slot] == NULL, "Out of memory")
+		v->tablet_slot_io[slot]->v = v;
+		v->tablet_slot_io[slot]->slot = slot;
+	}
+
+	// pinning the memory needs the cuda device set up
+#ifndef VIRG_NOPINNED
+	VIRG_CHECK(virg_vm_gpuinit(v) == VIRG_FAIL, "Could not set up CUDA")
+#endif
+
+	if(v->use_hugepages && v->slot_size % VIRG_HUGE_PAGE == 0)
+		p = slotalloc_huge(v->slot_size, &pages);
+
+	if(p != NULL)
+		slotalloc_bind(v, p, slot);
+
+	// if pinned, then pin the huge pages, now that they have been placed
+#ifndef VIRG_NOPINNED
+	if(p != NULL && cudaHostRegister(p, v->slot_size,
+		cudaHostRegisterMapped) != cudaSuccess) {
+		munmap(p, v->slot_size);
+		p = NULL;
+	}
+#endif
+
+	if(p == NULL) {
+		pages = VIRG_PAGES_SMALL;
+		p = mmap(NULL, v->slot_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		VIRG_CHECK(p == MAP_FAILED, "Problem allocating tablet memory")
+		slotalloc_bind(v, p, slot);
+
+#ifndef VIRG_NOPINNED
+		cudaError_t r = cudaHostRegister(p, v->slot_size,
+			cudaHostRegisterMapped);
+		if(r != cudaSuccess)
+			munmap(p, v->slot_size);
+		VIRG_CHECK(r != cudaSuccess, "Allocating pinned tablet memory")
+#endif
+	}
+
+	v->tablet_slot_alloc[slot] = p;
+	v->tablet_slots[slot] = p;
+	v->tablet_slot_pages[slot] = pages;
+
+#ifdef VIRG_DEBUG
+	// zero out memory for debugging
+	memset(v->tablet_slots[slot], 0xDEADBEEF, v->slot_size);
+#endif
+
+	return VIRG_SUCCESS;
+}
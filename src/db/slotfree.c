@@ -0,0 +1,37 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Free the memory of a tablet slot
+ *
+ * Frees the memory given to a tablet slot by virg_db_slotalloc() in the way
+ * that it was allocated, along with its transfer state, leaving the slot to be
+ * given memory again when it is next used. Nothing is done if the slot has no
+ * memory. The slot must be empty.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param slot	The tablet slot
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_slotfree(virginian *v, unsigned slot)
+{
+	void *p = v->tablet_slot_alloc[slot];
+
+	if(p == NULL)
+		return VIRG_SUCCESS;
+
+#ifndef VIRG_NOPINNED
+	// slots are pinned once mapped
+	VIRG_CHECK(cudaHostUnregister(p) != cudaSuccess, "Problem freeing slot")
+#endif
+	munmap(p, v->slot_size);
+
+	free(v->tablet_slot_io[slot]);
+	v->tablet_slot_io[slot] = NULL;
+	v->tablet_slot_alloc[slot] = NULL;
+	v->tablet_slots[slot] = NULL;
+	v->tablet_slot_pages[slot] = VIRG_PAGES_NONE;
+
+	return VIRG_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Size the tablet slots for tablets of a given size
+ *
+ * Frees the memory of every tablet slot that has been given memory with
+ * virg_db_slotalloc() for tablets of another size, including those of the
+ * result arena, so that the slots are given memory for tablets of size bytes
+ * when they are next used, and frees the GPU tablet slots so that
+ * virg_vm_gpuinit() allocates them to match. The number of slots in use is
+ * then worked out from the memory budget with virg_db_resize(). Nothing is
+ * done if the slots already have this size, and a size of 0 frees them. This
+ * is called by virg_init() with virginian.tablet_size and by virg_db_create()
+ * and virg_db_open() with the tablet size of the database, so it must only be
+ * called when no tablets are in the tablet slots.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param size	Size of the tablets to be held, or 0
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_slots(virginian *v, size_t size)
+{
+	unsigned i;
+
+	if(v->slot_size == size)
+		return VIRG_SUCCESS;
+
+	// free each tablet slot
+	for(i = 0; i < VIRG_TABLET_SLOTS; i++)
+		VIRG_CHECK(virg_db_slotfree(v, i) == VIRG_FAIL, "Problem freeing slot")
+
+#ifndef VIRG_NOCUDA
+	// free gpu slots, virg_vm_gpuinit() allocates them again when needed
+	if(v->gpu_slots != NULL) {
+		VIRG_CHECK(cudaFree(v->gpu_slots) != cudaSuccess, "Problem freeing slot")
+		v->gpu_slots = NULL;
+	}
+#endif
+
+	v->slot_size = size;
+
+	if(size == 0)
+		return VIRG_SUCCESS;
+
+	// as many tablets of this size as fit in the memory budget
+	return virg_db_resize(v, v->mem_budget);
+}
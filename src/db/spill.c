@@ -0,0 +1,50 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Write the result tablet in a tablet slot to the spill file
+ *
+ * Used by virg_db_resultslot() to make room in the result arena. Result
+ * tablets are written to their own place in the spill file opened by
+ * virg_db_spillopen(), never to the database file, taking a place off the
+ * stack of unused places or adding one to the end of the file. A result
+ * tablet keeps its place until it is removed with virg_tablet_remove(), so a
+ * tablet that hasn't changed since it was read back isn't written again.
+ * The tablet slot mutex must be held.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param slot The number of the tablet slot to be spilled
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_spill(virginian *v, unsigned slot)
+{
+	virg_tablet_meta *tab = v->tablet_slots[slot];
+	unsigned place;
+
+	if(!v->tablet_slot_dirty[slot])
+		return VIRG_SUCCESS;
+
+	if(virg_index_find(&v->spill_index, tab->id, &place) == VIRG_FAIL) {
+		if(v->spill_free_count > 0)
+			place = v->spill_free[--v->spill_free_count];
+		else {
+			// the stack must be able to hold every place in the file
+			unsigned *p = (unsigned*)realloc(v->spill_free,
+				(v->spill_slots + 1) * sizeof(unsigned));
+			VIRG_CHECK(p == NULL, "Out of memory")
+			v->spill_free = p;
+			place = v->spill_slots++;
+		}
+		virg_index_insert(&v->spill_index, tab->id, place);
+	}
+
+	ssize_t r = pwrite(v->spillfd, tab, tab->size,
+		(off_t)place * v->db.tablet_size);
+	VIRG_CHECK(r < (ssize_t)tab->size, "Failed to spill result tablet")
+
+	v->tablet_slot_dirty[slot] = 0;
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,41 @@
+#include "virginian.h"
+
+/**
+ * @ingroup database
+ * @brief Open the spill file of result tablets
+ *
+ * Result tablets that don't fit into the result arena are written by
+ * virg_db_spill() to a file named after the database file with a .spill
+ * suffix, so that they never take disk slots in the database file. The file is
+ * removed as soon as it is opened, since results don't outlive the database
+ * being open, and it is closed by virg_db_close().
+ *
+ * @param v	Pointer to the state struct of the database system
+ * @param file	Path of the database file
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_db_spillopen(virginian *v, const char *file)
+{
+	size_t n = strlen(file);
+	char *path = (char*)malloc(n + sizeof(".spill"));
+	VIRG_CHECK(path == NULL, "Out of memory")
+
+	memcpy(path, file, n);
+	memcpy(path + n, ".spill", sizeof(".spill"));
+
+	v->spillfd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if(v->spillfd != -1)
+		unlink(path);
+	free(path);
+	VIRG_CHECK(v->spillfd == -1, "Problem opening spill file")
+
+	VIRG_CHECK(virg_index_init(&v->spill_index, VIRG_INDEX_INITIAL_SIZE) ==
+		VIRG_FAIL, "Could not init spill index")
+	v->spill_free = NULL;
+	v->spill_free_count = 0;
+	v->spill_slots = 0;
+
+	return VIRG_SUCCESS;
+}
+
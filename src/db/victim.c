@@ -0,0 +1,144 @@
+#include "virginian.h"
+
+/**
+ * Claim the oldest unlocked tablet in the 2Q probationary queue, or in every
+ * slot if queue is -1, returning VIRG_FAIL if there is none
+ */
+static int victim_fifo(virginian *v, int queue, unsigned *slot_)
+{
+	unsigned i, slot = 0;
+	int found = 0;
+
+	// the tablets can be locked concurrently, so this can only be a guess at
+	// the oldest, and it has to be claimed atomically afterwards
+	while(1) {
+		for(i = 0; i < v->slot_count; i++)
+			if(v->tablet_slot_status[i] == 1 &&
+				(queue == -1 || v->tablet_slot_queue[i] == queue) &&
+				(!found || v->tablet_slot_age[i] < v->tablet_slot_age[slot])) {
+				slot = i;
+				found = 1;
+			}
+
+		if(!found)
+			return VIRG_FAIL;
+
+		if(VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], 1, VIRG_SLOT_CLAIMED))
+			break;
+		found = 0;
+	}
+
+	slot_[0] = slot;
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Advance the clock hand over the slots in a 2Q queue, or every slot if queue
+ * is -1, clearing reference bits until an unreferenced unlocked tablet is
+ * claimed, returning VIRG_FAIL after two sweeps without finding one
+ */
+static int victim_clock(virginian *v, int queue, unsigned *slot_)
+{
+	unsigned checked;
+	unsigned slot = v->tablet_slot_counter;
+
+	for(checked = 0; checked < 2 * v->slot_count; checked++) {
+		if(v->tablet_slot_status[slot] == 1 &&
+			(queue == -1 || v->tablet_slot_queue[slot] == queue)) {
+			// give referenced tablets a second chance
+			if(v->tablet_slot_ref[slot])
+				v->tablet_slot_ref[slot] = 0;
+			else if(VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], 1,
+				VIRG_SLOT_CLAIMED)) {
+				v->tablet_slot_counter = (slot + 1) % v->slot_count;
+				slot_[0] = slot;
+				return VIRG_SUCCESS;
+			}
+		}
+		slot = (slot + 1) % v->slot_count;
+	}
+
+	v->tablet_slot_counter = slot;
+	return VIRG_FAIL;
+}
+
+/**
+ * @ingroup database
+ * @brief Choose an unlocked tablet to evict from a full set of tablet slots
+ *
+ * Picks the tablet slot to evict according to virginian.slot_policy and claims
+ * it by setting its status to VIRG_SLOT_CLAIMED. With VIRG_RR, the first
+ * unlocked slot after the round-robin counter is used. With VIRG_CLOCK, the
+ * counter is used as a clock hand that clears reference bits until it reaches
+ * an unreferenced tablet. With VIRG_2Q, newly loaded tablets wait in a
+ * probationary FIFO queue which is evicted from first once it holds more than
+ * a quarter of the slots in use, so a long scan only cycles through these slots
+ * rather than flushing the main queue, which is managed with the clock. The ids
+ * of tablets evicted from the probationary queue are remembered so that
+ * virg_db_admit() can place them directly in the main queue if they return.
+ * This function does not write the evicted tablet, and like
+ * virg_db_findslot(), the tablet slot mutex must be held while calling it.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @param slot_ Pointer through which the claimed slot is returned
+ * @return VIRG_SUCCESS or VIRG_FAIL if every tablet is locked
+ */
+int virg_db_victim(virginian *v, unsigned *slot_)
+{
+	unsigned i, slot, probation = 0;
+	int r = VIRG_FAIL;
+
+	if(v->slot_policy == VIRG_RR) {
+		slot = v->tablet_slot_counter;
+
+		// search for an occupied but unlocked tablet, claiming it atomically
+		// since other threads can lock tablets without holding the slot mutex
+		for(i = 0; i < v->slot_count; i++, slot = (slot + 1) % v->slot_count)
+			if(VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], 1, VIRG_SLOT_CLAIMED)) {
+				r = VIRG_SUCCESS;
+				break;
+			}
+
+		// move the counter to the slot after the starting location
+		v->tablet_slot_counter = (v->tablet_slot_counter + 1) % v->slot_count;
+	}
+	else if(v->slot_policy == VIRG_CLOCK) {
+		r = victim_clock(v, -1, &slot);
+	}
+	else {
+		for(i = 0; i < v->slot_count; i++)
+			if(v->tablet_slot_status[i] != 0 && v->tablet_slot_queue[i] == 0)
+				probation++;
+
+		// take from the probationary queue if it's too big, otherwise from the
+		// main queue, then from whatever is left
+		if(probation > VIRG_2Q_PROBATION(v->slot_count))
+			r = victim_fifo(v, 0, &slot);
+		if(r == VIRG_FAIL)
+			r = victim_clock(v, 1, &slot);
+		if(r == VIRG_FAIL)
+			r = victim_fifo(v, 0, &slot);
+	}
+
+	if(r == VIRG_FAIL)
+		return VIRG_FAIL;
+
+	// remember the ids of tablets evicted while on probation
+	if(v->tablet_slot_queue[slot] == 0) {
+		unsigned pos;
+		unsigned old = v->ghost_ids[v->ghost_head];
+		if(old != VIRG_INDEX_EMPTY &&
+			virg_index_find(&v->ghost_index, old, &pos) == VIRG_SUCCESS &&
+			pos == v->ghost_head)
+			virg_index_remove(&v->ghost_index, old);
+
+		v->ghost_ids[v->ghost_head] = v->tablet_slot_ids[slot];
+		virg_index_insert(&v->ghost_index, v->tablet_slot_ids[slot],
+			v->ghost_head);
+		v->ghost_head = (v->ghost_head + 1) % (v->slot_count / 2);
+	}
+
+	slot_[0] = slot;
+	return VIRG_SUCCESS;
+}
+
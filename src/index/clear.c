@@ -0,0 +1,21 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Remove every entry from a tablet index
+ *
+ * Marks every bucket of the index as empty without changing its size. This is
+ * used when the index must be rebuilt from scratch, such as when the disk slots
+ * of the database file are reorganized.
+ *
+ * @param idx	Pointer to the index to be cleared
+ */
+void virg_index_clear(virg_index *idx)
+{
+	unsigned i;
+
+	for(i = 0; i < idx->size; i++)
+		idx->keys[i] = VIRG_INDEX_EMPTY;
+	idx->used = 0;
+}
+
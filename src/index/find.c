@@ -0,0 +1,31 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Look up the slot associated with a tablet id
+ *
+ * Probes the index starting at the home bucket of the key until either the key
+ * or an empty bucket is found. Because the index is never more than half full,
+ * the probe sequence is short. Unlike most functions, a failure here is not an
+ * error and nothing is printed, it only means the tablet is not in the index.
+ *
+ * @param idx	Pointer to the index to search
+ * @param key	Tablet id to look for
+ * @param val	Pointer through which the associated slot is returned if found
+ * @return VIRG_SUCCESS if the key was found, VIRG_FAIL otherwise
+ */
+int virg_index_find(virg_index *idx, unsigned key, unsigned *val)
+{
+	unsigned mask = idx->size - 1;
+	unsigned i = VIRG_INDEX_HASH(key, mask);
+
+	for( ; idx->keys[i] != VIRG_INDEX_EMPTY; i = (i + 1) & mask)
+		if(idx->keys[i] == key) {
+			if(val != NULL)
+				val[0] = idx->vals[i];
+			return VIRG_SUCCESS;
+		}
+
+	return VIRG_FAIL;
+}
+
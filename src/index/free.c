@@ -0,0 +1,21 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Free the allocations of a tablet index
+ *
+ * Frees the bucket arrays allocated in virg_index_init(). The index must be
+ * initialized again before it is used after this call.
+ *
+ * @param idx	Pointer to the index to be freed
+ */
+void virg_index_free(virg_index *idx)
+{
+	free(idx->keys);
+	free(idx->vals);
+	idx->keys = NULL;
+	idx->vals = NULL;
+	idx->size = 0;
+	idx->used = 0;
+}
+
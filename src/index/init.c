@@ -0,0 +1,36 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Allocate an empty tablet index
+ *
+ * Allocates the bucket arrays of a tablet index and marks every bucket as
+ * empty. The size is rounded up to a power of 2 so that bucket numbers can be
+ * found with a mask. The allocations made here are freed with
+ * virg_index_free().
+ *
+ * @param idx	Pointer to the index to be initialized
+ * @param size	Initial number of buckets
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_index_init(virg_index *idx, unsigned size)
+{
+	unsigned i;
+
+	// round the number of buckets up to a power of 2
+	idx->size = 1;
+	while(idx->size < size)
+		idx->size <<= 1;
+	idx->used = 0;
+
+	idx->keys = (unsigned*)malloc(idx->size * sizeof(unsigned));
+	idx->vals = (unsigned*)malloc(idx->size * sizeof(unsigned));
+	VIRG_CHECK(idx->keys == NULL || idx->vals == NULL, "Out of memory")
+
+	for(i = 0; i < idx->size; i++)
+		idx->keys[i] = VIRG_INDEX_EMPTY;
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,55 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Associate a tablet id with a slot
+ *
+ * Adds a key to the index, or replaces the value if the key is already present.
+ * If adding the key would make the index more than half full, the number of
+ * buckets is doubled and every entry is re-inserted into the larger arrays.
+ *
+ * @param idx	Pointer to the index
+ * @param key	Tablet id, which can not be VIRG_INDEX_EMPTY
+ * @param val	Slot to associate with the tablet id
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_index_insert(virg_index *idx, unsigned key, unsigned val)
+{
+	unsigned i, mask;
+
+	VIRG_DEBUG_CHECK(key == VIRG_INDEX_EMPTY, "Invalid index key")
+
+	// grow the index if it would become more than half full
+	if((idx->used + 1) * 2 > idx->size) {
+		virg_index old = idx[0];
+
+		VIRG_CHECK(virg_index_init(idx, old.size * 2) == VIRG_FAIL,
+			"Could not grow index")
+
+		for(i = 0; i < old.size; i++)
+			if(old.keys[i] != VIRG_INDEX_EMPTY)
+				virg_index_insert(idx, old.keys[i], old.vals[i]);
+
+		virg_index_free(&old);
+	}
+
+	// probe for the key or the first empty bucket
+	mask = idx->size - 1;
+	for(i = VIRG_INDEX_HASH(key, mask); idx->keys[i] != VIRG_INDEX_EMPTY;
+		i = (i + 1) & mask)
+		if(idx->keys[i] == key) {
+			idx->vals[i] = val;
+			return VIRG_SUCCESS;
+		}
+
+	// set the value first, the slot index is read without a lock and the key
+	// must never be visible next to a stale value
+	idx->vals[i] = val;
+	__sync_synchronize();
+	idx->keys[i] = key;
+	idx->used++;
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,46 @@
+#include "virginian.h"
+
+/**
+ * @ingroup index
+ * @brief Remove a tablet id from the index
+ *
+ * Removes a key from the index if it is present. Rather than leaving a marker
+ * in the emptied bucket, the following entries in the probe run are shifted
+ * back into it when their home bucket allows, so lookups never have to skip
+ * over deleted buckets.
+ *
+ * @param idx	Pointer to the index
+ * @param key	Tablet id to remove
+ * @return VIRG_SUCCESS if the key was removed, VIRG_FAIL if it wasn't found
+ */
+int virg_index_remove(virg_index *idx, unsigned key)
+{
+	unsigned mask = idx->size - 1;
+	unsigned i, j, home;
+
+	// find the bucket holding the key
+	for(i = VIRG_INDEX_HASH(key, mask); idx->keys[i] != key;
+		i = (i + 1) & mask)
+		if(idx->keys[i] == VIRG_INDEX_EMPTY)
+			return VIRG_FAIL;
+
+	// shift back entries that would no longer be reachable across the gap
+	for(j = (i + 1) & mask; idx->keys[j] != VIRG_INDEX_EMPTY;
+		j = (j + 1) & mask) {
+		home = VIRG_INDEX_HASH(idx->keys[j], mask);
+
+		// leave the entry if its home bucket lies cyclically in (i, j]
+		if(i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+
+		idx->vals[i] = idx->vals[j];
+		idx->keys[i] = idx->keys[j];
+		i = j;
+	}
+
+	idx->keys[i] = VIRG_INDEX_EMPTY;
+	idx->used--;
+
+	return VIRG_SUCCESS;
+}
+
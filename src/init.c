@@ -7,10 +7,14 @@
  * Initializes or re-initializes the struct that holds the
  * state of the database. It sets a number of options via defaults hard-coded or
  * defined in virginian.h. Additionally, this function is responsible for
- * allocating the tablet memory areas in both main memory and GPU memory. If the
- * VIRG_DEBUG macro is defined, both the state struct and the tablet memory
- * areas are set to 0xDEADBEEF. Finally, this function also initializes the CUDA
- * context. The allocations made in this function are freed with virg_close().
+ * sizing the tablet memory areas in main memory with virg_db_slots(), which
+ * are only allocated as they are used, up to the VIRG_MEM_BUDGET memory budget
+ * that virg_db_resize() can change, and the slots of the result arena after
+ * them, see virg_db_resultslot(). If the VIRG_DEBUG macro is defined, both
+ * the state struct and the tablet memory areas are set to 0xDEADBEEF. No CUDA
+ * calls are made here, the CUDA context and the GPU tablet memory areas are
+ * only set up when they are first needed by virg_vm_gpuinit(). The allocations
+ * made in this function are freed with virg_close().
  *
  * @param v Pointer to the state struct of the database system
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
@@ -18,9 +22,7 @@
  */
 int virg_init(virginian *v)
 {
-	int i;
-
-	cudaError_t r;
+	int i, j;
 
 #ifdef VIRG_DEBUG
 	// zero out db struct for valgrind
@@ -30,55 +32,112 @@ int virg_init(virginian *v)
 	// set struct defaults
 	v->tablet_slot_counter = 0;
 	v->tablet_slots_taken = 0;
+	v->slot_policy = VIRG_SLOT_POLICY;
+	v->tablet_age_counter = 0;
+	v->tablet_hits = 0;
+	v->tablet_misses = 0;
+	v->disk_writes = 0;
 	v->threads_per_block = VIRG_THREADSPERBLOCK;
 	v->multi_threads = VIRG_MULTITHREADS;
 	v->use_multi = 0;
 	v->use_gpu = 0;
 	v->use_stream = 0;
 	v->use_mmap = 0;
+	v->use_filemap = 0;
+	v->use_hugepages = 0;
+	v->use_numa = 1;
+	v->tablet_size = VIRG_TABLET_SIZE;
+	v->readahead = VIRG_READAHEAD;
+	v->prefetch_running = 0;
+	v->prefetch_node = 0;
+	v->scans = 0;
+	v->joining = 0;
 	v->dbfd = -1;
+	v->bloomfd = -1;
+	v->spillfd = -1;
+	v->dbmap = NULL;
+	v->disk_free = NULL;
+	v->disk_free_count = 0;
+
+	// index of the tablets in memory, sized so that it never grows
+	VIRG_CHECK(virg_index_init(&v->slot_index, VIRG_TABLET_SLOTS * 2) ==
+		VIRG_FAIL, "Could not init slot index")
+	v->disk_index.keys = NULL;
+	v->disk_index.vals = NULL;
+	v->spill_index.keys = NULL;
+	v->spill_index.vals = NULL;
+	v->spill_free = NULL;
+	v->spill_free_count = 0;
+	v->spill_slots = 0;
+
+	// nothing has been evicted yet
+	VIRG_CHECK(virg_index_init(&v->ghost_index, VIRG_2Q_GHOSTS * 2) ==
+		VIRG_FAIL, "Could not init ghost index")
+	for(i = 0; i < VIRG_2Q_GHOSTS; i++)
+		v->ghost_ids[i] = VIRG_INDEX_EMPTY;
+	v->ghost_head = 0;
 
 	// init mutex for locking tablet slots
 	VIRG_CHECK(pthread_mutex_init(&v->slot_lock, NULL), "Could not init mutex")
+	VIRG_CHECK(pthread_cond_init(&v->slot_cond, NULL), "Could not init cond")
 
-	// set proper flags, first one enables mapped memory
-	cudaSetDeviceFlags(cudaDeviceMapHost | cudaDeviceScheduleSpin | cudaDeviceScheduleBlockingSync);
-	VIRG_CUDCHK("set device flags");
+	// init the locks of inserts, no thread has been given an append lane
+	VIRG_CHECK(pthread_mutex_init(&v->append_lock, NULL),
+		"Could not init mutex")
+	for(i = 0; i < VIRG_MAX_TABLES; i++)
+		for(j = 0; j < VIRG_APPEND_LANES; j++) {
+			VIRG_CHECK(pthread_mutex_init(&v->append_lane_lock[i][j], NULL),
+				"Could not init mutex")
+			v->append_session[i][j] = 0;
+		}
+	memset(v->append_tablet, 0xFF, sizeof(v->append_tablet));
+	v->append_lane_counter = 0;
 
-	// initialize cuda context
-	cudaSetDevice(VIRG_CUDADEVICE);
-	VIRG_CUDCHK("set device");
+	// init the read-ahead queue, the prefetch thread starts when it's needed
+	VIRG_CHECK(pthread_mutex_init(&v->prefetch_lock, NULL),
+		"Could not init mutex")
+	VIRG_CHECK(pthread_cond_init(&v->prefetch_cond, NULL), "Could not init cond")
+	VIRG_CHECK(virg_index_init(&v->prefetch_next, VIRG_MEM_TABLETS * 2) ==
+		VIRG_FAIL, "Could not init prefetch index")
 
-	// initialize tablets
-	for(i = 0; i < VIRG_MEM_TABLETS; i++) {
-		v->tablet_slot_status[i] = 0;
+	// start the threads that read and write tablets
+	VIRG_CHECK(virg_io_init(&v->io) == VIRG_FAIL, "Could not start I/O")
 
-		// if pinned, then use cuda alloc
-#ifndef VIRG_NOPINNED
-		r = cudaHostAlloc((void**)&v->tablet_slots[i], VIRG_TABLET_SIZE, cudaHostAllocMapped);
-		VIRG_CUDCHK("Allocating pinned tablet memory");
-#else
-		v->tablet_slots[i] = malloc(VIRG_TABLET_SIZE);
-		VIRG_CHECK(v->tablet_slots[i] == NULL, "Problem allocating tablet memory");
-#endif
+	// initialize tablets, including those of the result arena
+	for(i = 0; i < VIRG_TABLET_SLOTS; i++) {
+		v->tablet_slot_status[i] = 0;
+		v->tablet_slot_waiters[i] = 0;
+		v->tablet_slot_dirty[i] = 0;
+		v->tablet_slot_cols[i] = VIRG_ALL_COLUMNS;
+		v->tablet_slot_pending[i] = 0;
+		v->tablet_slot_failed[i] = 0;
+		v->tablet_slot_alloc[i] = NULL;
+		v->tablet_slot_io[i] = NULL;
+		v->tablet_slots[i] = NULL;
+		v->tablet_slot_pages[i] = VIRG_PAGES_NONE;
 
 #ifdef VIRG_DEBUG
 		// this should only be read when status is nonzero
 		v->tablet_slot_ids[i] = 0;
-
-		// zero out memory for debugging
-		memset(v->tablet_slots[i], 0xDEADBEEF, VIRG_TABLET_SIZE);
 #endif
 	}
 
-	if(VIRG_GPU_TABLETS > 0) {
-		// initialize gpu tablets as a single block
-		r = cudaMalloc((void**)&v->gpu_slots, VIRG_TABLET_SIZE * VIRG_GPU_TABLETS);
-		VIRG_CHECK(r != cudaSuccess, "Problem allocating GPU tablet memory");
-#ifdef VIRG_DEBUG
-		cudaMemset(v->gpu_slots, 0xDEADBEEF, VIRG_TABLET_SIZE * VIRG_GPU_TABLETS);
-#endif
-	}
+	// find the numa nodes that slots and threads are spread across
+	VIRG_CHECK(virg_db_numa(v) == VIRG_FAIL, "Could not find NUMA nodes")
+
+	// size the slots for the default tablet size, they are resized if a
+	// database with another tablet size is opened, and only given memory when
+	// they are used
+	v->gpu_slots = NULL;
+	v->gpu_ready = 0;
+	v->slot_size = 0;
+	v->slot_count = 0;
+	v->mem_budget = VIRG_MEM_BUDGET;
+	v->result_slots = VIRG_RESULT_SLOTS;
+	v->result_slot_counter = 0;
+	v->result_id_counter = 0;
+	VIRG_CHECK(virg_db_slots(v, v->tablet_size) == VIRG_FAIL,
+		"Could not size tablet slots")
 
 	return VIRG_SUCCESS;
 }
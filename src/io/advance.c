@@ -0,0 +1,29 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Account for part of a request having been transferred
+ *
+ * Adds the bytes transferred to the request's result and moves its memory
+ * ranges past them, so that a short transfer can be continued by submitting
+ * what is left of the ranges at the request's offset plus its result.
+ *
+ * @param req	Request that has made progress
+ * @param bytes	Number of bytes transferred
+ */
+void virg_io_advance(virg_io_req *req, size_t bytes)
+{
+	req->result += bytes;
+
+	while(req->iovcnt > 0 && bytes >= req->iov[0].iov_len) {
+		bytes -= req->iov[0].iov_len;
+		req->iov++;
+		req->iovcnt--;
+	}
+
+	if(req->iovcnt > 0) {
+		req->iov[0].iov_base = (char*)req->iov[0].iov_base + bytes;
+		req->iov[0].iov_len -= bytes;
+	}
+}
+
@@ -0,0 +1,25 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Finish a request on an I/O thread
+ *
+ * Called by the I/O threads once a request has been fully transferred or has
+ * failed. The request's done callback is run before the request stops being
+ * counted as in flight, so that anything the callback does is finished by the
+ * time virg_io_drain() returns.
+ *
+ * @param io	Pointer to the I/O engine
+ * @param req	Request that has completed
+ */
+void virg_io_complete(virg_io *io, virg_io_req *req)
+{
+	if(req->done != NULL)
+		req->done(req);
+
+	pthread_mutex_lock(&io->lock);
+	io->inflight--;
+	pthread_cond_broadcast(&io->idle);
+	pthread_mutex_unlock(&io->lock);
+}
+
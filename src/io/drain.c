@@ -0,0 +1,26 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Wait for every submitted request to complete
+ *
+ * Blocks until every request submitted to the I/O engine has completed and its
+ * done callback has returned. This is used to wait for a batch of transfers,
+ * such as the tablet writes made when a database is closed.
+ *
+ * @param io Pointer to the I/O engine
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_io_drain(virg_io *io)
+{
+	pthread_mutex_lock(&io->lock);
+
+	while(io->inflight > 0)
+		pthread_cond_wait(&io->idle, &io->lock);
+
+	pthread_mutex_unlock(&io->lock);
+
+	return VIRG_SUCCESS;
+}
+
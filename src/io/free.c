@@ -0,0 +1,47 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Stop the asynchronous I/O engine
+ *
+ * Waits for all submitted requests to complete, then stops the threads started
+ * by virg_io_init() and releases the io_uring instance if one was used.
+ *
+ * @param io Pointer to the I/O engine to be stopped
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_io_free(virg_io *io)
+{
+	unsigned i;
+
+	virg_io_drain(io);
+
+	pthread_mutex_lock(&io->lock);
+	io->stop = 1;
+	pthread_cond_broadcast(&io->cond);
+	pthread_mutex_unlock(&io->lock);
+
+#ifdef VIRG_IOURING
+	// the reaping thread is woken with an empty request
+	if(io->ring != -1)
+		virg_io_uring_push(io, NULL);
+#endif
+
+	for(i = 0; i < io->num_threads; i++)
+		VIRG_CHECK(pthread_join(io->threads[i], NULL),
+			"Could not join I/O thread")
+	io->num_threads = 0;
+
+#ifdef VIRG_IOURING
+	if(io->ring != -1)
+		virg_io_uring_free(io);
+#endif
+
+	VIRG_CHECK(pthread_mutex_destroy(&io->lock), "Could not destroy mutex")
+	VIRG_CHECK(pthread_cond_destroy(&io->cond), "Could not destroy cond")
+	VIRG_CHECK(pthread_cond_destroy(&io->idle), "Could not destroy cond")
+
+	return VIRG_SUCCESS;
+}
+
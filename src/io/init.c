@@ -0,0 +1,52 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Start the asynchronous I/O engine
+ *
+ * Sets up the queue and counters of an I/O engine and starts its threads. If
+ * Virginian is compiled with VIRG_IOURING, an io_uring instance is created
+ * with virg_io_uring_init() and a single thread is started to reap its
+ * completions. If this isn't compiled in or the kernel doesn't support it,
+ * VIRG_IO_THREADS threads are started that perform queued requests with
+ * blocking reads and writes. Either way requests are submitted with
+ * virg_io_submit(). The engine is stopped with virg_io_free().
+ *
+ * @param io Pointer to the I/O engine to be started
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_io_init(virg_io *io)
+{
+	unsigned i;
+
+	io->ring = -1;
+	io->head = NULL;
+	io->tail = NULL;
+	io->inflight = 0;
+	io->stop = 0;
+	io->num_threads = 0;
+
+	VIRG_CHECK(pthread_mutex_init(&io->lock, NULL), "Could not init mutex")
+	VIRG_CHECK(pthread_cond_init(&io->cond, NULL), "Could not init cond")
+	VIRG_CHECK(pthread_cond_init(&io->idle, NULL), "Could not init cond")
+
+#ifdef VIRG_IOURING
+	// fall back to the thread pool if io_uring can't be used
+	if(virg_io_uring_init(io) == VIRG_SUCCESS) {
+		VIRG_CHECK(pthread_create(&io->threads[0], NULL, virg_io_uring_reap,
+			io), "Could not create I/O thread")
+		io->num_threads = 1;
+		return VIRG_SUCCESS;
+	}
+#endif
+
+	for(i = 0; i < VIRG_IO_THREADS; i++) {
+		VIRG_CHECK(pthread_create(&io->threads[i], NULL, virg_io_worker, io),
+			"Could not create I/O thread")
+		io->num_threads++;
+	}
+
+	return VIRG_SUCCESS;
+}
+
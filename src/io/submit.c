@@ -0,0 +1,52 @@
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Submit a read or write to the asynchronous I/O engine
+ *
+ * Starts the transfer described by a request without waiting for it. With
+ * io_uring, the request is placed on the submission ring, waiting first if
+ * VIRG_IO_DEPTH requests are already in flight. Otherwise it is added to the
+ * queue served by the thread pool. When the transfer completes the request's
+ * done callback is run on an I/O thread, and virg_io_drain() can be used to
+ * wait for every submitted request.
+ *
+ * @param io	Pointer to the I/O engine
+ * @param req	Request to be submitted, which must stay valid until it is done
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_io_submit(virg_io *io, virg_io_req *req)
+{
+	req->result = 0;
+	req->next = NULL;
+
+	pthread_mutex_lock(&io->lock);
+
+#ifdef VIRG_IOURING
+	if(io->ring != -1) {
+		// completions are reaped into a ring of the same depth, so don't
+		// overfill it
+		while(io->inflight >= io->depth)
+			pthread_cond_wait(&io->idle, &io->lock);
+		io->inflight++;
+		pthread_mutex_unlock(&io->lock);
+
+		virg_io_uring_push(io, req);
+		return VIRG_SUCCESS;
+	}
+#endif
+
+	io->inflight++;
+	if(io->tail == NULL)
+		io->head = req;
+	else
+		io->tail->next = req;
+	io->tail = req;
+	pthread_cond_signal(&io->cond);
+
+	pthread_mutex_unlock(&io->lock);
+
+	return VIRG_SUCCESS;
+}
+
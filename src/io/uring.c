@@ -0,0 +1,188 @@
+#define _GNU_SOURCE // syscall()
+#include "virginian.h"
+
+#ifdef VIRG_IOURING
+
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/// pointer to a field of a mapped io_uring ring at an offset given by the kernel
+#define VIRG_RING_FIELD(ring, off)	((volatile unsigned*)((char*)(ring) + (off)))
+
+/**
+ * @ingroup io
+ * @brief Create the io_uring instance used for asynchronous I/O
+ *
+ * Creates an io_uring instance with VIRG_IO_DEPTH entries directly through the
+ * system calls, so that no library is needed, and maps its submission and
+ * completion rings. This is only compiled with VIRG_IOURING, and if it fails
+ * virg_io_init() uses the thread pool instead.
+ *
+ * @param io Pointer to the I/O engine
+ * @return VIRG_SUCCESS or VIRG_FAIL if io_uring is not available
+ */
+int virg_io_uring_init(virg_io *io)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	int fd = syscall(__NR_io_uring_setup, VIRG_IO_DEPTH, &p);
+	if(fd < 0)
+		return VIRG_FAIL;
+
+	io->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	io->cq_ring_size = p.cq_off.cqes + p.cq_entries *
+		sizeof(struct io_uring_cqe);
+	io->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	// newer kernels map both rings with a single mapping
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		if(io->cq_ring_size > io->sq_ring_size)
+			io->sq_ring_size = io->cq_ring_size;
+		io->cq_ring_size = io->sq_ring_size;
+	}
+
+	io->sq_ring = mmap(NULL, io->sq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	io->cq_ring = io->sq_ring;
+	if(io->sq_ring != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP))
+		io->cq_ring = mmap(NULL, io->cq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if(io->sq_ring == MAP_FAILED || io->cq_ring == MAP_FAILED ||
+		io->sqes == MAP_FAILED) {
+		close(fd);
+		return VIRG_FAIL;
+	}
+
+	io->sq_tail = VIRG_RING_FIELD(io->sq_ring, p.sq_off.tail);
+	io->sq_mask = VIRG_RING_FIELD(io->sq_ring, p.sq_off.ring_mask);
+	io->sq_array = VIRG_RING_FIELD(io->sq_ring, p.sq_off.array);
+	io->cq_head = VIRG_RING_FIELD(io->cq_ring, p.cq_off.head);
+	io->cq_tail = VIRG_RING_FIELD(io->cq_ring, p.cq_off.tail);
+	io->cq_mask = VIRG_RING_FIELD(io->cq_ring, p.cq_off.ring_mask);
+	io->cqes = (char*)io->cq_ring + p.cq_off.cqes;
+	io->depth = p.sq_entries;
+	io->ring = fd;
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup io
+ * @brief Place a request on the io_uring submission ring
+ *
+ * Fills a submission queue entry for the part of the request that hasn't been
+ * transferred yet and tells the kernel about it. A NULL request is submitted
+ * as a no-op that tells the reaping thread to exit.
+ *
+ * @param io	Pointer to the I/O engine
+ * @param req	Request to be submitted, or NULL
+ */
+void virg_io_uring_push(virg_io *io, virg_io_req *req)
+{
+	pthread_mutex_lock(&io->lock);
+
+	unsigned tail = *io->sq_tail;
+	unsigned idx = tail & *io->sq_mask;
+	struct io_uring_sqe *sqe = (struct io_uring_sqe*)io->sqes + idx;
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	if(req == NULL)
+		sqe->opcode = IORING_OP_NOP;
+	else {
+		sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->fd = req->fd;
+		sqe->addr = (unsigned long)req->iov;
+		sqe->len = req->iovcnt;
+		sqe->off = req->offset + req->result;
+	}
+	sqe->user_data = (unsigned long)req;
+
+	// the entry must be visible before the tail moves past it
+	io->sq_array[idx] = idx;
+	__sync_synchronize();
+	*io->sq_tail = tail + 1;
+
+	syscall(__NR_io_uring_enter, io->ring, 1, 0, 0, NULL, 0);
+
+	pthread_mutex_unlock(&io->lock);
+}
+
+/**
+ * @ingroup io
+ * @brief Main loop of the thread reaping io_uring completions
+ *
+ * Waits for completions on the io_uring completion ring, resubmits the rest of
+ * any short transfers, and finishes completed requests with
+ * virg_io_complete(). The thread exits when the no-op submitted by
+ * virg_io_free() completes.
+ *
+ * @param arg Pointer to the I/O engine, as passed through pthread_create()
+ * @return NULL
+ */
+void *virg_io_uring_reap(void *arg)
+{
+	virg_io *io = (virg_io*)arg;
+	struct io_uring_cqe *cqes = (struct io_uring_cqe*)io->cqes;
+	unsigned mask = *io->cq_mask;
+
+	while(1) {
+		unsigned head = *io->cq_head;
+		__sync_synchronize();
+
+		// wait for the kernel to post a completion
+		if(head == *io->cq_tail) {
+			syscall(__NR_io_uring_enter, io->ring, 0, 1,
+				IORING_ENTER_GETEVENTS, NULL, 0);
+			continue;
+		}
+
+		virg_io_req *req = (virg_io_req*)(unsigned long)cqes[head & mask].user_data;
+		int res = cqes[head & mask].res;
+		__sync_synchronize();
+		*io->cq_head = head + 1;
+
+		if(req == NULL)
+			break;
+
+		// an empty request completes with nothing transferred
+		if(res < 0 || (res == 0 && req->len != 0))
+			req->result = -1;
+		else {
+			virg_io_advance(req, res);
+			if((size_t)req->result < req->len) {
+				virg_io_uring_push(io, req);
+				continue;
+			}
+		}
+
+		virg_io_complete(io, req);
+	}
+
+	return NULL;
+}
+
+/**
+ * @ingroup io
+ * @brief Release the io_uring instance
+ *
+ * Unmaps the rings and closes the io_uring instance created with
+ * virg_io_uring_init(). The reaping thread must have exited.
+ *
+ * @param io Pointer to the I/O engine
+ */
+void virg_io_uring_free(virg_io *io)
+{
+	munmap(io->sqes, io->sqes_size);
+	if(io->cq_ring != io->sq_ring)
+		munmap(io->cq_ring, io->cq_ring_size);
+	munmap(io->sq_ring, io->sq_ring_size);
+	close(io->ring);
+	io->ring = -1;
+}
+
+#endif
+
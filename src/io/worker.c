@@ -0,0 +1,64 @@
+#define _GNU_SOURCE // preadv()
+#include "virginian.h"
+
+/**
+ * @ingroup io
+ * @brief Main loop of the threads in the I/O thread pool
+ *
+ * Takes requests from the queue filled by virg_io_submit() and performs them
+ * with preadv() or pwritev(), repeating short transfers until the whole request
+ * is done. A transfer that fails or reaches the end of the file marks the
+ * request as failed. The thread exits once the queue is empty and the engine
+ * is being stopped by virg_io_free().
+ *
+ * @param arg Pointer to the I/O engine, as passed through pthread_create()
+ * @return NULL
+ */
+void *virg_io_worker(void *arg)
+{
+	virg_io *io = (virg_io*)arg;
+	virg_io_req *req;
+	ssize_t r;
+
+	pthread_mutex_lock(&io->lock);
+
+	while(1) {
+		if(io->head == NULL) {
+			if(io->stop)
+				break;
+			pthread_cond_wait(&io->cond, &io->lock);
+			continue;
+		}
+
+		// take the next request off the queue
+		req = io->head;
+		io->head = req->next;
+		if(io->head == NULL)
+			io->tail = NULL;
+
+		pthread_mutex_unlock(&io->lock);
+
+		while(req->result != -1 && (size_t)req->result < req->len) {
+			if(req->write)
+				r = pwritev(req->fd, req->iov, req->iovcnt,
+					req->offset + req->result);
+			else
+				r = preadv(req->fd, req->iov, req->iovcnt,
+					req->offset + req->result);
+
+			if(r <= 0)
+				req->result = -1;
+			else
+				virg_io_advance(req, r);
+		}
+
+		virg_io_complete(io, req);
+
+		pthread_mutex_lock(&io->lock);
+	}
+
+	pthread_mutex_unlock(&io->lock);
+
+	return NULL;
+}
+
@@ -10,7 +10,8 @@
  * it will be reassigned. See the virg_reader documentation for more information
  * on accessing results. Once results are no longer needed, virg_release()
  * should be called to clean up after the query, otherwise you will probably
- * leak memory.
+ * leak memory. If the query can't be run, such as on the GPU when Virginian is
+ * compiled with VIRG_NOCUDA, the reader is set to NULL.
  *
  * @param v Pointer to the state struct of the database system
  * @param reader Pointer to a pointer to a reader of results
@@ -23,7 +24,12 @@ int virg_query(virginian *v, virg_reader **reader, const char *query)
 	virg_vm *vm = virg_vm_init();
 	virg_sql(v, query, vm);
 
-	virg_vm_execute(v, vm);
+	if(virg_vm_execute(v, vm) == VIRG_FAIL) {
+		virg_vm_cleanup(v, vm);
+		reader[0] = NULL;
+		VIRG_CHECK(1, "Could not execute query")
+	}
+
 	reader[0] = (virg_reader*)malloc(sizeof(virg_reader));
 	virg_reader_init(v, reader[0], vm);
 
@@ -23,8 +23,10 @@ int virg_reader_getrows(virginian *v, virg_reader *r, unsigned *rows_)
 	if(r->res == NULL)
 		return VIRG_FAIL;
 
-	// use our own pointer so we don't advance the reader
+	// use our own pointer so we don't advance the reader, with its own lock
+	// since walking the tablet string releases the lock on each tablet left
 	virg_tablet_meta *res = r->res;
+	virg_tablet_lock(v, res->id);
 
 	// iterate to the end of the tablet string
 	while(1) {
@@ -33,8 +35,12 @@ int virg_reader_getrows(virginian *v, virg_reader *r, unsigned *rows_)
 		if(res->last_tablet)
 			break;
 
-		virg_db_loadnext(v, &res);
+		if(virg_db_loadnext(v, &res) == VIRG_FAIL) {
+			virg_tablet_unlock(v, res->id);
+			VIRG_CHECK(1, "Could not load tablet")
+		}
 	}
+	virg_tablet_unlock(v, res->id);
 
 	// subtract the position in the current tablet
 	rows -= r->row;
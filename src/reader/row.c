@@ -47,8 +47,11 @@ int virg_reader_row(virginian *v, virg_reader *r)
 			return VIRG_FAIL;
 		}
 		// otherwise load the next one
-		else
-			virg_db_loadnext(v, &r->res);
+		else if(virg_db_loadnext(v, &r->res) == VIRG_FAIL) {
+			virg_tablet_unlock(v, res->id);
+			r->res = NULL;
+			VIRG_CHECK(1, "Could not load tablet")
+		}
 		r->row = 0;
 	}
 
@@ -29,12 +29,16 @@ int virg_table_addcolumn(virginian *v, unsigned table_id, const char *name, virg
 
 	// iterate over every tablet of the table
 	while(1) {
-		virg_tablet_addcolumn(tab, name, type);
+		virg_tablet_addcolumn(v, tab, name, type);
+		virg_tablet_dirty(v, tab);
 
 		if(tab->last_tablet)
 			break;
 
-		virg_db_loadnext(v, &tab);
+		if(virg_db_loadnext(v, &tab) == VIRG_FAIL) {
+			virg_tablet_unlock(v, tab->id);
+			VIRG_CHECK(1, "Could not load tablet")
+		}
 	}
 
 	virg_tablet_unlock(v, tab->id);
@@ -0,0 +1,82 @@
+#include "virginian.h"
+
+/**
+ * @ingroup table
+ * @brief Append a batch of rows to a table, one column at a time
+ *
+ * Does the work of calling virg_table_insert() for each of a number of rows,
+ * but with the rows given as arrays of column values rather than row buffers,
+ * so that each tablet is loaded once and filled with one copy for the key and
+ * each of the fixed-size columns. Like virg_table_insert(), the rows are added
+ * to the tablets of the calling thread's append lane, see virg_table_tail(),
+ * so batches can be appended by several threads at once. The zone maps are
+ * updated for each run of rows copied. For example, the following code appends
+ * n rows to a table with an integer key and an integer and a float column:
+ *
+ * @code
+ * int keys[n];
+ * int x[n];
+ * float y[n];
+ * const char *columns[2] = { (char*)x, (char*)y };
+ * virg_table_append_batch(v, table_id, (char*)keys, columns, n);
+ * @endcode
+ *
+ * @param v 		Pointer to the state struct of the database system
+ * @param table_id 	Table to which the rows are appended
+ * @param keys		Array of the key values of the rows
+ * @param columns	Array of pointers to the arrays of values of each of the
+ * table's fixed-size columns, in column order
+ * @param rows		Number of rows to append
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_append_batch(virginian *v, unsigned table_id, const char *keys,
+	const char **columns, unsigned rows)
+{
+	unsigned i, done = 0;
+	virg_tablet_meta *tab;
+
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+
+	if(rows == 0)
+		return VIRG_SUCCESS;
+
+	// fill the tablets of the thread's append lane, see virg_table_insert()
+	unsigned lane = virg_table_lane(v);
+	VIRG_CHECK(virg_table_lanelock(v, table_id, lane) == VIRG_FAIL,
+		"Could not append rows")
+
+	while(done < rows) {
+		if(virg_table_tail(v, table_id, lane, &tab) == VIRG_FAIL) {
+			pthread_mutex_unlock(&v->append_lane_lock[table_id][lane]);
+			VIRG_CHECK(1, "Could not append rows")
+		}
+
+		unsigned first = tab->rows;
+		unsigned n = VIRG_MIN(rows - done, tab->possible_rows - first);
+
+		// copy the keys and each of the columns in one go
+		memcpy((char*)tab + tab->key_block + first * tab->key_stride,
+			keys + (size_t)done * tab->key_stride, n * tab->key_stride);
+		for(i = 0; i < tab->fixed_columns; i++) {
+			size_t stride = tab->fixed_stride[i];
+			memcpy((char*)tab + tab->fixed_block + tab->fixed_offset[i] +
+				first * stride, columns[i] + (size_t)done * stride,
+				n * stride);
+		}
+
+		// the rows must be written before queries see them
+		__sync_synchronize();
+		tab->rows += n;
+		virg_tablet_zones(tab, first);
+		virg_tablet_dirty(v, tab);
+		virg_tablet_unlock(v, tab->id);
+		done += n;
+	}
+
+	pthread_mutex_unlock(&v->append_lane_lock[table_id][lane]);
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,30 @@
+#include "virginian.h"
+
+/**
+ * @ingroup table
+ * @brief Give a column of a table Bloom filters
+ *
+ * Every tablet of a table has a Bloom filter for its key, which is used to skip
+ * the tablets that can't match equality conditions without reading them, see
+ * virg_db_bloom(). This adds a filter for a fixed-size column to every tablet of
+ * the table written from now on, which is useful for columns that are often
+ * tested for equality with constants. Tablets that are already on disk don't
+ * get the new filter until they are changed and written again.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param table_id	ID of the table
+ * @param column	Number of the fixed-size column
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_bloom(virginian *v, unsigned table_id, unsigned column)
+{
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+	VIRG_CHECK(column >= VIRG_MAX_COLUMNS, "Invalid column")
+
+	v->db.bloom_columns[table_id] |= 1u << column;
+
+	return VIRG_SUCCESS;
+}
+
@@ -21,7 +21,7 @@ int virg_table_create(virginian *v, const char *name, virg_t key_type)
 {
 	virg_db *db = &v->db;
 
-	unsigned table_id;
+	unsigned table_id, i;
 
 	// find an empty table slot
 	for(table_id = 0; table_id < VIRG_MAX_TABLES; table_id++)
@@ -44,6 +44,8 @@ int virg_table_create(virginian *v, const char *name, virg_t key_type)
 	db->last_tablet[table_id] = tablet_id;
 	db->write_cursor[table_id] = tablet_id;
 	db->table_tablets[table_id]++;
+	for(i = 0; i < VIRG_APPEND_LANES; i++)
+		v->append_tablet[table_id][i] = VIRG_INDEX_EMPTY;
 
 	return VIRG_SUCCESS;
 }
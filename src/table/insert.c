@@ -5,14 +5,14 @@
  * @brief Insert a row into a table
  *
  * Insert a new row by adding it to the end of a table. This function locates
- * the tablet where we have set the write_cursor. If the tablet is full, we
- * attempt to add more row space with virg_tablet_addrows(), and if we can't,
- * then we move onto the next tablet in the tablet string. The key and data
- * arguments are passed as pointers to their buffer because the size of their
- * variable types is unknown. The data buffer should contain all the columns in
- * order immediately adjacent to each other. For example, the following code
- * adds a row to a table with an integer key, and an integer, double, and float
- * column:
+ * the tablet that the calling thread's append lane fills with
+ * virg_table_tail(), which moves on to a new tablet at the end of the table
+ * when it is full. Rows can be inserted by several threads at once, each
+ * filling its own tablet, see virg_table_lane(). The key and data arguments
+ * are passed as pointers to their buffer because the size of their variable
+ * types is unknown. The data buffer should contain all the columns in order
+ * immediately adjacent to each other. For example, the following code adds a
+ * row to a table with an integer key, and an integer, double, and float column:
  *
  * @code
  * int i = 150;
@@ -46,22 +46,14 @@ int virg_table_insert(virginian *v, unsigned table_id, char *key, char *data, ch
 
 	assert(blob == NULL);
 
-	// load the table's table on which we have a write cursor
-	virg_db_load(v, v->db.write_cursor[table_id], &tab);
-
-	// check for corruption
-	assert(tab->rows <= tab->possible_rows);
-
-	// if the current tablet is full
-	if(tab->rows == tab->possible_rows) {
-		// if there is room to add more fixed-size rows
-		if(tab->size < VIRG_TABLET_SIZE - tab->row_stride)
-			virg_tablet_addrows(v, tab, VIRG_TABLET_KEY_INCREMENT);
-		// otherwise move on to the next tablet
-		else {
-			virg_db_loadnext(v, &tab);
-			v->db.write_cursor[tab->table_id] = tab->id;
-		}
+	// load the tablet that the thread's append lane inserts into, which only
+	// this thread changes until the lane is unlocked
+	unsigned lane = virg_table_lane(v);
+	VIRG_CHECK(virg_table_lanelock(v, table_id, lane) == VIRG_FAIL,
+		"Could not insert row")
+	if(virg_table_tail(v, table_id, lane, &tab) == VIRG_FAIL) {
+		pthread_mutex_unlock(&v->append_lane_lock[table_id][lane]);
+		VIRG_CHECK(1, "Could not insert row")
 	}
 
 	// copy key from buffer
@@ -80,9 +72,14 @@ int virg_table_insert(virginian *v, unsigned table_id, char *key, char *data, ch
 		src += stride;
 	}
 
+	// the row must be written before queries see it
+	__sync_synchronize();
 	tab->rows++;
+	virg_tablet_zones(tab, tab->rows - 1);
+	virg_tablet_dirty(v, tab);
 
 	virg_tablet_unlock(v, tab->id);
+	pthread_mutex_unlock(&v->append_lane_lock[table_id][lane]);
 
 	return VIRG_SUCCESS;
 }
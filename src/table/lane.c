@@ -0,0 +1,28 @@
+#include "virginian.h"
+
+/**
+ * @ingroup table
+ * @brief Find the append lane of the calling thread
+ *
+ * Each thread that inserts rows is given one of VIRG_APPEND_LANES append
+ * lanes the first time it asks for one, in turn, and keeps it for as long as
+ * it runs. The rows that a thread inserts into a table are put into the tablet
+ * of its lane, see virg_table_tail(), so threads with their own lanes never
+ * wait for each other while they copy rows. If more threads than that insert
+ * rows, lanes are shared and the threads sharing one take turns to insert into
+ * each table, see virg_table_lanelock().
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return the append lane of the calling thread
+ */
+unsigned virg_table_lane(virginian *v)
+{
+	static __thread unsigned lane = VIRG_INDEX_EMPTY;
+
+	if(lane == VIRG_INDEX_EMPTY)
+		lane = (VIRG_ATOMIC_ADD(v->append_lane_counter, 1) - 1) %
+			VIRG_APPEND_LANES;
+
+	return lane;
+}
+
@@ -0,0 +1,36 @@
+#include "virginian.h"
+
+/**
+ * @ingroup table
+ * @brief Lock the append lane of a table
+ *
+ * Takes the lock that a thread holds while it inserts rows into a table
+ * through its append lane, see virg_table_lane(), waiting for any other thread
+ * sharing the lane to finish with the table. An appender holds the lock for
+ * the whole of its session, see virg_appender_init(), so this fails rather than
+ * waiting forever if the calling thread's own appender holds it, which means
+ * that a thread with an appender open on a table must append rows to it only
+ * through the appender. The lock is given up with pthread_mutex_unlock() on
+ * virginian.append_lane_lock.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param table_id	ID of the table that rows are inserted into
+ * @param lane		Append lane of the calling thread
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_lanelock(virginian *v, unsigned table_id, unsigned lane)
+{
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+
+	// only the thread holding the lock sets or clears its session
+	VIRG_CHECK(v->append_session[table_id][lane] &&
+		pthread_equal(v->append_owner[table_id][lane], pthread_self()),
+		"Rows are being appended to the table by this thread's appender")
+
+	pthread_mutex_lock(&v->append_lane_lock[table_id][lane]);
+
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,471 @@
+#include "virginian.h"
+
+/**
+ * Part of the file loaded by one thread of virg_table_load(), and the string
+ * of tablets that it has been loaded into
+ */
+typedef struct {
+	virginian			*v;
+	/// meta information of the table's first tablet, copied into each tablet
+	virg_tablet_meta	*tmpl;
+	int					fd;
+	virg_format			format;
+	/// bytes of the file in this part, lines starting in it for CSV files
+	off_t				start;
+	off_t				end;
+	/// ids of the tablets made, in the order of their string
+	unsigned			*ids;
+	unsigned			tablets;
+	unsigned			alloced;
+	unsigned			rows;
+	int					failed;
+} load_part;
+
+/**
+ * Buffered reader of a part of the file
+ */
+typedef struct {
+	int		fd;
+	/// offset in the file of the start of the buffer
+	off_t	pos;
+	char	*buf;
+	/// bytes read into the buffer
+	size_t	len;
+	/// bytes of the buffer that have been used
+	size_t	off;
+	int		eof;
+} load_reader;
+
+/**
+ * Move the unused bytes to the start of the buffer and read more after them,
+ * keeping the buffer terminated so that numbers can be parsed in place
+ */
+static void load_fill(load_reader *r)
+{
+	memmove(r->buf, r->buf + r->off, r->len - r->off);
+	r->pos += r->off;
+	r->len -= r->off;
+	r->off = 0;
+
+	ssize_t n = pread(r->fd, r->buf + r->len, VIRG_LOAD_BUFFER - 1 - r->len,
+		r->pos + r->len);
+	if(n <= 0)
+		r->eof = 1;
+	else
+		r->len += n;
+	r->buf[r->len] = '\0';
+}
+
+/**
+ * Find the next line in the buffer, returning its length including the
+ * newline, or 0 at the end of the file or if the line doesn't fit
+ */
+static size_t load_line(load_reader *r)
+{
+	while(1) {
+		char *nl = (char*)memchr(r->buf + r->off, '\n', r->len - r->off);
+		if(nl != NULL)
+			return nl - (r->buf + r->off) + 1;
+		if(r->eof || (r->off == 0 && r->len == VIRG_LOAD_BUFFER - 1))
+			return r->len - r->off;
+		load_fill(r);
+	}
+}
+
+/**
+ * Parse a value of type type at p into dest, returning a pointer past it or
+ * NULL if there isn't one
+ */
+static char *load_value(char *p, virg_t type, char *dest)
+{
+	char *end = p;
+
+	switch(type) {
+		case VIRG_INT:
+			((int*)dest)[0] = (int)strtol(p, &end, 10);
+			break;
+		case VIRG_INT64:
+			((long long int*)dest)[0] = strtoll(p, &end, 10);
+			break;
+		case VIRG_FLOAT:
+			((float*)dest)[0] = strtof(p, &end);
+			break;
+		case VIRG_DOUBLE:
+			((double*)dest)[0] = strtod(p, &end);
+			break;
+		case VIRG_CHAR:
+			dest[0] = *p == ',' || *p == '\n' || *p == '\r' ? '\0' : *p;
+			return p + (dest[0] != '\0');
+		default:
+			return NULL;
+	}
+
+	return end == p ? NULL : end;
+}
+
+/**
+ * Finish the tablet being filled and start the next one in the string, or
+ * just start the first one if tab is NULL, leaving only the new one locked
+ */
+static int load_tablet(load_part *c, virg_tablet_meta **tab)
+{
+	virginian *v = c->v;
+	virg_tablet_meta *t;
+
+	if(c->tablets == c->alloced) {
+		c->alloced = VIRG_MAX(c->alloced * 2, 16);
+		unsigned *ids = (unsigned*)realloc(c->ids,
+			c->alloced * sizeof(unsigned));
+		VIRG_CHECK(ids == NULL, "Out of memory")
+		c->ids = ids;
+	}
+
+	// ids are shared by the threads
+	unsigned id = VIRG_ATOMIC_ADD(v->db.tablet_id_counter, 1) - 1;
+	VIRG_CHECK(virg_db_alloc(v, &t, id) == VIRG_FAIL,
+		"Could not allocate tablet")
+	c->ids[c->tablets++] = id;
+
+	// laid out like a tail added by virg_tablet_addtail()
+	memcpy(t, c->tmpl, sizeof(virg_tablet_meta));
+	t->id = id;
+	t->rows = 0;
+	t->zones = 1;
+	t->next = 0;
+	t->last_tablet = 1;
+	t->packed = 0;
+	t->info = NULL;
+	virg_tablet_presize(v, t);
+
+	// link the finished tablet to the new one
+	if(tab[0] != NULL) {
+		virg_tablet_zones(tab[0], 0);
+		tab[0]->next = id;
+		tab[0]->last_tablet = 0;
+		virg_tablet_dirty(v, tab[0]);
+		virg_tablet_unlock(v, tab[0]->id);
+	}
+
+	tab[0] = t;
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Parse a CSV line into the next row of a tablet with room for it
+ */
+static int load_csv(virg_tablet_meta *tab, char *p)
+{
+	unsigned i;
+
+	p = load_value(p, tab->key_type, (char*)tab + tab->key_block +
+		tab->rows * tab->key_stride);
+
+	for(i = 0; i < tab->fixed_columns && p != NULL; i++) {
+		if(*p != ',')
+			return VIRG_FAIL;
+		p = load_value(p + 1, tab->fixed_type[i], (char*)tab +
+			tab->fixed_block + tab->fixed_offset[i] +
+			tab->rows * tab->fixed_stride[i]);
+	}
+
+	if(p == NULL || (*p != '\n' && *p != '\r' && *p != '\0'))
+		return VIRG_FAIL;
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * Copy a binary row into the next row of a tablet with room for it
+ */
+static void load_binary(virg_tablet_meta *tab, char *p)
+{
+	unsigned i;
+
+	memcpy((char*)tab + tab->key_block + tab->rows * tab->key_stride, p,
+		tab->key_stride);
+	p += tab->key_stride;
+
+	for(i = 0; i < tab->fixed_columns; i++) {
+		memcpy((char*)tab + tab->fixed_block + tab->fixed_offset[i] +
+			tab->rows * tab->fixed_stride[i], p, tab->fixed_stride[i]);
+		p += tab->fixed_stride[i];
+	}
+}
+
+/**
+ * Load one part of the file into a string of new tablets, run on its own
+ * thread by virg_table_load()
+ */
+static void *load_thread(void *arg)
+{
+	load_part *c = (load_part*)arg;
+	virg_tablet_meta *tab = NULL;
+	virg_tablet_meta *tmpl = c->tmpl;
+	size_t row_size = tmpl->row_stride - tmpl->key_pointer_stride;
+	load_reader r;
+
+	r.fd = c->fd;
+	r.pos = c->start;
+	r.len = 0;
+	r.off = 0;
+	r.eof = 0;
+	r.buf = (char*)malloc(VIRG_LOAD_BUFFER);
+	if(r.buf == NULL) {
+		c->failed = 1;
+		return NULL;
+	}
+
+	// a CSV part starts with the first line that starts in it
+	if(c->format == VIRG_CSV && c->start > 0) {
+		r.pos = c->start - 1;
+		r.off = load_line(&r);
+	}
+
+	while(r.pos + (off_t)r.off < c->end) {
+		size_t len;
+		char *p;
+
+		if(c->format == VIRG_CSV) {
+			len = load_line(&r);
+			if(len == 0)
+				break;
+			p = r.buf + r.off;
+			if(p[len - 1] != '\n' && !r.eof) {
+				fprintf(stderr, "CSV line too long at %lld\n",
+					(long long)(r.pos + r.off));
+				c->failed = 1;
+				break;
+			}
+		}
+		else {
+			if(r.len - r.off < row_size)
+				load_fill(&r);
+			if(r.len - r.off < row_size)
+				break;
+			len = row_size;
+			p = r.buf + r.off;
+		}
+
+		// skip empty lines
+		if(c->format == VIRG_CSV && (*p == '\n' || *p == '\r')) {
+			r.off += len;
+			continue;
+		}
+
+		if(tab == NULL || tab->rows == tab->possible_rows)
+			if(load_tablet(c, &tab) == VIRG_FAIL) {
+				c->failed = 1;
+				break;
+			}
+
+		if(c->format == VIRG_BINARY)
+			load_binary(tab, p);
+		else if(load_csv(tab, p) == VIRG_FAIL) {
+			// the first line of the file may name the columns
+			if(r.pos + (off_t)r.off == 0) {
+				r.off += len;
+				continue;
+			}
+			fprintf(stderr, "Bad CSV line at %lld\n",
+				(long long)(r.pos + r.off));
+			c->failed = 1;
+			break;
+		}
+
+		tab->rows++;
+		c->rows++;
+		r.off += len;
+	}
+
+	if(tab != NULL) {
+		virg_tablet_zones(tab, 0);
+		virg_tablet_dirty(c->v, tab);
+		virg_tablet_unlock(c->v, tab->id);
+	}
+
+	free(r.buf);
+
+	return NULL;
+}
+
+/**
+ * Point the last tablet of a string at the tablet that follows it
+ */
+static int load_link(virginian *v, unsigned id, unsigned next)
+{
+	virg_tablet_meta *tab;
+
+	VIRG_CHECK(virg_db_load(v, id, &tab) == VIRG_FAIL, "Could not load tablet")
+
+	// the next id must be visible before the tablet stops being the last, as
+	// in virg_tablet_addtail()
+	tab->next = next;
+	__sync_synchronize();
+	tab->last_tablet = 0;
+	virg_tablet_dirty(v, tab);
+	virg_tablet_unlock(v, id);
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup table
+ * @brief Load the rows of a CSV or binary file into a table in parallel
+ *
+ * This is the bulk counterpart of virg_table_insert(). The file is split into
+ * as many parts as there are threads, each at least VIRG_LOAD_CHUNK bytes,
+ * and each part is parsed on its own thread straight into a string of new
+ * tablets laid out like those of virg_tablet_addtail(). The tablets are made
+ * in tablet slots like any other, so they are written to the database file as
+ * they are evicted. Once every thread is done the strings are linked onto the
+ * end of the table in the order of the file, in one step as far as a scan of
+ * the table is concerned, and the table's write cursor is moved to the last
+ * tablet. If a part of the file can't be loaded, the tablets made are removed
+ * and the table is left as it was.
+ *
+ * A CSV file has a row on each line, with the key then each of the fixed-size
+ * columns in order, separated by commas. A first line that doesn't start with
+ * a key, such as one naming the columns, is skipped, as are empty lines. A
+ * binary file is made of rows of raw values, the key then each of the
+ * fixed-size columns, in the byte order of the machine, which is little-endian
+ * on the machines Virginian runs on. Threads are pinned to the NUMA nodes like
+ * those of virg_vm_cpu(). Rows must not be inserted while a file is loaded.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param table_id	ID of the table to load the rows into
+ * @param file		Path of the file to load
+ * @param format	Format of the file
+ * @param threads	Number of threads to load the file with, or 0 for
+ * virginian.multi_threads
+ * @param rows		If not NULL, the number of rows loaded is returned here
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_load(virginian *v, unsigned table_id, const char *file,
+	virg_format format, unsigned threads, unsigned *rows)
+{
+	virg_tablet_meta tmpl;
+	virg_tablet_meta *tab;
+	struct stat st;
+	unsigned i, j;
+	int failed = 0;
+
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+
+	// every tablet of the table has the layout of the first one
+	VIRG_CHECK(virg_db_load(v, v->db.first_tablet[table_id], &tab) ==
+		VIRG_FAIL, "Could not load tablet")
+	memcpy(&tmpl, tab, sizeof(virg_tablet_meta));
+	virg_tablet_unlock(v, tab->id);
+
+	int fd = open(file, O_RDONLY);
+	VIRG_CHECK(fd == -1, "Problem opening file to load")
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		VIRG_CHECK(1, "Problem opening file to load")
+	}
+
+	// a binary file is split between rows
+	off_t unit = 1;
+	if(format == VIRG_BINARY) {
+		unit = tmpl.row_stride - tmpl.key_pointer_stride;
+		if(st.st_size % unit != 0) {
+			close(fd);
+			VIRG_CHECK(1, "Binary file doesn't hold whole rows")
+		}
+	}
+
+	if(threads == 0)
+		threads = v->multi_threads;
+	threads = VIRG_MAX(VIRG_MIN(threads, st.st_size / VIRG_LOAD_CHUNK), 1);
+
+	load_part *parts = (load_part*)calloc(threads, sizeof(load_part));
+	pthread_t *thread = (pthread_t*)malloc(threads * sizeof(pthread_t));
+	if(parts == NULL || thread == NULL) {
+		free(parts);
+		free(thread);
+		close(fd);
+		VIRG_CHECK(1, "Out of memory")
+	}
+
+	off_t units = st.st_size / unit;
+	for(i = 0; i < threads; i++) {
+		parts[i].v = v;
+		parts[i].tmpl = &tmpl;
+		parts[i].fd = fd;
+		parts[i].format = format;
+		parts[i].start = units * i / threads * unit;
+		parts[i].end = units * (i + 1) / threads * unit;
+
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		if(virg_vm_bindthread(v, &attr, i) == VIRG_FAIL ||
+			pthread_create(&thread[i], &attr, load_thread, &parts[i]))
+			pthread_create(&thread[i], NULL, load_thread, &parts[i]);
+		pthread_attr_destroy(&attr);
+	}
+
+	for(i = 0; i < threads; i++) {
+		pthread_join(thread[i], NULL);
+		failed |= parts[i].failed;
+	}
+
+	close(fd);
+	free(thread);
+
+	// link the strings of tablets from the last to the first, so that the
+	// table only reaches them once they are all linked
+	unsigned next = VIRG_INDEX_EMPTY;
+	unsigned last = VIRG_INDEX_EMPTY;
+	unsigned tablets = 0;
+	unsigned loaded = 0;
+	for(i = threads; i > 0 && !failed; i--) {
+		load_part *c = &parts[i - 1];
+		if(c->tablets == 0)
+			continue;
+		if(last == VIRG_INDEX_EMPTY)
+			last = c->ids[c->tablets - 1];
+		else if(load_link(v, c->ids[c->tablets - 1], next) == VIRG_FAIL)
+			failed = 1;
+		next = c->ids[0];
+		tablets += c->tablets;
+		loaded += c->rows;
+	}
+
+	// the tablets of a failed load are removed without ever being reachable
+	if(failed) {
+		for(i = 0; i < threads; i++) {
+			for(j = 0; j < parts[i].tablets; j++)
+				virg_tablet_remove(v, parts[i].ids[j]);
+			free(parts[i].ids);
+		}
+		free(parts);
+		VIRG_CHECK(1, "Could not load file")
+	}
+
+	for(i = 0; i < threads; i++)
+		free(parts[i].ids);
+	free(parts);
+
+	if(last != VIRG_INDEX_EMPTY) {
+		VIRG_CHECK(load_link(v, v->db.last_tablet[table_id], next) == VIRG_FAIL,
+			"Could not link tablets")
+		v->db.last_tablet[table_id] = last;
+		v->db.write_cursor[table_id] = last;
+		v->db.table_tablets[table_id] += tablets;
+
+		// rows inserted later go after the loaded rows
+		pthread_mutex_lock(&v->append_lock);
+		for(i = 0; i < VIRG_APPEND_LANES; i++)
+			v->append_tablet[table_id][i] = VIRG_INDEX_EMPTY;
+		pthread_mutex_unlock(&v->append_lock);
+	}
+
+	if(rows != NULL)
+		rows[0] = loaded;
+
+	return VIRG_SUCCESS;
+}
+
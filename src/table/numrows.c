@@ -24,7 +24,10 @@ int virg_table_numrows(virginian *v, unsigned id, unsigned *rows)
 	i += tab->rows;
 
 	while(!tab->last_tablet) {
-		virg_db_loadnext(v, &tab);
+		if(virg_db_loadnext(v, &tab) == VIRG_FAIL) {
+			virg_tablet_unlock(v, tab->id);
+			VIRG_CHECK(1, "Could not load tablet")
+		}
 		i += tab->rows;
 	}
 
@@ -0,0 +1,123 @@
+#include "virginian.h"
+
+/**
+ * Whether any append lane of a table is filling a tablet
+ */
+static int tail_held(virginian *v, unsigned table_id, unsigned id)
+{
+	unsigned i;
+
+	for(i = 0; i < VIRG_APPEND_LANES; i++)
+		if(v->append_tablet[table_id][i] == id)
+			return 1;
+
+	return 0;
+}
+
+/**
+ * Give an append lane the next tablet of a table to fill, which is the
+ * tablet at the table's write cursor if no lane is filling it, otherwise the
+ * empty tablet after it or a new tail linked onto the end of the table
+ */
+static int tail_next(virginian *v, unsigned table_id, unsigned lane)
+{
+	virg_tablet_meta *tab, *tail;
+	unsigned *id = &v->append_tablet[table_id][lane];
+	unsigned cursor = v->db.write_cursor[table_id];
+
+	if(*id == VIRG_INDEX_EMPTY && !tail_held(v, table_id, cursor)) {
+		*id = cursor;
+		return VIRG_SUCCESS;
+	}
+
+	// the tablets after the write cursor have no rows yet
+	VIRG_CHECK(virg_db_load(v, cursor, &tab) == VIRG_FAIL,
+		"Could not load tablet")
+	int last = tab->last_tablet;
+	unsigned next = tab->next;
+	virg_tablet_unlock(v, cursor);
+
+	if(last) {
+		VIRG_CHECK(virg_db_load(v, v->db.last_tablet[table_id], &tab) ==
+			VIRG_FAIL, "Could not load tablet")
+		virg_tablet_addtail(v, tab, &tail);
+		next = tail->id;
+		virg_tablet_unlock(v, next);
+		v->db.last_tablet[table_id] = next;
+		v->db.table_tablets[table_id]++;
+	}
+
+	*id = next;
+	v->db.write_cursor[table_id] = next;
+
+	return VIRG_SUCCESS;
+}
+
+/**
+ * @ingroup table
+ * @brief Find the tablet that an append lane inserts rows into
+ *
+ * Rows are inserted into a table by up to VIRG_APPEND_LANES threads at once,
+ * each into the tablet of its append lane, see virg_table_lane(). This loads
+ * that tablet, making sure it has room for at least one more row. When the
+ * lane has no tablet or its tablet is full, it is given the next one under
+ * virginian.append_lock, which is only held for as long as it takes to link
+ * a tablet onto the end of the table, so the threads only wait for each other
+ * once per tablet they fill. The table's write cursor is the tablet last given
+ * to a lane. The caller must hold the lane's append_lane_lock until it is done
+ * with the tablet, and unlock the tablet.
+ *
+ * Since each lane fills its own tablet, the rows inserted by different threads
+ * are put into different tablets of the table, and rows are only in the order
+ * they were inserted in within each thread.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param table_id	ID of the table that rows are inserted into
+ * @param lane		Append lane of the calling thread
+ * @param tab		Pointer through which the locked tablet is returned
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_tail(virginian *v, unsigned table_id, unsigned lane,
+	virg_tablet_meta **tab)
+{
+	int lost = 0;
+
+	VIRG_CHECK(table_id >= VIRG_MAX_TABLES || v->db.table_status[table_id] == 0,
+		"Invalid table")
+
+	unsigned *id = &v->append_tablet[table_id][lane];
+
+	while(1) {
+		// a lane's tablet may have been removed from the table, in which case
+		// the lane starts again from the write cursor, but only once
+		if(*id != VIRG_INDEX_EMPTY && virg_db_load(v, *id, tab) == VIRG_FAIL) {
+			VIRG_CHECK(lost, "Could not load tablet")
+			lost = 1;
+			pthread_mutex_lock(&v->append_lock);
+			*id = VIRG_INDEX_EMPTY;
+			pthread_mutex_unlock(&v->append_lock);
+		}
+		else if(*id != VIRG_INDEX_EMPTY) {
+			if(tab[0]->rows < tab[0]->possible_rows)
+				return VIRG_SUCCESS;
+
+			// tablets laid out for fewer rows than fit in them are laid out
+			// again for all of them
+			if(tab[0]->size < v->db.tablet_size &&
+				virg_tablet_presize(v, tab[0]) == VIRG_SUCCESS &&
+				tab[0]->rows < tab[0]->possible_rows) {
+				virg_tablet_dirty(v, tab[0]);
+				return VIRG_SUCCESS;
+			}
+
+			virg_tablet_unlock(v, *id);
+		}
+
+		pthread_mutex_lock(&v->append_lock);
+		int r = tail_next(v, table_id, lane);
+		pthread_mutex_unlock(&v->append_lock);
+		VIRG_CHECK(r == VIRG_FAIL, "Could not find tablet to insert into")
+	}
+}
+
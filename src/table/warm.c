@@ -0,0 +1,104 @@
+#include "virginian.h"
+
+/**
+ * @ingroup table
+ * @brief Load the tablets of a list of tables into memory in parallel
+ *
+ * Used to fill the tablet slots before taking queries, such as after the
+ * database has been opened. The tablets of each table are read in the order
+ * of their string with virg_db_readahead(), which only waits for the meta
+ * information of each tablet before moving on to the next one, so the rest of
+ * the tablets is read concurrently by the asynchronous I/O engine. Once every
+ * read has been started each tablet is loaded with virg_db_load(), waiting
+ * for the reads still in progress, so that the function returns only once all
+ * of the tablets are in memory. A tablet that another thread is reading is
+ * waited for straight away to find the tablet after it.
+ *
+ * No more tablets are loaded than fit in the budget, counting the full tablet
+ * size for each, or in the tablet slots in use, see virg_db_resize(). The
+ * tables are loaded in the order they are listed, so the first tables are
+ * loaded in full if the budget doesn't cover all of them.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param table_ids	IDs of the tables to load
+ * @param tables	Number of tables in table_ids
+ * @param budget	Bytes of tablet slot memory the tables may take, or 0 to
+ * use every tablet slot
+ * @param stats		If not NULL, the tablets and bytes loaded and the time it
+ * took are returned here
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_table_warm(virginian *v, const unsigned *table_ids, unsigned tables,
+	size_t budget, virg_warm_stats *stats)
+{
+	struct timeval start, end;
+	virg_tablet_meta meta;
+	virg_tablet_meta *tab;
+	unsigned i, t, n = 0;
+	size_t bytes = 0;
+	int failed = 0;
+
+	gettimeofday(&start, NULL);
+
+	unsigned max = v->slot_count;
+	if(budget > 0)
+		max = VIRG_MIN(max, budget / v->db.tablet_size);
+
+	for(t = 0; t < tables; t++)
+		VIRG_CHECK(table_ids[t] >= VIRG_MAX_TABLES ||
+			v->db.table_status[table_ids[t]] == 0, "Invalid table")
+
+	unsigned *ids = (unsigned*)malloc(VIRG_MAX(max, 1) * sizeof(unsigned));
+	VIRG_CHECK(ids == NULL, "Out of memory")
+
+	// start reading the tablets, following the string of each table through
+	// the meta information returned as each read is started
+	for(t = 0; t < tables && n < max && !failed; t++) {
+		unsigned id = v->db.first_tablet[table_ids[t]];
+
+		while(n < max) {
+			if(virg_db_readahead(v, id, VIRG_ALL_COLUMNS, &meta) ==
+				VIRG_FAIL) {
+				if(virg_db_load(v, id, &tab) == VIRG_FAIL) {
+					failed = 1;
+					break;
+				}
+				memcpy(&meta, tab, sizeof(virg_tablet_meta));
+				virg_tablet_unlock(v, id);
+			}
+
+			ids[n++] = id;
+			if(meta.last_tablet)
+				break;
+			id = meta.next;
+		}
+	}
+
+	// wait for the reads, loading a tablet that is being read waits for it
+	for(i = 0; i < n && !failed; i++) {
+		if(virg_db_load(v, ids[i], &tab) == VIRG_FAIL)
+			failed = 1;
+		else {
+			bytes += tab->size;
+			virg_tablet_unlock(v, ids[i]);
+		}
+	}
+
+	free(ids);
+	VIRG_CHECK(failed, "Could not load tablet")
+
+	gettimeofday(&end, NULL);
+
+	if(stats != NULL) {
+		stats->tablets = n;
+		stats->bytes = bytes;
+		stats->seconds = (end.tv_sec - start.tv_sec) +
+			(end.tv_usec - start.tv_usec) / 1000000.0;
+		stats->throughput = stats->seconds > 0 ?
+			bytes / stats->seconds : 0;
+	}
+
+	return VIRG_SUCCESS;
+}
+
@@ -5,18 +5,23 @@
  * @brief Add a column to a tablet
  *
  * Modifies a tablet, including making it larger, to contain a new column, added
- * to the end of the original columns. This function does not check to ensure
+ * to the end of the original columns. Data tablets are laid out again for as
+ * many rows of the new row stride as fit into a tablet with
+ * virg_tablet_presize(), which fails if the rows already in the tablet no
+ * longer fit. For result tablets, this function does not check to ensure
  * that there is enough room in the tablet for the new column, so columns should
  * be added only if there is a good amount of empty space in the tablet. The
  * virg_tablet_growfixed() function is used to expand the tablet.
  *
+ * @param v	Pointer to the state struct of the database system
  * @param tab	The tablet to which the column is to be added
  * @param name	The name of the column to add
  * @param type	The variable type of the column to add
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
  * call
  */
-int virg_tablet_addcolumn(virg_tablet_meta *tab, const char *name, virg_t type)
+int virg_tablet_addcolumn(virginian *v, virg_tablet_meta *tab, const char *name,
+	virg_t type)
 {
 	int i;
 	int col = tab->fixed_columns;
@@ -33,12 +38,26 @@ int virg_tablet_addcolumn(virg_tablet_meta *tab, const char *name, virg_t type)
 	tab->fixed_type[col] = type;
 	tab->fixed_stride[col] = virg_sizeof(type);
 	tab->row_stride += virg_sizeof(type);
+
+	// lay out the other columns for the new row stride, so that the new column
+	// goes after them
+	if(tab->in_table && virg_tablet_presize(v, tab) == VIRG_FAIL) {
+		tab->row_stride -= virg_sizeof(type);
+		VIRG_CHECK(1, "No room for column")
+	}
+
 	tab->fixed_offset[col] =
 		(col == 0) ? 0 : tab->fixed_offset[col-1] + tab->fixed_stride[col-1] * tab->possible_rows;
 	tab->fixed_columns++;
 
+	// the zone map doesn't cover the new column's values
+	if(tab->rows > 0)
+		tab->zones = 0;
+
 	// make room in the tablet for the new column
-	virg_tablet_growfixed(tab, tab->fixed_stride[col] * tab->possible_rows);
+	if(!tab->in_table)
+		virg_tablet_growfixed(v, tab,
+			tab->fixed_stride[col] * tab->possible_rows);
 
 	return VIRG_SUCCESS;
 }
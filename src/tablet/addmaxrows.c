@@ -16,8 +16,9 @@ int virg_tablet_addmaxrows(virginian *v, virg_tablet_meta *tab)
 {
 	// calculate the the unused space in the tablet
 	size_t stride = tab->row_stride;
-	size_t avail = VIRG_TABLET_SIZE - sizeof(virg_tablet_meta) - VIRG_TABLET_MAXED_VARIABLE;
-	VIRG_CHECK(avail > VIRG_TABLET_SIZE, "already at max, size_t underflow")
+	size_t avail = v->db.tablet_size - sizeof(virg_tablet_meta) -
+		VIRG_TABLET_MAXED_VARIABLE(v->db.tablet_size);
+	VIRG_CHECK(avail > v->db.tablet_size, "already at max, size_t underflow")
 
 	// calculate how many new rows we can fit into that space
 	unsigned pr = avail / stride;
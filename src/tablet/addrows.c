@@ -11,7 +11,9 @@
  * multiple of 16, and this function performs rounding to ensure that this is
  * the case. This function is called by virg_tablet_insert() to add a new block
  * of possible rows whenever the insert operation does not have any space to add
- * a single new row.
+ * a single new row. Data tablets are laid out for as many rows as fit from the
+ * start, see virg_tablet_presize(), so for them this only adds tails, and the
+ * columns are only moved to make room in tablets laid out for fewer rows.
  *
  * @param v     Pointer to the state struct of the database system
  * @param tab	Pointer to tablet in which the rows are added
@@ -25,7 +27,7 @@ int virg_tablet_addrows(virginian *v, virg_tablet_meta *tab, unsigned rows)
 	unsigned i;
 	size_t row_stride = tab->row_stride;
 
-	unsigned max_new_rows = (VIRG_TABLET_SIZE - tab->size) / row_stride;
+	unsigned max_new_rows = (v->db.tablet_size - tab->size) / row_stride;
 
 	// round the maximum number of new rows down to a multiple of 16
 	max_new_rows &= 0xFFFFFFF0;
@@ -34,14 +36,16 @@ int virg_tablet_addrows(virginian *v, virg_tablet_meta *tab, unsigned rows)
 	rows = (rows - 1 + 16) & 0xFFFFFFF0;
 	unsigned new_rows = VIRG_MIN(max_new_rows, rows);
 
-	VIRG_DEBUG_CHECK(tab->size + row_stride * new_rows > VIRG_TABLET_SIZE, "new rows over tablet size")
+	VIRG_DEBUG_CHECK(tab->size + row_stride * new_rows > v->db.tablet_size, "new rows over tablet size")
 
 	size_t new_fixed_block = tab->fixed_block +
 		new_rows * (tab->key_stride + tab->key_pointer_stride);
 
+	virg_tablet_dirty(v, tab);
+
 	// if we can fit more rows into this tablet
 	if(new_rows != 0) {
-		virg_tablet_growfixed(tab, row_stride * new_rows);
+		virg_tablet_growfixed(v, tab, row_stride * new_rows);
 		tab->possible_rows += new_rows;
 
 		// generate new fixed column offsets
@@ -54,7 +58,7 @@ int virg_tablet_addrows(virginian *v, virg_tablet_meta *tab, unsigned rows)
 
 		// move each column individually
 		for(i = tab->fixed_columns-1; i < tab->fixed_columns; i--) {
-			VIRG_DEBUG_CHECK((new_fixed_block + new_offsets[i] + tab->rows * tab->fixed_stride[i]) > VIRG_TABLET_SIZE, "memmove exceeds tablet limit")
+			VIRG_DEBUG_CHECK((new_fixed_block + new_offsets[i] + tab->rows * tab->fixed_stride[i]) > v->db.tablet_size, "memmove exceeds tablet limit")
 			memmove((char*)tab + new_fixed_block + new_offsets[i],
 				(char*)tab + tab->fixed_block + tab->fixed_offset[i],
 				tab->rows * tab->fixed_stride[i]);
@@ -77,20 +81,20 @@ int virg_tablet_addrows(virginian *v, virg_tablet_meta *tab, unsigned rows)
 	if(max_new_rows <= rows) {
 		virg_tablet_lock(v, tab->id);
 
-		tab->size = VIRG_TABLET_SIZE; // max out tablet size
-		unsigned rows_left = rows - new_rows;
-		unsigned max_tablet_rows = (VIRG_TABLET_SIZE - 
-			sizeof(virg_tablet_meta) - VIRG_TABLET_INITIAL_FIXED) / row_stride;
+		tab->size = v->db.tablet_size; // max out tablet size
+		// a tablet that is maxed out always gets a tail to move on to, even if
+		// all of the rows fit into it
+		unsigned rows_left = VIRG_MAX(rows - new_rows, 16);
 
 		virg_tablet_meta *node = tab;
 		virg_tablet_meta *tail;
 
-		// add tablets until we can fit in all the rows we need
+		// add tablets until we can fit in all the rows we need, each laid out
+		// for as many rows as fit
 		while(rows_left > 0) {
-			unsigned r = VIRG_MIN(rows_left, max_tablet_rows);
-			virg_tablet_addtail(v, node, &tail, r);
+			virg_tablet_addtail(v, node, &tail);
 			//virg_print_slots(v);
-			rows_left -= r;
+			rows_left -= VIRG_MIN(rows_left, tail->possible_rows);
 			node = tail;
 		}
 
@@ -5,10 +5,10 @@
  * @brief Create an empty tablet for a new table
  *
  * This function creates a brand new empty tablet with all of the default tablet
- * settings. This is called only by virg_table_create() to produce the first
- * empty tablet for a new table, most new tablets are created with
- * virg_tablet_addtail(). Columns are added later to the tablet with
- * virg_tablet_addcolumn().
+ * settings, laid out with virg_tablet_presize(). This is called only by
+ * virg_table_create() to produce the first empty tablet for a new table, most
+ * new tablets are created with virg_tablet_addtail(). Columns are added later
+ * to the tablet with virg_tablet_addcolumn().
  *
  * @param v     	Pointer to the state struct of the database system
  * @param key_type	Type of the primary key of the tablet
@@ -33,6 +33,7 @@ int virg_tablet_create(virginian *v, int *id, virg_t key_type, unsigned table_id
 
 	// set tablet meta information
 	meta->rows = 0;
+	meta->zones = 1;
 	meta->key_type = key_type;
 	meta->key_stride = virg_sizeof(key_type);
 	meta->key_pointer_stride = sizeof(size_t);
@@ -49,23 +50,20 @@ int virg_tablet_create(virginian *v, int *id, virg_t key_type, unsigned table_id
 		meta->table_id = table_id;
 	}
 
-	// set block sizes according to possible rows
-	meta->possible_rows = VIRG_TABLET_INITIAL_KEYS;
+	// size the blocks for as many rows as fit, so that they never have to be
+	// moved as rows are inserted
+	meta->possible_rows = 0;
+	meta->fixed_columns = 0;
 	meta->key_block = sizeof(virg_tablet_meta);
-	meta->key_pointers_block = meta->key_block +
-		meta->key_stride * VIRG_TABLET_INITIAL_KEYS;
-	meta->fixed_block = meta->key_pointers_block +
-		meta->key_pointer_stride * VIRG_TABLET_INITIAL_KEYS;
-	meta->variable_block = meta->fixed_block + VIRG_TABLET_INITIAL_FIXED;
-	meta->size = meta->variable_block + VIRG_TABLET_INITIAL_VARIABLE;
+	virg_tablet_presize(v, meta);
 
 #ifdef VIRG_DEBUG
 	// 0 out the rest of the tablet for valgrind
-	memset(meta + meta->key_block, 0, meta->size - sizeof(virg_tablet_meta));
+	memset((char*)meta + meta->key_block, 0,
+		meta->size - sizeof(virg_tablet_meta));
 #endif
 
 	meta->info = NULL;
-	meta->fixed_columns = 0;
 
 	virg_tablet_unlock(v, tablet_id);
 
@@ -0,0 +1,40 @@
+#include "virginian.h"
+
+/**
+ * @ingroup tablet
+ * @brief Note that a tablet in memory has changed and must be written to disk
+ *
+ * Tablets read from disk start out clean, so that they can be evicted from their
+ * tablet slot or cleared without being written back, while newly allocated
+ * tablets are always dirty. Any function that changes a tablet must call this
+ * while it still holds a lock on the tablet, since an unlocked tablet can be
+ * evicted at any time. The locked tablet can't leave its slot, but the slot
+ * index is read without the slot mutex, so the slot is checked against the
+ * tablet pointer and every slot is searched if the lookup is wrong. Tablets
+ * loaded with only some of their columns can't be changed.
+ *
+ * @param v	Pointer to the state struct of the database system
+ * @param tab	Pointer to the locked tablet that has been changed
+ * @return VIRG_SUCCESS or VIRG_FAIL if the tablet isn't in a tablet slot
+ */
+int virg_tablet_dirty(virginian *v, virg_tablet_meta *tab)
+{
+	unsigned slot;
+
+	if(virg_index_find(&v->slot_index, tab->id, &slot) == VIRG_FAIL ||
+		slot >= VIRG_TABLET_SLOTS || v->tablet_slots[slot] != tab) {
+		for(slot = 0; slot < VIRG_TABLET_SLOTS; slot++)
+			if(v->tablet_slots[slot] == tab)
+				break;
+		VIRG_CHECK(slot == VIRG_TABLET_SLOTS,
+			"Couldn't find tablet to mark dirty")
+	}
+
+	// the columns that weren't loaded would be written over the disk copy
+	VIRG_CHECK(v->tablet_slot_cols[slot] != VIRG_ALL_COLUMNS,
+		"Changing a partly loaded tablet")
+
+	v->tablet_slot_dirty[slot] = 1;
+
+	return VIRG_SUCCESS;
+}
@@ -13,15 +13,16 @@
  * information. If not, however, we must perform a safe memory copy to transfer
  * its contents farther back in the tablet.
  *
+ * @param v	Pointer to the state struct of the database system
  * @param tab	Pointer to the tablet to be changed
  * @param size	Additional size to be added to the fixed block
  * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
  * call
  */
-int virg_tablet_growfixed(virg_tablet_meta *tab, size_t size)
+int virg_tablet_growfixed(virginian *v, virg_tablet_meta *tab, size_t size)
 {
 	// make sure you can add that much to the tablet
-	VIRG_CHECK(tab->size + size > VIRG_TABLET_SIZE, "Too big to grow, the tablet must be split");
+	VIRG_CHECK(tab->size + size > v->db.tablet_size, "Too big to grow, the tablet must be split");
 
 	// if the variable block has a zero size, we just move it back and return
 	// otherwise we have to copy its contents
@@ -0,0 +1,79 @@
+#include "virginian.h"
+
+/**
+ * Add the range of a tablet at offset with the given size to the list if it is
+ * wanted, noting where it is on disk, then move past it in the packed form
+ */
+static int iov_add(virg_tablet_meta *tab, struct iovec *iov, off_t *pos, int n,
+	off_t *disk, size_t offset, size_t size, int want)
+{
+	if(want) {
+		iov[n].iov_base = (char*)tab + offset;
+		iov[n].iov_len = size;
+		if(pos != NULL)
+			pos[n] = tab->packed ? disk[0] : (off_t)offset;
+		n++;
+	}
+
+	disk[0] += size;
+	return n;
+}
+
+/**
+ * @ingroup tablet
+ * @brief Describe the stored form of a tablet as a list of memory ranges
+ *
+ * A tablet has room for possible_rows rows in its key, key pointer and fixed
+ * columns, but only the first rows of each are used, so tablets are stored on
+ * disk packed, with the meta information, the used part of each of these
+ * columns and then the variable block placed one after another. This fills iov
+ * with the ranges of the tablet's memory that make up its packed form, in the
+ * order they are stored, for use with pwritev() or preadv(). Since they only
+ * depend on the meta information, which is always the first range, the same
+ * ranges can be used to read a packed tablet directly into the layout expected
+ * by virg_tablet_check() once its meta information has been read. A tablet
+ * without the packed flag was stored with its full layout, which is how full
+ * tablets are stored since both forms are the same for them.
+ *
+ * Only the parts of the tablet in the cols column set are listed, after the
+ * meta information and the key column which are always the first two ranges,
+ * and pos is filled with the position of each range relative to the start of
+ * the stored tablet so that ranges that aren't next to each other on disk can
+ * be read separately.
+ *
+ * @param tab	Pointer to the tablet
+ * @param cols	Column set of the parts of the tablet to be listed
+ * @param iov	Array of at least VIRG_TABLET_IOV ranges to be filled
+ * @param pos	Array filled with the position on disk of each range, or NULL
+ * @param len	Pointer through which the total size of the ranges is returned
+ * @return the number of ranges filled
+ */
+int virg_tablet_iov(virg_tablet_meta *tab, unsigned cols, struct iovec *iov,
+	off_t *pos, size_t *len)
+{
+	unsigned i;
+	int n = 0;
+	off_t disk = 0;
+	int other = (cols & VIRG_OTHER_BLOCKS) != 0;
+
+	n = iov_add(tab, iov, pos, n, &disk, 0, sizeof(virg_tablet_meta), 1);
+	n = iov_add(tab, iov, pos, n, &disk, tab->key_block,
+		tab->rows * tab->key_stride, 1);
+	n = iov_add(tab, iov, pos, n, &disk, tab->key_pointers_block,
+		tab->rows * tab->key_pointer_stride, other);
+
+	for(i = 0; i < tab->fixed_columns; i++)
+		n = iov_add(tab, iov, pos, n, &disk,
+			tab->fixed_block + tab->fixed_offset[i],
+			tab->rows * tab->fixed_stride[i], (cols >> i) & 1);
+
+	n = iov_add(tab, iov, pos, n, &disk, tab->variable_block,
+		tab->size - tab->variable_block, other);
+
+	len[0] = 0;
+	for(i = 0; i < (unsigned)n; i++)
+		len[0] += iov[i].iov_len;
+
+	return n;
+}
+
@@ -9,8 +9,9 @@
  * when a tablet is loaded into it. A lock increments this number, so a tablet
  * with a status of 2 or above can not be removed from that slot, even when the
  * database is closed. Thus, all locks held on a tablet must be released before
- * closing the tablet's database. If the tablet cannot be found to be locked,
- * then return VIRG_FAIL.
+ * closing the tablet's database. Locks are added with atomic operations through
+ * virg_tablet_pin(), and the tablet slot mutex is only taken if that fails. If
+ * the tablet cannot be found to be locked, then return VIRG_FAIL.
  *
  * @param v     Pointer to the state struct of the database system
  * @param id    ID of the tablet to be locked
@@ -24,26 +25,34 @@ int virg_tablet_lock(virginian *v, unsigned tablet_id)
 	virg_print_slots(v);
 #endif
 
+	unsigned i;
+
+	// lock without the mutex if possible
+	if(virg_tablet_pin(v, tablet_id, &i) == VIRG_SUCCESS)
+		return VIRG_SUCCESS;
+
 	// tablet slot lock
 	pthread_mutex_lock(&v->slot_lock);
 
-	// look for tablet to lock
-	unsigned i;
-	for(i = 0; i < VIRG_MEM_TABLETS; i++)
-		if(v->tablet_slot_status[i] > 0 && v->tablet_slot_ids[i] == tablet_id)
-			break;
+	// look for tablet to lock, waiting for it if it is still being read into
+	// its slot
+	int found;
+	while((found = virg_index_find(&v->slot_index, tablet_id, &i)) &&
+		v->tablet_slot_status[i] == VIRG_SLOT_CLAIMED)
+		pthread_cond_wait(&v->slot_cond, &v->slot_lock);
 
 	// check to make sure the tablet was found
+	if(!found) {
 #ifdef VIRG_DEBUG
-	if(i == VIRG_MEM_TABLETS) {
 		virg_print_slots(v);
 		fprintf(stderr, "looking for %u\n", tablet_id);
-	}
 #endif
-	VIRG_DEBUG_CHECK(i == VIRG_MEM_TABLETS, "Couldn't find tablet to lock");
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Couldn't find tablet to lock");
+	}
 
 	// increase the number of read locks
-	v->tablet_slot_status[i]++;
+	VIRG_ATOMIC_ADD(v->tablet_slot_status[i], 1);
 
 	// unlock tablet slots
 	pthread_mutex_unlock(&v->slot_lock);
@@ -55,8 +64,11 @@ int virg_tablet_lock(virginian *v, unsigned tablet_id)
  * @ingroup tablet
  * @brief Release a lock to a tablet
  *
- * Releases a lock on a tablet. If the tablet cannot be found, or if it is not
- * locked when the lock attempts to release, then VIRG_FAIL is returned.
+ * Releases a lock on a tablet. Since the tablet is locked it can't leave its
+ * slot, so the slot is normally found and the lock released with an atomic
+ * decrement without taking the tablet slot mutex. If the tablet cannot be
+ * found, or if it is not locked when the lock attempts to release, then
+ * VIRG_FAIL is returned.
  *
  * @param v     Pointer to the state struct of the database system
  * @param id    ID of the tablet to be unlocked
@@ -70,26 +82,35 @@ int virg_tablet_unlock(virginian *v, unsigned tablet_id)
 	virg_print_slots(v);
 #endif
 
+	unsigned i;
+
+	// the index read can be wrong during concurrent changes, but a locked
+	// slot with a matching id must be the one holding our lock
+	if(virg_index_find(&v->slot_index, tablet_id, &i) == VIRG_SUCCESS &&
+		i < VIRG_TABLET_SLOTS && v->tablet_slot_ids[i] == tablet_id &&
+		v->tablet_slot_status[i] > 1) {
+		VIRG_ATOMIC_ADD(v->tablet_slot_status[i], -1);
+		return VIRG_SUCCESS;
+	}
+
 	// tablet slot lock
 	pthread_mutex_lock(&v->slot_lock);
 	
 	// look for tablet, which must have a locked status
-	unsigned i;
-	for(i = 0; i < VIRG_MEM_TABLETS; i++)
-		if(v->tablet_slot_status[i] > 1 && v->tablet_slot_ids[i] == tablet_id)
-			break;
+	int found = virg_index_find(&v->slot_index, tablet_id, &i);
 
 	// check to make sure the tablet was found
+	if(!found || v->tablet_slot_status[i] <= 1) {
 #ifdef VIRG_DEBUG
-	if(i == VIRG_MEM_TABLETS) {
 		virg_print_slots(v);
 		fprintf(stderr, "looking for %u\n", tablet_id);
-	}
 #endif
-	VIRG_DEBUG_CHECK(i == VIRG_MEM_TABLETS, "Couldn't find tablet to unlock");
+		pthread_mutex_unlock(&v->slot_lock);
+		VIRG_CHECK(1, "Couldn't find tablet to unlock");
+	}
 
 	// decrease the number of read locks
-	v->tablet_slot_status[i]--;
+	VIRG_ATOMIC_ADD(v->tablet_slot_status[i], -1);
 
 	// unlock tablet slots
 	pthread_mutex_unlock(&v->slot_lock);
@@ -0,0 +1,47 @@
+#include "virginian.h"
+
+/**
+ * @ingroup tablet
+ * @brief Lock a tablet in memory without taking the tablet slot mutex
+ *
+ * This is the fast path used to lock tablets that are already in a main-memory
+ * tablet slot. The slot index is read without holding the slot mutex, which is
+ * safe because it is sized so that it never grows, but a concurrent eviction
+ * can make the slot it returns wrong. The lock is therefore added with an
+ * atomic compare-and-swap that only succeeds on a loaded, unclaimed slot, and
+ * once the slot is locked and can no longer be evicted we check that it still
+ * holds the tablet we were looking for. If any of this fails, VIRG_FAIL is
+ * returned without printing an error and the caller should fall back to
+ * looking up the tablet while holding the slot mutex.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param tablet_id	ID of the tablet to be locked
+ * @param slot_	Pointer through which the slot of the locked tablet is returned
+ * @return VIRG_SUCCESS if the tablet was locked, VIRG_FAIL otherwise
+ */
+int virg_tablet_pin(virginian *v, unsigned tablet_id, unsigned *slot_)
+{
+	unsigned slot;
+	int status;
+
+	if(virg_index_find(&v->slot_index, tablet_id, &slot) == VIRG_FAIL ||
+		slot >= VIRG_TABLET_SLOTS)
+		return VIRG_FAIL;
+
+	// add a lock only if the slot holds a tablet that isn't being moved
+	do {
+		status = v->tablet_slot_status[slot];
+		if(status < 1)
+			return VIRG_FAIL;
+	} while(!VIRG_ATOMIC_CAS(v->tablet_slot_status[slot], status, status + 1));
+
+	// the slot can't be evicted now, so make sure it has the right tablet
+	if(v->tablet_slot_ids[slot] != tablet_id) {
+		VIRG_ATOMIC_ADD(v->tablet_slot_status[slot], -1);
+		return VIRG_FAIL;
+	}
+
+	slot_[0] = slot;
+	return VIRG_SUCCESS;
+}
+
@@ -0,0 +1,72 @@
+#include "virginian.h"
+
+/**
+ * @ingroup tablet
+ * @brief Lay out a tablet for as many rows as fit into it
+ *
+ * Sizes the key, key pointer and fixed-size column blocks of a tablet for the
+ * most rows of its row stride that fit into a tablet, rounded down to a
+ * multiple of 16, and gives the rest of the tablet to the variable block. Data
+ * tablets are laid out like this from the start, when they are created and
+ * when columns are added to them, so that rows are only ever appended and
+ * never moved to make room for more, which virg_tablet_addrows() would do
+ * each time a tablet fills up. Since tablets are stored packed, see
+ * virg_tablet_iov(), the unused rows are never written to disk. Rows that are
+ * already in the tablet are moved to the new layout, so this is also used to
+ * lay out a tablet again once its row stride has changed, which fails if the
+ * rows no longer fit.
+ *
+ * @param v     Pointer to the state struct of the database system
+ * @param tab	Pointer to the tablet to be laid out
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_tablet_presize(virginian *v, virg_tablet_meta *tab)
+{
+	unsigned i;
+	size_t offsets[VIRG_MAX_COLUMNS];
+
+	unsigned possible_rows = ((v->db.tablet_size - sizeof(virg_tablet_meta) -
+		VIRG_TABLET_INITIAL_FIXED) / tab->row_stride) & 0xFFFFFFF0;
+	VIRG_CHECK(possible_rows < tab->rows, "Too many rows for the tablet")
+
+	size_t key_pointers_block = tab->key_block +
+		tab->key_stride * possible_rows;
+	size_t fixed_block = key_pointers_block +
+		tab->key_pointer_stride * possible_rows;
+	offsets[0] = 0;
+	for(i = 1; i < tab->fixed_columns; i++)
+		offsets[i] = offsets[i-1] + tab->fixed_stride[i-1] * possible_rows;
+
+	// move the rows, from the front of the tablet if the blocks shrink and from
+	// the back if they grow, so that no column overwrites the next one
+	if(tab->rows > 0 && possible_rows < tab->possible_rows) {
+		memmove((char*)tab + key_pointers_block,
+			(char*)tab + tab->key_pointers_block,
+			tab->rows * tab->key_pointer_stride);
+		for(i = 0; i < tab->fixed_columns; i++)
+			memmove((char*)tab + fixed_block + offsets[i],
+				(char*)tab + tab->fixed_block + tab->fixed_offset[i],
+				tab->rows * tab->fixed_stride[i]);
+	}
+	else if(tab->rows > 0 && possible_rows > tab->possible_rows) {
+		for(i = tab->fixed_columns; i > 0; i--)
+			memmove((char*)tab + fixed_block + offsets[i-1],
+				(char*)tab + tab->fixed_block + tab->fixed_offset[i-1],
+				tab->rows * tab->fixed_stride[i-1]);
+		memmove((char*)tab + key_pointers_block,
+			(char*)tab + tab->key_pointers_block,
+			tab->rows * tab->key_pointer_stride);
+	}
+
+	tab->possible_rows = possible_rows;
+	tab->key_pointers_block = key_pointers_block;
+	tab->fixed_block = fixed_block;
+	for(i = 0; i < tab->fixed_columns; i++)
+		tab->fixed_offset[i] = offsets[i];
+	tab->variable_block = tab->key_block + tab->row_stride * possible_rows;
+	tab->size = v->db.tablet_size;
+
+	return VIRG_SUCCESS;
+}
+
@@ -1,13 +1,33 @@
 #include "virginian.h"
 
+/**
+ * Give up the place in the spill file of a result tablet if it has one, with
+ * the tablet slot mutex held, returning 0 if it doesn't
+ */
+static int remove_spilled(virginian *v, unsigned id)
+{
+	unsigned place;
+
+	if(virg_index_find(&v->spill_index, id, &place) == VIRG_FAIL)
+		return 0;
+
+	virg_index_remove(&v->spill_index, id);
+	v->spill_free[v->spill_free_count++] = place;
+
+	return 1;
+}
+
 /**
  * @ingroup tablet
  * @brief Deletes a tablet from memory and disk
  *
  * Sets the in-memory tablet slot and disk slot of a tablet to unused, removing
- * that tablet. Note that this function is used for removing result tablets and
- * does not change the variables of other tablets in the tablet string, so it
- * will leave that string inconsistent.
+ * that tablet. The disk slot is pushed onto the stack of unused disk slots to
+ * be given to the next tablet placed by virg_db_place(), and the place of a
+ * spilled result tablet in the spill file is freed the same way, see
+ * virg_db_spill(). Note that this function is used for removing result
+ * tablets and does not change the variables of other tablets in the tablet
+ * string, so it will leave that string inconsistent.
  *
  * @param v     Pointer to the state struct of the database system
  * @param id    ID of the tablet to be removed
@@ -23,33 +43,56 @@ int virg_tablet_remove(virginian *v, unsigned id)
 	virg_print_slots(v);
 #endif
 
+	// tablet slot lock
+	pthread_mutex_lock(&v->slot_lock);
+
 	// find tablet with id
-	for(i = 0; i < VIRG_MEM_TABLETS; i++) {
-		if(v->tablet_slot_status[i] != 0 && v->tablet_slot_ids[i] == id) {
-			VIRG_DEBUG_CHECK(v->tablet_slot_status[i] > 1, "Trying to remove locked tablet");
+	if(virg_index_find(&v->slot_index, id, &i) == VIRG_SUCCESS) {
+		// claim the slot so that it can't be locked while it is emptied
+		if(!VIRG_ATOMIC_CAS(v->tablet_slot_status[i], 1, VIRG_SLOT_CLAIMED)) {
+			pthread_mutex_unlock(&v->slot_lock);
+			VIRG_CHECK(1, "Trying to remove locked tablet")
+		}
+
+		// set in-memory tablet slot to unused
+		virg_tablet_meta *tab = v->tablet_slots[i];
+		virg_tablet_info *info = tab->info;
+		if(info != NULL) {
+			info->used = 0;
+			virg_index_remove(&v->disk_index, id);
+			v->disk_free[v->disk_free_count++] = info->disk_slot;
+		}
 
-			// set in-memory tablet slot to unused
-			virg_tablet_meta *tab = v->tablet_slots[i];
-			virg_tablet_info *info = tab->info;
-			if(info != NULL)
-				info->used = 0;
+		if(VIRG_IS_RESULT(id))
+			remove_spilled(v, id);
 
-			v->tablet_slot_status[i] = 0;
+		virg_index_remove(&v->slot_index, id);
+		v->tablet_slot_status[i] = 0;
+		if(i < VIRG_MEM_TABLETS)
 			v->tablet_slots_taken--;
 
-			return VIRG_SUCCESS;
-		}
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_SUCCESS;
+	}
+
+	// a result tablet that isn't in memory may have been spilled
+	if(VIRG_IS_RESULT(id) && remove_spilled(v, id)) {
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_SUCCESS;
 	}
 
 	// look for the tablet on disk and set its spot to unused if found
-	virg_db *db = &v->db;
-	for(i = 0; i < db->alloced_tablets; i++) {
-		if(db->tablet_info[i].used == 1 && db->tablet_info[i].id == id) {
-			db->tablet_info[i].used = 0;
-			return VIRG_SUCCESS;
-		}
+	if(virg_index_find(&v->disk_index, id, &i) == VIRG_SUCCESS) {
+		v->db.tablet_info[i].used = 0;
+		virg_index_remove(&v->disk_index, id);
+		v->disk_free[v->disk_free_count++] = i;
+
+		pthread_mutex_unlock(&v->slot_lock);
+		return VIRG_SUCCESS;
 	}
 
+	pthread_mutex_unlock(&v->slot_lock);
+
 	fprintf(stderr, "Could not find tablet to remove\n");
 	return VIRG_FAIL;
 }
@@ -0,0 +1,95 @@
+#include "virginian.h"
+#include <math.h>
+
+/**
+ * Widen the range of min and max to include the value of type type at val,
+ * making it the whole range if first is set. A NaN makes the range of a
+ * floating point column unbounded since it doesn't compare with anything.
+ */
+static void zone_add(virg_t type, char *val, virg_var *min, virg_var *max,
+	int first)
+{
+	switch(type) {
+		case VIRG_INT: {
+			int x = ((int*)val)[0];
+			if(first || x < min->i) min->i = x;
+			if(first || x > max->i) max->i = x;
+			break;
+		}
+		case VIRG_INT64: {
+			long long int x = ((long long int*)val)[0];
+			if(first || x < min->li) min->li = x;
+			if(first || x > max->li) max->li = x;
+			break;
+		}
+		case VIRG_FLOAT: {
+			float x = ((float*)val)[0];
+			if(x != x) {
+				min->f = -INFINITY;
+				max->f = INFINITY;
+				break;
+			}
+			if(first || x < min->f) min->f = x;
+			if(first || x > max->f) max->f = x;
+			break;
+		}
+		case VIRG_DOUBLE: {
+			double x = ((double*)val)[0];
+			if(x != x) {
+				min->d = -INFINITY;
+				max->d = INFINITY;
+				break;
+			}
+			if(first || x < min->d) min->d = x;
+			if(first || x > max->d) max->d = x;
+			break;
+		}
+		case VIRG_CHAR: {
+			char x = val[0];
+			if(first || x < min->c) min->c = x;
+			if(first || x > max->c) max->c = x;
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+/**
+ * @ingroup tablet
+ * @brief Update the zone map of a tablet with rows that have been added to it
+ *
+ * The zone map of a tablet is the range of values of its key and each of its
+ * fixed-size columns, stored in its meta information, which lets the virtual
+ * machine skip tablets that can't have any rows matching a query with
+ * virg_vm_skip(). It is kept up to date by virg_table_insert() one row at a
+ * time. Passing 0 as first rebuilds the zone map from all of the rows, which
+ * is done when a tablet is read without a valid one.
+ *
+ * @param tab	Pointer to the tablet, all of which must be in memory
+ * @param first	First row not yet in the zone map
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_tablet_zones(virg_tablet_meta *tab, unsigned first)
+{
+	unsigned row, i;
+	char *key = (char*)tab + tab->key_block;
+	char *fixed = (char*)tab + tab->fixed_block;
+
+	for(row = first; row < tab->rows; row++) {
+		zone_add(tab->key_type, key + tab->key_stride * row,
+			&tab->key_min, &tab->key_max, row == 0);
+
+		for(i = 0; i < tab->fixed_columns; i++)
+			zone_add(tab->fixed_type[i], fixed + tab->fixed_offset[i] +
+				tab->fixed_stride[i] * row, &tab->fixed_min[i],
+				&tab->fixed_max[i], row == 0);
+	}
+
+	if(first == 0)
+		tab->zones = 1;
+
+	return VIRG_SUCCESS;
+}
+
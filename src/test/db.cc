@@ -7,7 +7,7 @@ class DBTest : public VirginianTest {
 	protected:
 	
 	void CheckDBIntegrity(virg_db *db) {
-		ASSERT_EQ(db->block_size, sizeof(virg_db) + sizeof(virg_tablet_info) * db->alloced_tablets);
+		ASSERT_EQ(db->alloced_tablets % VIRG_EXTENT_TABLETS, 0u);
 
 		for(unsigned i = 0; i < db->alloced_tablets; i++) {
 			ASSERT_TRUE(db->tablet_info[i].used == 0 || db->tablet_info[i].used == 1);
@@ -40,5 +40,625 @@ TEST_F(DBTest, DBManipulation) {
 	simpledb_clear(v);
 }
 
+TEST_F(DBTest, FileMap) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 500000);
+	virg_db_close(v);
+
+	v->use_filemap = 1;
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_TRUE(v->dbmap != NULL);
+	CheckDBIntegrity(&v->db);
+
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 500000u);
+
+	// tablets loaded from disk should point into the file mapping
+	virg_tablet_meta *tab;
+	virg_db_load(v, v->db.first_tablet[0], &tab);
+	EXPECT_TRUE((char*)tab >= v->dbmap && (char*)tab < v->dbmap + VIRG_FILEMAP_SIZE);
+	virg_tablet_unlock(v, tab->id);
+
+	// rows added in place must still be there after reopening
+	simpledb_addrows(v, 100000);
+	virg_db_close(v);
+	ASSERT_TRUE(v->dbmap == NULL);
+
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 600000u);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, DirtyTracking) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 100000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+
+	// tablets read by a scan are clean
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 100000u);
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			EXPECT_FALSE(v->tablet_slot_dirty[i]);
+		}
+
+	// inserting a row dirties the tablet it is written to
+	simpledb_addrows(v, 1);
+	unsigned slot;
+	ASSERT_EQ(virg_index_find(&v->slot_index, v->db.write_cursor[0], &slot), VIRG_SUCCESS);
+	EXPECT_TRUE(v->tablet_slot_dirty[slot]);
+
+	// and the row is written back when the database is closed
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 100001u);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, PackedTablets) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000);
+	virg_db_close(v);
+
+	// only the used rows of the partly filled tablet are written
+	struct stat st;
+	ASSERT_EQ(stat("testdb", &st), 0);
+	EXPECT_LT((size_t)st.st_size,
+		VIRG_DISK_OFFSET(&v->db, 0) + v->db.tablet_size / 4);
+
+	// and they are put back in place when it is read
+	for(int filemap = 0; filemap < 2; filemap++) {
+		v->use_filemap = filemap;
+		ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+
+		virg_tablet_meta *tab;
+		ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+		EXPECT_TRUE(tab->packed);
+		EXPECT_EQ(tab->rows, 1000u);
+		EXPECT_LT(tab->rows, tab->possible_rows);
+		virg_tablet_check(tab);
+
+		int *key = (int*)((char*)tab + tab->key_block);
+		int *col2 = (int*)((char*)tab + tab->fixed_block + tab->fixed_offset[2]);
+		for(unsigned i = 0; i < tab->rows; i++) {
+			ASSERT_EQ(key[i], (int)i);
+			ASSERT_EQ(col2[i], (int)i + 2);
+		}
+		virg_tablet_unlock(v, tab->id);
+
+		virg_db_close(v);
+	}
+
+	v->use_filemap = 0;
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, TabletSize) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+
+	// tablet sizes must be powers of two in range
+	v->tablet_size = 3 * VIRG_TABLET_MIN_SIZE;
+	EXPECT_EQ(virg_db_create(v, "testdb"), VIRG_FAIL);
+	v->tablet_size = VIRG_TABLET_MAX_SIZE * 2;
+	EXPECT_EQ(virg_db_create(v, "testdb"), VIRG_FAIL);
+
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_size, (size_t)VIRG_TABLET_MIN_SIZE);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 100000);
+	virg_db_close(v);
+
+	// the database keeps its tablet size whatever the default is
+	v->tablet_size = VIRG_TABLET_SIZE;
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	EXPECT_EQ(v->db.tablet_size, (size_t)VIRG_TABLET_MIN_SIZE);
+	EXPECT_EQ(v->slot_size, (size_t)VIRG_TABLET_MIN_SIZE);
+
+	unsigned rows = 0, tablets = 1;
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		virg_tablet_check(tab);
+		int *key = (int*)((char*)tab + tab->key_block);
+		for(unsigned i = 0; i < tab->rows; i++, rows++)
+			ASSERT_EQ(key[i], (int)rows);
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+		tablets++;
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_EQ(rows, 100000u);
+	EXPECT_GT(tablets, 4u);
+
+	// a new database has the default size again
+	virg_db_close(v);
+	unlink("testdb");
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_size, (size_t)VIRG_TABLET_SIZE);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, ResizePool) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+
+	// budgets are rounded down to whole slots, with a minimum
+	ASSERT_EQ(virg_db_resize(v, 1), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_count, (unsigned)VIRG_MEM_MIN_TABLETS);
+	ASSERT_EQ(virg_db_resize(v, 10 * VIRG_TABLET_MIN_SIZE + 1), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_count, 10u);
+
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 500000);
+
+	// only the slots in the budget have been used
+	for(unsigned i = 10; i < VIRG_MEM_TABLETS; i++) {
+		EXPECT_EQ(v->tablet_slot_status[i], 0);
+		EXPECT_TRUE(v->tablet_slot_alloc[i] == NULL);
+	}
+
+	// growing the pool lets the whole table be loaded
+	ASSERT_EQ(virg_db_resize(v, 64 * VIRG_TABLET_MIN_SIZE), VIRG_SUCCESS);
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 500000u);
+	EXPECT_GT(v->tablet_slots_taken, 10u);
+
+	// a locked tablet in a slot being removed stops the pool from shrinking
+	unsigned slot = 0;
+	while(v->tablet_slot_status[slot] != 1 || slot < 10)
+		slot++;
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->tablet_slot_ids[slot], &tab), VIRG_SUCCESS);
+	EXPECT_EQ(virg_db_resize(v, 10 * VIRG_TABLET_MIN_SIZE), VIRG_FAIL);
+	EXPECT_EQ(v->slot_count, 64u);
+	EXPECT_EQ(v->tablet_slot_status[slot], 2);
+	virg_tablet_unlock(v, tab->id);
+
+	// otherwise the tablets are written and the slots emptied
+	simpledb_addrows(v, 1000);
+	ASSERT_EQ(virg_db_resize(v, 10 * VIRG_TABLET_MIN_SIZE), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_count, 10u);
+	EXPECT_LE(v->tablet_slots_taken, 10u);
+	for(unsigned i = 10; i < VIRG_MEM_TABLETS; i++)
+		EXPECT_EQ(v->tablet_slot_status[i], 0);
+
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 501000u);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 501000u);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, Extents) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_EQ(virg_db_resize(v, 1), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 200000);
+
+	// note where the tablets written so far are on disk
+	unsigned alloced = v->db.alloced_tablets;
+	EXPECT_EQ(alloced, (unsigned)VIRG_EXTENT_TABLETS);
+	std::vector<std::pair<unsigned, unsigned> > placed;
+	for(unsigned i = 0; i < alloced; i++)
+		if(v->db.tablet_info[i].used)
+			placed.push_back(std::make_pair(v->db.tablet_info[i].id, i));
+	ASSERT_FALSE(placed.empty());
+
+	// adding extents leaves every tablet in its disk slot
+	simpledb_addrows(v, 420000);
+	EXPECT_GT(v->db.alloced_tablets, alloced);
+	CheckDBIntegrity(&v->db);
+	for(unsigned i = 0; i < placed.size(); i++) {
+		unsigned disk_slot;
+		ASSERT_TRUE(virg_index_find(&v->disk_index, placed[i].first,
+			&disk_slot));
+		EXPECT_EQ(disk_slot, placed[i].second);
+	}
+
+	// and the tablet info of every extent is found again
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	CheckDBIntegrity(&v->db);
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 620000u);
+
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	int *key = (int*)((char*)tab + tab->key_block);
+	for(unsigned i = 0; i < tab->rows; i++)
+		ASSERT_EQ(key[i], (int)i);
+	virg_tablet_unlock(v, tab->id);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, Compact) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_EQ(virg_db_resize(v, 1), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 600000);
+
+	// leave a quarter of the rows of each tablet in the middle of the table
+	virg_tablet_meta *tab;
+	unsigned rows = 0, tablets = 0;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		if(tab->id != v->db.first_tablet[0] && !tab->last_tablet &&
+			tab->id != v->db.write_cursor[0]) {
+			tab->rows /= 4;
+			virg_tablet_zones(tab, 0);
+			virg_tablet_dirty(v, tab);
+		}
+		rows += tab->rows;
+		tablets++;
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_GT(v->db.alloced_tablets, (unsigned)VIRG_EXTENT_TABLETS);
+
+	struct stat st;
+	ASSERT_EQ(stat("testdb", &st), 0);
+	off_t size = st.st_size;
+
+	// the tablets are joined and packed into the head of the file
+	ASSERT_EQ(virg_db_compact(v), VIRG_SUCCESS);
+	CheckDBIntegrity(&v->db);
+	EXPECT_EQ(v->db.alloced_tablets, (unsigned)VIRG_EXTENT_TABLETS);
+	ASSERT_EQ(stat("testdb", &st), 0);
+	EXPECT_LT(st.st_size, size);
+
+	unsigned used = 0;
+	for(unsigned i = 0; i < v->db.alloced_tablets; i++)
+		if(v->db.tablet_info[i].used) {
+			EXPECT_EQ(i, used++);
+		}
+	EXPECT_EQ(v->disk_free_count, v->db.alloced_tablets - used);
+	EXPECT_EQ(v->disk_free[v->disk_free_count - 1], used);
+
+	// and the rows are all still there in order after reopening
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	CheckDBIntegrity(&v->db);
+	unsigned n;
+	virg_table_numrows(v, 0, &n);
+	EXPECT_EQ(n, rows);
+
+	unsigned joined = 0;
+	int last = -1;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		int *key = (int*)((char*)tab + tab->key_block);
+		for(unsigned i = 0; i < tab->rows; i++) {
+			ASSERT_GT(key[i], last);
+			last = key[i];
+		}
+		joined++;
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_LT(joined, tablets);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, HugePages) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->use_hugepages = 1;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 1000000);
+
+	// each slot notes what backs it, and huge pages are aligned to their size
+	unsigned used = 0;
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++) {
+		if(v->tablet_slot_alloc[i] == NULL) {
+			EXPECT_EQ(v->tablet_slot_pages[i], VIRG_PAGES_NONE);
+			continue;
+		}
+		used++;
+		EXPECT_NE(v->tablet_slot_pages[i], VIRG_PAGES_NONE);
+		if(v->tablet_slot_pages[i] != VIRG_PAGES_SMALL) {
+			EXPECT_EQ((size_t)v->tablet_slot_alloc[i] % VIRG_HUGE_PAGE, 0u);
+		}
+	}
+	EXPECT_GT(used, 0u);
+
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 1000000u);
+
+	// tablets smaller than a huge page use normal pages
+	virg_db_close(v);
+	unlink("testdb");
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	simpledb_addrows(v, 1000);
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_alloc[i] != NULL) {
+			EXPECT_EQ(v->tablet_slot_pages[i], VIRG_PAGES_SMALL);
+		}
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, NumaPlacement) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	EXPECT_GE(v->numa_nodes, 1u);
+
+	// pretend that every cpu is on the second of two nodes
+	v->numa_nodes = 2;
+	v->numa_node_ids[0] = 0;
+	v->numa_node_ids[1] = 1;
+	for(unsigned i = 0; i < VIRG_NUMA_CPUS; i++)
+		if(v->numa_cpu_node[i] != VIRG_NUMA_NONE)
+			v->numa_cpu_node[i] = 1;
+	EXPECT_EQ(virg_db_localnode(v), 1u);
+
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_EQ(virg_db_resize(v, 64 * VIRG_TABLET_MIN_SIZE), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	// more rows than fit into one tablet
+	simpledb_addrows(v, 20000);
+
+	// while there are local slots free, tablets are only put in those
+	unsigned used = 0;
+	for(unsigned i = 0; i < v->slot_count; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			EXPECT_EQ(VIRG_SLOT_NODE(v, i), 1u);
+			used++;
+		}
+	EXPECT_GT(used, 1u);
+	EXPECT_LE(used, 32u);
+
+	// threads are pinned to the node's cpus, those for the empty node run
+	// anywhere, and the scan sees every row
+	v->use_multi = 1;
+	virg_reader *r;
+	ASSERT_EQ(virg_query(v, &r, "select id from test"), VIRG_SUCCESS);
+	unsigned rows;
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 20000u);
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+
+	// tablets read ahead of a scan by the prefetch thread are put on the node
+	// of the scanning thread
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	v->use_multi = 0;
+	ASSERT_EQ(virg_query(v, &r, "select id from test"), VIRG_SUCCESS);
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 20000u);
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+	virg_db_prefetch_stop(v);
+	for(unsigned i = 0; i < v->slot_count; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			EXPECT_EQ(VIRG_SLOT_NODE(v, i), 1u);
+		}
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, LoadNextFailure) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	v->readahead = 0;
+
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	ASSERT_FALSE(tab->last_tablet);
+	unsigned id = tab->next, slot;
+	ASSERT_EQ(virg_index_find(&v->disk_index, id, &slot), VIRG_SUCCESS);
+	virg_index_remove(&v->disk_index, id);
+
+	// a tablet that can't be loaded leaves the current one locked
+	virg_tablet_meta *t = tab;
+	EXPECT_EQ(virg_db_loadnext(v, &t), VIRG_FAIL);
+	EXPECT_EQ(t, tab);
+	EXPECT_EQ(virg_lock_sum(v), 1);
+	unsigned rows;
+	EXPECT_EQ(virg_table_numrows(v, 0, &rows), VIRG_FAIL);
+	EXPECT_EQ(virg_lock_sum(v), 1);
+
+	virg_index_insert(&v->disk_index, id, slot);
+	EXPECT_EQ(virg_db_loadnext(v, &t), VIRG_SUCCESS);
+	EXPECT_EQ(t->id, id);
+	virg_tablet_unlock(v, t->id);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, ColumnLoad) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+
+	// only the requested column is read along with the key
+	virg_tablet_meta *tab;
+	unsigned slot;
+	ASSERT_EQ(virg_db_loadcols(v, v->db.first_tablet[0], 1 << 1, &tab),
+		VIRG_SUCCESS);
+	ASSERT_EQ(virg_index_find(&v->slot_index, tab->id, &slot), VIRG_SUCCESS);
+	EXPECT_EQ(v->tablet_slot_cols[slot], 1u << 1);
+	EXPECT_EQ(virg_tablet_dirty(v, tab), VIRG_FAIL);
+
+	int *key = (int*)((char*)tab + tab->key_block);
+	int *col1 = (int*)((char*)tab + tab->fixed_block + tab->fixed_offset[1]);
+	for(unsigned i = 0; i < tab->rows; i++) {
+		ASSERT_EQ(key[i], (int)i);
+		ASSERT_EQ(col1[i], (int)i + 1);
+	}
+	virg_tablet_unlock(v, tab->id);
+
+	// the rest is read when the whole tablet is needed
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	EXPECT_EQ(v->tablet_slot_cols[slot], VIRG_ALL_COLUMNS);
+	virg_tablet_check(tab);
+	int *col0 = (int*)((char*)tab + tab->fixed_block + tab->fixed_offset[0]);
+	int *col2 = (int*)((char*)tab + tab->fixed_block + tab->fixed_offset[2]);
+	for(unsigned i = 0; i < tab->rows; i++) {
+		ASSERT_EQ(col0[i], (int)i);
+		ASSERT_EQ(col2[i], (int)i + 2);
+	}
+	virg_tablet_unlock(v, tab->id);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, ReadAhead) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_NE(v->db.first_tablet[0], v->db.last_tablet[0]);
+
+	// walking the table starts the prefetch thread
+	v->readahead = 4;
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 1000000u);
+	EXPECT_TRUE(v->prefetch_running);
+
+	// once stopped, the prefetch thread leaves no tablets locked or claimed
+	ASSERT_EQ(virg_db_prefetch_stop(v), VIRG_SUCCESS);
+	EXPECT_FALSE(v->prefetch_running);
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++) {
+		EXPECT_GE(v->tablet_slot_status[i], 0);
+		EXPECT_LE(v->tablet_slot_status[i], 1);
+	}
+
+	// nothing is read ahead with read-ahead disabled
+	v->readahead = 0;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 1000000u);
+	EXPECT_FALSE(v->prefetch_running);
+
+	simpledb_clear(v);
+}
+
+TEST_F(DBTest, ReplacementPolicy) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	virg_init(v);
+	unsigned slot;
+
+	// fill every slot with an unlocked tablet, as if loaded in order
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++) {
+		v->tablet_slot_ids[i] = i;
+		virg_db_admit(v, i);
+		v->tablet_slot_status[i] = 1;
+	}
+	v->tablet_slots_taken = VIRG_MEM_TABLETS;
+
+	// clock skips referenced and locked tablets
+	v->slot_policy = VIRG_CLOCK;
+	v->tablet_slot_counter = 0;
+	v->tablet_slot_ref[0] = 1;
+	v->tablet_slot_status[1] = 2;
+	ASSERT_EQ(virg_db_victim(v, &slot), VIRG_SUCCESS);
+	EXPECT_EQ(slot, 2u);
+	EXPECT_EQ(v->tablet_slot_status[2], VIRG_SLOT_CLAIMED);
+	EXPECT_EQ(v->tablet_slot_ref[0], 0);
+
+	// the evicted tablet was on probation, so it comes back to the main queue
+	v->tablet_slot_ids[2] = 2;
+	virg_db_admit(v, 2);
+	v->tablet_slot_status[2] = 1;
+	EXPECT_EQ(v->tablet_slot_queue[2], 1);
+
+	// 2Q evicts the oldest tablet on probation first
+	v->slot_policy = VIRG_2Q;
+	ASSERT_EQ(virg_db_victim(v, &slot), VIRG_SUCCESS);
+	EXPECT_EQ(slot, 0u);
+	v->tablet_slot_status[0] = 1;
+
+	// with only a few tablets on probation, the main queue is used
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		v->tablet_slot_queue[i] = i > 4;
+	ASSERT_EQ(virg_db_victim(v, &slot), VIRG_SUCCESS);
+	EXPECT_GT(slot, 4u);
+	v->tablet_slot_status[slot] = 1;
+
+	// nothing can be evicted if everything is locked
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		v->tablet_slot_status[i] = 2;
+	EXPECT_EQ(virg_db_victim(v, &slot), VIRG_FAIL);
+
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		v->tablet_slot_status[i] = 0;
+	v->tablet_slots_taken = 0;
+	virg_close(v);
+	free(v);
+#ifndef VIRG_NOCUDA
+	cudaThreadExit();
+#endif
+}
+
 }
 
@@ -0,0 +1,91 @@
+#include "virginian.h"
+#include "test/test.h"
+
+namespace {
+
+class IndexTest : public VirginianTest {
+};
+
+TEST_F(IndexTest, IndexManipulation) {
+	virg_index idx;
+	unsigned val;
+
+	ASSERT_EQ(virg_index_init(&idx, 10), VIRG_SUCCESS);
+	ASSERT_TRUE(VIRG_ISPWR2(idx.size));
+	ASSERT_GE(idx.size, 10u);
+	EXPECT_EQ(virg_index_find(&idx, 5, &val), VIRG_FAIL);
+
+	// insert enough to grow the index several times
+	for(unsigned i = 0; i < 10000; i++)
+		ASSERT_EQ(virg_index_insert(&idx, i * 7, i), VIRG_SUCCESS);
+	EXPECT_EQ(idx.used, 10000u);
+	EXPECT_LE(idx.used * 2, idx.size);
+
+	for(unsigned i = 0; i < 10000; i++) {
+		ASSERT_EQ(virg_index_find(&idx, i * 7, &val), VIRG_SUCCESS);
+		ASSERT_EQ(val, i);
+	}
+	EXPECT_EQ(virg_index_find(&idx, 1, &val), VIRG_FAIL);
+
+	// replacing a value doesn't add an entry
+	virg_index_insert(&idx, 14, 100);
+	virg_index_find(&idx, 14, &val);
+	EXPECT_EQ(val, 100u);
+	EXPECT_EQ(idx.used, 10000u);
+
+	// remove every other key, the rest must still be reachable
+	for(unsigned i = 0; i < 10000; i += 2)
+		ASSERT_EQ(virg_index_remove(&idx, i * 7), VIRG_SUCCESS);
+	EXPECT_EQ(virg_index_remove(&idx, 0), VIRG_FAIL);
+	EXPECT_EQ(idx.used, 5000u);
+
+	for(unsigned i = 0; i < 10000; i++)
+		ASSERT_EQ(virg_index_find(&idx, i * 7, NULL),
+			i % 2 ? VIRG_SUCCESS : VIRG_FAIL);
+
+	virg_index_clear(&idx);
+	EXPECT_EQ(idx.used, 0u);
+	EXPECT_EQ(virg_index_find(&idx, 7, &val), VIRG_FAIL);
+
+	virg_index_free(&idx);
+}
+
+TEST_F(IndexTest, SlotIndex) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 500000);
+
+	// every tablet in memory must be in the slot index and nothing else
+	unsigned slot, loaded = 0;
+	for(unsigned i = 0; i < VIRG_MEM_TABLETS; i++)
+		if(v->tablet_slot_status[i] != 0) {
+			ASSERT_EQ(virg_index_find(&v->slot_index, v->tablet_slot_ids[i],
+				&slot), VIRG_SUCCESS);
+			EXPECT_EQ(slot, i);
+			loaded++;
+		}
+	EXPECT_EQ(v->slot_index.used, loaded);
+
+	// after closing, every tablet is on disk and can be found there
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	EXPECT_EQ(v->slot_index.used, 0u);
+
+	unsigned used = 0;
+	for(unsigned i = 0; i < v->db.alloced_tablets; i++)
+		if(v->db.tablet_info[i].used) {
+			ASSERT_EQ(virg_index_find(&v->disk_index, v->db.tablet_info[i].id,
+				&slot), VIRG_SUCCESS);
+			EXPECT_EQ(slot, i);
+			used++;
+		}
+	EXPECT_EQ(v->disk_index.used, used);
+
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 500000u);
+
+	simpledb_clear(v);
+}
+
+}
+
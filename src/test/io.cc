@@ -0,0 +1,91 @@
+#include "virginian.h"
+#include "test/test.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+class IOTest : public VirginianTest {
+	protected:
+
+	static const unsigned reqs = 256;
+	static const unsigned len = 4096;
+};
+
+static void io_test_done(virg_io_req *req)
+{
+	if(req->result < 0 || (size_t)req->result != req->len)
+		__sync_fetch_and_add((unsigned*)req->arg, 1);
+}
+
+TEST_F(IOTest, ReadWrite) {
+	virg_io io;
+	virg_io_req req[reqs];
+	struct iovec iov[reqs][2];
+	char *buf = (char*)malloc(reqs * len);
+	char *in = (char*)malloc(reqs * len);
+	unsigned failed = 0;
+
+	int fd = open("testio", O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(virg_io_init(&io), VIRG_SUCCESS);
+
+	for(unsigned i = 0; i < reqs * len; i++)
+		buf[i] = (char)(i * 31 + i / len);
+
+	// write blocks out of order so they complete in parallel
+	for(unsigned i = 0; i < reqs; i++) {
+		unsigned b = (i * 7) % reqs;
+		req[i].fd = fd;
+		req[i].write = 1;
+		// each block is split in two ranges
+		iov[i][0].iov_base = buf + b * len;
+		iov[i][0].iov_len = len / 4;
+		iov[i][1].iov_base = buf + b * len + len / 4;
+		iov[i][1].iov_len = len - len / 4;
+		req[i].iov = iov[i];
+		req[i].iovcnt = 2;
+		req[i].len = len;
+		req[i].offset = (off_t)b * len;
+		req[i].done = io_test_done;
+		req[i].arg = &failed;
+		ASSERT_EQ(virg_io_submit(&io, &req[i]), VIRG_SUCCESS);
+	}
+	ASSERT_EQ(virg_io_drain(&io), VIRG_SUCCESS);
+	EXPECT_EQ(io.inflight, 0u);
+	EXPECT_EQ(failed, 0u);
+
+	// read them back
+	memset(in, 0, reqs * len);
+	for(unsigned i = 0; i < reqs; i++) {
+		req[i].write = 0;
+		iov[i][0].iov_base = in + (i * 7) % reqs * len;
+		iov[i][0].iov_len = len;
+		req[i].iov = iov[i];
+		req[i].iovcnt = 1;
+		ASSERT_EQ(virg_io_submit(&io, &req[i]), VIRG_SUCCESS);
+	}
+	ASSERT_EQ(virg_io_drain(&io), VIRG_SUCCESS);
+	EXPECT_EQ(failed, 0u);
+	EXPECT_EQ(memcmp(buf, in, reqs * len), 0);
+
+	// reading past the end of the file fails
+	iov[0][0].iov_base = in;
+	iov[0][0].iov_len = len;
+	req[0].iov = iov[0];
+	req[0].iovcnt = 1;
+	req[0].offset = (off_t)reqs * len;
+	ASSERT_EQ(virg_io_submit(&io, &req[0]), VIRG_SUCCESS);
+	ASSERT_EQ(virg_io_drain(&io), VIRG_SUCCESS);
+	EXPECT_EQ(failed, 1u);
+
+	EXPECT_EQ(virg_io_free(&io), VIRG_SUCCESS);
+	close(fd);
+	unlink("testio");
+	free(buf);
+	free(in);
+}
+
+}
+
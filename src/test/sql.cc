@@ -103,6 +103,7 @@ TEST_F(SQLTest, ExecuteMulti) {
 	simpledb_clear(v);
 }
 
+#ifndef VIRG_NOCUDA
 TEST_F(SQLTest, ExecuteGPU) {
 	virginian *v = simpledb_create();
 	v->use_gpu = 1;
@@ -125,6 +126,22 @@ TEST_F(SQLTest, ExecuteGPU) {
 	
 	simpledb_clear(v);
 }
+#else
+TEST_F(SQLTest, ExecuteGPU) {
+	virginian *v = simpledb_create();
+	v->use_gpu = 1;
+	simpledb_addrows(v, 1);
+
+	// without cuda, queries on the gpu fail without touching the database
+	unsigned taken = v->tablet_slots_taken;
+	virg_reader *r;
+	EXPECT_EQ(virg_query(v, &r, query_sql), VIRG_FAIL);
+	EXPECT_TRUE(r == NULL);
+	EXPECT_EQ(v->tablet_slots_taken, taken);
+
+	simpledb_clear(v);
+}
+#endif
 
 TEST_F(SQLTest, ExprOps) {
 	virginian *v = simpledb_create();
@@ -199,6 +216,7 @@ TEST_F(SQLTest, ExprOpsMulti) {
 	simpledb_clear(v);
 }
 
+#ifndef VIRG_NOCUDA
 TEST_F(SQLTest, ExprOpsGPU) {
 	virginian *v = simpledb_create();
 	v->use_gpu = 1;
@@ -221,6 +239,7 @@ TEST_F(SQLTest, ExprOpsGPU) {
 	
 	simpledb_clear(v);
 }
+#endif
 
 
 TEST_F(SQLTest, Conditions) {
@@ -273,6 +292,7 @@ TEST_F(SQLTest, ConditionsSingle) {
 	simpledb_clear(v);
 }
 
+#ifndef VIRG_NOCUDA
 TEST_F(SQLTest, ConditionsGPU) {
 	virginian *v = simpledb_create();
 	v->use_gpu = 1;
@@ -312,7 +332,9 @@ TEST_F(SQLTest, ConditionsGPU) {
 	
 	simpledb_clear(v);
 }
+#endif
 
+#ifndef VIRG_NOCUDA
 TEST_F(SQLTest, ConditionsGPUMapped) {
 	virginian *v = simpledb_create();
 	v->use_gpu = 1;
@@ -351,6 +373,7 @@ TEST_F(SQLTest, ConditionsGPUMapped) {
 	
 	simpledb_clear(v);
 }
+#endif
 
 TEST_F(SQLTest, Columns) {
 	virginian *v = simpledb_create();
@@ -411,5 +434,185 @@ TEST_F(SQLTest, Columns) {
 	simpledb_clear(v);
 }
 
+TEST_F(SQLTest, ZoneMaps) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000000);
+	ASSERT_NE(v->db.first_tablet[0], v->db.last_tablet[0]);
+
+	static const char *query[2] = {
+		"select col0 from test where col0 >= 500000 and col0 < 500010",
+		"select col0 from test where col0 < 10 or col2 > 1000000"
+	};
+	static const unsigned query_rows[2] = { 10, 11 };
+
+	for(int multi = 0; multi < 2; multi++) {
+		v->use_multi = multi;
+
+		for(int i = 0; i < 2; i++) {
+			virg_reader *r;
+			virg_query(v, &r, query[i]);
+
+			// the tablets in between have no rows in range and aren't scanned
+			unsigned rows;
+			virg_reader_getrows(v, r, &rows);
+			EXPECT_EQ(rows, query_rows[i]);
+			EXPECT_GT(r->vm->tablets_skipped, 0u);
+
+			virg_reader_free(v, r);
+			virg_vm_cleanup(v, r->vm);
+			free(r);
+		}
+	}
+
+	simpledb_clear(v);
+}
+
+TEST_F(SQLTest, LoadFailure) {
+	virginian *v = simpledb_create();
+	simpledb_addrows(v, 1000000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	v->readahead = 0;
+
+	// lose the second tablet of the table on disk
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	unsigned id = tab->next, slot;
+	virg_tablet_unlock(v, tab->id);
+	ASSERT_EQ(virg_index_find(&v->disk_index, id, &slot), VIRG_SUCCESS);
+	virg_index_remove(&v->disk_index, id);
+
+	// the scan fails rather than returning the rows of the first tablet
+	for(int multi = 0; multi < 2; multi++) {
+		v->use_multi = multi;
+		virg_reader *r;
+		EXPECT_EQ(virg_query(v, &r, "select id from test"), VIRG_FAIL);
+		EXPECT_TRUE(r == NULL);
+		EXPECT_EQ(virg_lock_sum(v), 0);
+	}
+
+	// and works again once the tablet is back
+	virg_index_insert(&v->disk_index, id, slot);
+	virg_reader *r;
+	ASSERT_EQ(virg_query(v, &r, "select id from test"), VIRG_SUCCESS);
+	unsigned rows;
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 1000000u);
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+
+	simpledb_clear(v);
 }
 
+TEST_F(SQLTest, BloomFilters) {
+	virginian *v = simpledb_create();
+	ASSERT_EQ(virg_table_bloom(v, 0, 1), VIRG_SUCCESS);
+
+	// col1 only holds even numbers, so odd ones are inside the zone map of a
+	// tablet without being in it
+	for(int i = 0; i < 1000000; i++) {
+		int y[3] = { i, i * 2, i };
+		virg_table_insert(v, 0, (char*)&i, (char*)&y, NULL);
+	}
+	ASSERT_NE(v->db.first_tablet[0], v->db.last_tablet[0]);
+
+	// write the tablets and their filters, and start with none in memory
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+
+	static const char *query[3] = {
+		"select col0 from test where col1 = 1000001",
+		"select col0 from test where col1 = 1000002",
+		"select col0 from test where col0 < 0"
+	};
+	static const unsigned query_rows[3] = { 0, 1, 0 };
+	unsigned skipped[3];
+
+	for(int i = 0; i < 3; i++) {
+		virg_reader *r;
+		virg_query(v, &r, query[i]);
+
+		unsigned rows;
+		virg_reader_getrows(v, r, &rows);
+		EXPECT_EQ(rows, query_rows[i]);
+		skipped[i] = r->vm->tablets_skipped;
+
+		virg_reader_free(v, r);
+		virg_vm_cleanup(v, r->vm);
+		free(r);
+	}
+
+	// the tablet whose zone map covers the missing value is skipped too
+	EXPECT_EQ(skipped[0], skipped[2]);
+	EXPECT_EQ(skipped[1], skipped[2] - 1);
+
+	simpledb_clear(v);
+}
+
+TEST_F(SQLTest, ResultArena) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 200000);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+
+	unsigned num_tablets = v->db.num_tablets;
+	unsigned alloced = v->db.alloced_tablets;
+	struct stat st;
+	ASSERT_EQ(stat("testdb", &st), 0);
+	off_t size = st.st_size;
+
+	// the results take many more tablets than the arena holds
+	v->result_slots = 2;
+	virg_reader *r;
+	ASSERT_EQ(virg_query(v, &r, query_sql), VIRG_SUCCESS);
+	EXPECT_GT(v->spill_slots, 0u);
+
+	unsigned rows;
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 200000u);
+
+	// spilled result tablets are read back with their rows in order, the last
+	// row being returned along with the end of the results
+	int i = 0;
+	while(virg_reader_row(v, r) != VIRG_FAIL) {
+		ASSERT_EQ(((int*)r->buffer)[0], i);
+		i++;
+	}
+	EXPECT_EQ(((int*)r->buffer)[0], i);
+	EXPECT_EQ(i, 199999);
+
+	// none of them took disk slots in the database file
+	EXPECT_EQ(v->db.num_tablets, num_tablets);
+	EXPECT_EQ(v->db.alloced_tablets, alloced);
+	for(unsigned j = 0; j < v->db.alloced_tablets; j++)
+		if(v->db.tablet_info[j].used) {
+			EXPECT_FALSE(VIRG_IS_RESULT(v->db.tablet_info[j].id));
+		}
+
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+
+	// the places in the spill file are given back with the results
+	EXPECT_EQ(v->spill_free_count, v->spill_slots);
+	EXPECT_EQ(v->spill_index.used, 0u);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	virg_db_close(v);
+	ASSERT_EQ(stat("testdb", &st), 0);
+	EXPECT_EQ(st.st_size, size);
+	EXPECT_NE(stat("testdb.spill", &st), 0);
+
+	simpledb_clear(v);
+}
+
+}
@@ -74,5 +74,497 @@ TEST_F(TableTest, TableManipulation) {
 	simpledb_clear(v);
 }
 
+TEST_F(TableTest, Presize) {
+	virginian *v = simpledb_create();
+	virg_tablet_meta *tab;
+
+	// the first tablet is laid out for all of its rows before any are added
+	virg_db_load(v, v->db.first_tablet[0], &tab);
+	unsigned possible = tab->possible_rows;
+	size_t fixed = tab->fixed_block;
+	EXPECT_EQ(tab->size, v->db.tablet_size);
+	EXPECT_GT(possible, (v->db.tablet_size - sizeof(virg_tablet_meta)) /
+		tab->row_stride - 16);
+	virg_tablet_unlock(v, tab->id);
+
+	// so inserting rows never moves the columns
+	simpledb_addrows(v, possible);
+	virg_db_load(v, v->db.first_tablet[0], &tab);
+	EXPECT_EQ(tab->rows, possible);
+	EXPECT_EQ(tab->possible_rows, possible);
+	EXPECT_EQ(tab->fixed_block, fixed);
+	virg_tablet_unlock(v, tab->id);
+	CheckTableIntegrity(v, 0);
+
+	// the next row goes into a tail laid out the same way
+	simpledb_addrows(v, 1);
+	virg_db_load(v, v->db.first_tablet[0], &tab);
+	EXPECT_FALSE(tab->last_tablet);
+	virg_db_loadnext(v, &tab);
+	EXPECT_EQ(tab->rows, 1u);
+	EXPECT_EQ(tab->possible_rows, possible);
+	virg_tablet_unlock(v, tab->id);
+
+	// a column added to a tablet with rows lays it out again, keeping them
+	virg_db_load(v, v->db.first_tablet[0], &tab);
+	ASSERT_EQ(virg_tablet_addcolumn(v, tab, "col3", VIRG_INT), VIRG_FAIL);
+	tab->rows = 1000;
+	ASSERT_EQ(virg_tablet_addcolumn(v, tab, "col3", VIRG_INT), VIRG_SUCCESS);
+	EXPECT_LT(tab->possible_rows, possible);
+	CheckTabletIntegrity(tab);
+	for(unsigned i = 0; i < 1000; i++) {
+		EXPECT_EQ(((int*)((char*)tab + tab->key_block))[i], (int)i);
+		EXPECT_EQ(((int*)((char*)tab + tab->fixed_block +
+			tab->fixed_offset[2]))[i], (int)i + 2);
+	}
+	virg_tablet_unlock(v, tab->id);
+
+	simpledb_clear(v);
+}
+
+TEST_F(TableTest, Warm) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 300000);
+
+	// count the tablets of the table, then start with none in memory again
+	virg_tablet_meta *tab;
+	unsigned tablets = 1;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(!tab->last_tablet) {
+		virg_db_loadnext(v, &tab);
+		tablets++;
+	}
+	virg_tablet_unlock(v, tab->id);
+	ASSERT_GT(tablets, 4u);
+	virg_db_close(v);
+	ASSERT_EQ(virg_db_open(v, "testdb"), VIRG_SUCCESS);
+	ASSERT_EQ(v->tablet_slots_taken, 0u);
+
+	unsigned table_id = 0;
+	virg_warm_stats stats;
+
+	// a budget of a few tablets loads the head of the table
+	ASSERT_EQ(virg_table_warm(v, &table_id, 1, 4 * v->db.tablet_size, &stats),
+		VIRG_SUCCESS);
+	EXPECT_EQ(stats.tablets, 4u);
+	EXPECT_EQ(v->tablet_slots_taken, 4u);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+	unsigned slot;
+	ASSERT_EQ(virg_tablet_pin(v, v->db.first_tablet[0], &slot), VIRG_SUCCESS);
+	virg_tablet_unlock(v, v->db.first_tablet[0]);
+
+	// without a budget the whole table is loaded, and scanning it then reads
+	// nothing from disk
+	ASSERT_EQ(virg_table_warm(v, &table_id, 1, 0, &stats), VIRG_SUCCESS);
+	EXPECT_EQ(stats.tablets, tablets);
+	EXPECT_GT(stats.bytes, (size_t)stats.tablets * sizeof(virg_tablet_meta));
+	EXPECT_GE(stats.seconds, 0.0);
+	EXPECT_EQ(v->tablet_slots_taken, tablets);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	unsigned long long misses = v->tablet_misses;
+	unsigned rows;
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, 300000u);
+	EXPECT_EQ(v->tablet_misses, misses);
+
+	table_id = 1;
+	EXPECT_EQ(virg_table_warm(v, &table_id, 1, 0, NULL), VIRG_FAIL);
+
+	simpledb_clear(v);
+}
+
+TEST_F(TableTest, AppendBatch) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+
+	// start in the middle of a tablet, then append batches of different sizes
+	simpledb_addrows(v, 10);
+
+	const unsigned total = 300000;
+	int *keys = (int*)malloc(total * sizeof(int));
+	int *cols[3];
+	for(int j = 0; j < 3; j++)
+		cols[j] = (int*)malloc(total * sizeof(int));
+	for(unsigned i = 0; i < total; i++) {
+		keys[i] = i;
+		for(int j = 0; j < 3; j++)
+			cols[j][i] = i + j;
+	}
+
+	static const unsigned batch[4] = { 1, 1000, 100000, 0 };
+	unsigned done = 10;
+	for(int b = 0; b < 4; b++) {
+		unsigned n = batch[b] == 0 ? total - done : batch[b];
+		const char *columns[3];
+		for(int j = 0; j < 3; j++)
+			columns[j] = (char*)&cols[j][done];
+		ASSERT_EQ(virg_table_append_batch(v, 0, (char*)&keys[done], columns,
+			n), VIRG_SUCCESS);
+		done += n;
+	}
+	CheckTableIntegrity(v, 0);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	// every row is where virg_table_insert() would have put it
+	virg_tablet_meta *tab;
+	unsigned i = 0;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		int *k = (int*)((char*)tab + tab->key_block);
+		for(unsigned r = 0; r < tab->rows; r++, i++) {
+			ASSERT_EQ(k[r], (int)i);
+			for(unsigned j = 0; j < 3; j++)
+				ASSERT_EQ(((int*)((char*)tab + tab->fixed_block +
+					tab->fixed_offset[j]))[r], (int)(i + j));
+		}
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_EQ(i, total);
+
+	// the zone maps cover the appended rows
+	virg_reader *r;
+	virg_query(v, &r, "select col0 from test where col0 >= 150000 and "
+		"col0 < 150010");
+	unsigned rows;
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 10u);
+	EXPECT_GT(r->vm->tablets_skipped, 0u);
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+
+	EXPECT_EQ(virg_table_append_batch(v, 1, (char*)keys, NULL, 1), VIRG_FAIL);
+
+	free(keys);
+	for(int j = 0; j < 3; j++)
+		free(cols[j]);
+	simpledb_clear(v);
+}
+
+struct InsertThread {
+	virginian *v;
+	int first;
+	int rows;
+};
+
+static void *insert_thread(void *arg)
+{
+	InsertThread *t = (InsertThread*)arg;
+	int y[3];
+
+	for(int i = t->first; i < t->first + t->rows; i++) {
+		y[0] = i;
+		y[1] = i + 1;
+		y[2] = i + 2;
+		virg_table_insert(t->v, 0, (char*)&i, (char*)y, NULL);
+	}
+
+	return NULL;
+}
+
+TEST_F(TableTest, ConcurrentInsert) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 10);
+
+	// each thread inserts its own range of keys
+	const int threads = 6;
+	const int rows = 50000;
+	pthread_t thread[threads];
+	InsertThread args[threads];
+	for(int i = 0; i < threads; i++) {
+		args[i].v = v;
+		args[i].first = (i + 1) * 1000000;
+		args[i].rows = rows;
+		pthread_create(&thread[i], NULL, insert_thread, &args[i]);
+	}
+	for(int i = 0; i < threads; i++)
+		pthread_join(thread[i], NULL);
+
+	unsigned n;
+	virg_table_numrows(v, 0, &n);
+	EXPECT_EQ(n, (unsigned)(threads * rows + 10));
+	CheckTableIntegrity(v, 0);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	// every row is there once, in the order its thread inserted it
+	int next[threads + 1] = { 0 };
+	virg_tablet_meta *tab;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		int *k = (int*)((char*)tab + tab->key_block);
+		int *c = (int*)((char*)tab + tab->fixed_block + tab->fixed_offset[2]);
+		for(unsigned r = 0; r < tab->rows; r++) {
+			int t = k[r] / 1000000;
+			ASSERT_LE(t, threads);
+			ASSERT_EQ(k[r], t * 1000000 + next[t]);
+			ASSERT_EQ(c[r], k[r] + 2);
+			next[t]++;
+		}
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_EQ(next[0], 10);
+	for(int i = 1; i <= threads; i++)
+		EXPECT_EQ(next[i], rows);
+
+	// and rows can still be inserted afterwards
+	simpledb_addrows(v, 10);
+	virg_table_numrows(v, 0, &n);
+	EXPECT_EQ(n, (unsigned)(threads * rows + 20));
+
+	// compacting joins the tablets that the lanes were filling, so the lanes
+	// start again from the write cursor
+	ASSERT_EQ(virg_db_compact(v), VIRG_SUCCESS);
+	for(int i = 0; i < VIRG_APPEND_LANES; i++)
+		EXPECT_EQ(v->append_tablet[0][i], (unsigned)VIRG_INDEX_EMPTY);
+	simpledb_addrows(v, 10);
+	virg_table_numrows(v, 0, &n);
+	EXPECT_EQ(n, (unsigned)(threads * rows + 30));
+
+	// as does a lane whose tablet has gone from the table
+	v->append_tablet[0][virg_table_lane(v)] = v->db.tablet_id_counter + 100;
+	simpledb_addrows(v, 10);
+	virg_table_numrows(v, 0, &n);
+	EXPECT_EQ(n, (unsigned)(threads * rows + 40));
+	CheckTableIntegrity(v, 0);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	simpledb_clear(v);
+}
+
+TEST_F(TableTest, Appender) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_INT);
+	simpledb_addrows(v, 10);
+
+	// append rows over several tablets after the inserted ones
+	const int total = 100000;
+	virg_appender a;
+	ASSERT_EQ(virg_appender_init(v, &a, 0), VIRG_SUCCESS);
+	int y[3];
+	for(int i = 10; i < total; i++) {
+		y[0] = i;
+		y[1] = i + 1;
+		y[2] = i + 2;
+		ASSERT_EQ(virg_appender_row(v, &a, (char*)&i, (char*)y),
+			VIRG_SUCCESS);
+
+		// the rows of the tablet being filled are published when asked
+		if(i == 50) {
+			unsigned rows;
+			virg_table_numrows(v, 0, &rows);
+			EXPECT_EQ(rows, 10u);
+			ASSERT_EQ(virg_appender_flush(v, &a), VIRG_SUCCESS);
+			virg_table_numrows(v, 0, &rows);
+			EXPECT_EQ(rows, 51u);
+		}
+	}
+
+	// the database isn't closed while the appender holds a tablet, since it
+	// couldn't be written
+	EXPECT_EQ(virg_db_close(v), VIRG_FAIL);
+	EXPECT_NE(v->dbfd, -1);
+
+	ASSERT_EQ(virg_appender_free(v, &a), VIRG_SUCCESS);
+	CheckTableIntegrity(v, 0);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	// inserts carry on after the appended rows
+	simpledb_addrows(v, 10);
+
+	virg_tablet_meta *tab;
+	int i = 0;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		int *k = (int*)((char*)tab + tab->key_block);
+		for(unsigned r = 0; r < tab->rows; r++, i++) {
+			ASSERT_EQ(k[r], i);
+			for(unsigned j = 0; j < 3; j++)
+				ASSERT_EQ(((int*)((char*)tab + tab->fixed_block +
+					tab->fixed_offset[j]))[r], (int)(i + j));
+		}
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_EQ(i, total + 10);
+
+	// the zone maps cover the appended rows
+	virg_reader *r;
+	virg_query(v, &r, "select col0 from test where col0 >= 50000 and "
+		"col0 < 50010");
+	unsigned rows;
+	virg_reader_getrows(v, r, &rows);
+	EXPECT_EQ(rows, 10u);
+	EXPECT_GT(r->vm->tablets_skipped, 0u);
+	virg_reader_free(v, r);
+	virg_vm_cleanup(v, r->vm);
+	free(r);
+
+	EXPECT_EQ(virg_appender_init(v, &a, 1), VIRG_FAIL);
+
+	// a thread can have appenders open on two tables and insert into others,
+	// but not insert into a table its appender holds
+	virg_table_create(v, "test2", VIRG_INT);
+	virg_table_addcolumn(v, 1, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 1, "col1", VIRG_INT);
+	virg_table_addcolumn(v, 1, "col2", VIRG_INT);
+	virg_table_create(v, "test3", VIRG_INT);
+	virg_appender b;
+	ASSERT_EQ(virg_appender_init(v, &a, 0), VIRG_SUCCESS);
+	ASSERT_EQ(virg_appender_init(v, &b, 1), VIRG_SUCCESS);
+	i = total + 10;
+	ASSERT_EQ(virg_appender_row(v, &a, (char*)&i, (char*)y), VIRG_SUCCESS);
+	ASSERT_EQ(virg_appender_row(v, &b, (char*)&i, (char*)y), VIRG_SUCCESS);
+	EXPECT_EQ(virg_table_insert(v, 2, (char*)&i, NULL, NULL), VIRG_SUCCESS);
+	EXPECT_EQ(virg_table_insert(v, 0, (char*)&i, (char*)y, NULL), VIRG_FAIL);
+	virg_appender c;
+	EXPECT_EQ(virg_appender_init(v, &c, 1), VIRG_FAIL);
+	ASSERT_EQ(virg_appender_free(v, &b), VIRG_SUCCESS);
+	ASSERT_EQ(virg_appender_free(v, &a), VIRG_SUCCESS);
+	EXPECT_EQ(virg_table_insert(v, 0, (char*)&i, (char*)y, NULL), VIRG_SUCCESS);
+	virg_table_numrows(v, 0, &rows);
+	EXPECT_EQ(rows, (unsigned)total + 12);
+	virg_table_numrows(v, 1, &rows);
+	EXPECT_EQ(rows, 1u);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	simpledb_clear(v);
 }
 
+TEST_F(TableTest, Load) {
+	virginian *v = (virginian*)malloc(sizeof(virginian));
+	unlink("testdb");
+	virg_init(v);
+	v->tablet_size = VIRG_TABLET_MIN_SIZE;
+	ASSERT_EQ(virg_db_create(v, "testdb"), VIRG_SUCCESS);
+	virg_table_create(v, "test", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col0", VIRG_INT);
+	virg_table_addcolumn(v, 0, "col1", VIRG_FLOAT);
+	virg_table_addcolumn(v, 0, "col2", VIRG_DOUBLE);
+
+	// big enough to be split between several threads
+	const unsigned total = 1000000;
+	FILE *f = fopen("testload.csv", "w");
+	ASSERT_TRUE(f != NULL);
+	fprintf(f, "id,col0,col1,col2\n");
+	for(unsigned i = 0; i < total; i++)
+		fprintf(f, "%u,%u,%u.5,%u.25\n", i, i + 1, i % 1000, i % 1000);
+	fclose(f);
+
+	f = fopen("testload.bin", "wb");
+	ASSERT_TRUE(f != NULL);
+	for(unsigned i = total; i < total * 2; i++) {
+		int k = i, c0 = i + 1;
+		float c1 = i % 1000 + 0.5f;
+		double c2 = i % 1000 + 0.25;
+		fwrite(&k, sizeof(int), 1, f);
+		fwrite(&c0, sizeof(int), 1, f);
+		fwrite(&c1, sizeof(float), 1, f);
+		fwrite(&c2, sizeof(double), 1, f);
+	}
+	fclose(f);
+
+	// load after a few inserted rows, then load each file
+	char row[16];
+	memset(row, 0, sizeof(row));
+	for(int i = 0; i < 10; i++)
+		virg_table_insert(v, 0, (char*)&i, row, NULL);
+	unsigned rows;
+	ASSERT_EQ(virg_table_load(v, 0, "testload.csv", VIRG_CSV, 4, &rows),
+		VIRG_SUCCESS);
+	EXPECT_EQ(rows, total);
+	ASSERT_EQ(virg_table_load(v, 0, "testload.bin", VIRG_BINARY, 3, &rows),
+		VIRG_SUCCESS);
+	EXPECT_EQ(rows, total);
+	CheckTableIntegrity(v, 0);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	// rows can be inserted after the loaded ones
+	for(int i = 0; i < 10; i++)
+		virg_table_insert(v, 0, (char*)&i, row, NULL);
+	CheckTableIntegrity(v, 0);
+
+	// the rows are in the order of the files
+	virg_tablet_meta *tab;
+	unsigned i = 0;
+	ASSERT_EQ(virg_db_load(v, v->db.first_tablet[0], &tab), VIRG_SUCCESS);
+	while(1) {
+		int *k = (int*)((char*)tab + tab->key_block);
+		for(unsigned r = 0; r < tab->rows; r++, i++) {
+			if(i < 10 || i >= total * 2 + 10)
+				continue;
+			unsigned n = i - 10;
+			ASSERT_EQ(k[r], (int)n);
+			char *fixed = (char*)tab + tab->fixed_block;
+			ASSERT_EQ(((int*)(fixed + tab->fixed_offset[0]))[r], (int)n + 1);
+			ASSERT_EQ(((float*)(fixed + tab->fixed_offset[1]))[r],
+				n % 1000 + 0.5f);
+			ASSERT_EQ(((double*)(fixed + tab->fixed_offset[2]))[r],
+				n % 1000 + 0.25);
+		}
+		if(tab->last_tablet)
+			break;
+		virg_db_loadnext(v, &tab);
+	}
+	virg_tablet_unlock(v, tab->id);
+	EXPECT_EQ(i, total * 2 + 20);
+
+	// a bad line leaves the table as it was
+	f = fopen("testload.csv", "w");
+	fprintf(f, "1,2,3.0,4.0\n2,x,3.0,4.0\n");
+	fclose(f);
+	unsigned tablets = v->db.table_tablets[0];
+	unsigned last = v->db.last_tablet[0];
+	EXPECT_EQ(virg_table_load(v, 0, "testload.csv", VIRG_CSV, 0, &rows),
+		VIRG_FAIL);
+	EXPECT_EQ(v->db.table_tablets[0], tablets);
+	EXPECT_EQ(v->db.last_tablet[0], last);
+	EXPECT_EQ(virg_lock_sum(v), 0);
+
+	EXPECT_EQ(virg_table_load(v, 1, "testload.csv", VIRG_CSV, 0, NULL),
+		VIRG_FAIL);
+
+	unlink("testload.csv");
+	unlink("testload.bin");
+	simpledb_clear(v);
+}
+
+}
@@ -43,7 +43,10 @@ void VirginianTest::simpledb_clear(virginian *v)
 {
 	virg_close(v);
 	free(v);
+#ifndef VIRG_NOCUDA
 	cudaThreadExit();
+#endif
 	unlink("testdb");
+	unlink("testdb.bloom");
 }
 
@@ -19,8 +19,10 @@ TEST_F(BasicStateTest, BasicAssertions) {
 	ASSERT_EQ(VIRG_GB, 1073741824);
 	ASSERT_GT(VIRG_TABLET_SIZE, 0);
 	ASSERT_GT(VIRG_TABLET_KEY_INCREMENT, 0);
-	ASSERT_GT(VIRG_TABLET_INFO_SIZE, 0);
-	ASSERT_GT(VIRG_TABLET_INFO_INCREMENT, 0);
+	ASSERT_GT(VIRG_EXTENT_TABLETS, 0);
+	ASSERT_LE(VIRG_EXTENT_TABLETS * sizeof(virg_tablet_info),
+		(size_t)VIRG_EXTENT_INFO);
+	ASSERT_LE(sizeof(virg_db), VIRG_DB_HEADER);
 
 	ASSERT_GT(VIRG_MEM_TABLETS, 0);
 	ASSERT_GT(VIRG_GPU_TABLETS, 0);
@@ -53,12 +55,30 @@ TEST_F(BasicStateTest, VirginianCreation) {
 
 	virg_init(&v);
 
+	// slots are only given memory when they are first used
+	ASSERT_EQ(v.slot_count, VIRG_MEM_BUDGET / VIRG_TABLET_SIZE);
 	for(int i = 0; i < VIRG_MEM_TABLETS; i++)
-		ASSERT_TRUE(v.tablet_slots[i] != NULL);
+		ASSERT_TRUE(v.tablet_slots[i] == NULL);
 
+	// the gpu isn't touched until it is used
+	ASSERT_TRUE(v.gpu_slots == NULL);
+	ASSERT_EQ(v.gpu_ready, 0);
+
+	// the state struct is small enough for the stack of any thread, with the
+	// transfer state of the slots given to them as they are used
+	EXPECT_LT(sizeof(virginian), (size_t)256 * VIRG_KB);
+	for(int i = 0; i < VIRG_TABLET_SLOTS; i++)
+		ASSERT_TRUE(v.tablet_slot_io[i] == NULL);
+
+#ifndef VIRG_NOCUDA
+	ASSERT_EQ(virg_vm_gpuinit(&v), VIRG_SUCCESS);
 	ASSERT_TRUE(v.gpu_slots != NULL);
+	ASSERT_EQ(v.gpu_ready, 1);
 
 	cudaThreadExit();
+#else
+	ASSERT_EQ(virg_vm_gpuinit(&v), VIRG_FAIL);
+#endif
 }
 
 TEST_F(BasicStateTest, DataSizes) {
@@ -69,14 +89,17 @@ TEST_F(BasicStateTest, DataSizes) {
 	EXPECT_TRUE(sizeof(long long int) == 8);
 
 	const size_t *local = &virg_testsizes[0];
-	const size_t *gpu = virg_gpu_getsizes();
 	const size_t *cpu = virg_cpu_getsizes();
 	int n = sizeof(virg_testsizes) / sizeof(size_t);
 
-	for(int i = 0; i < n; i++) {
+	for(int i = 0; i < n; i++)
 		ASSERT_EQ(local[i], cpu[i]);
+
+#ifndef VIRG_NOCUDA
+	const size_t *gpu = virg_gpu_getsizes();
+	for(int i = 0; i < n; i++)
 		ASSERT_EQ(local[i], gpu[i]);
-	}
+#endif
 }
 
 
@@ -40,6 +40,59 @@ size_t virg_sizeof(virg_t type)
 	return virg_sizes[type];
 }
 
+/**
+ * @brief Hash a value for the Bloom filters of tablets
+ *
+ * Used by virg_db_bloom() and virg_db_bloomtest() to choose the bits standing
+ * for a value. Values that compare equal hash equally, so negative and positive
+ * floating point zeroes are treated as the same value.
+ *
+ * @param type Type of the value
+ * @param val Pointer to the value
+ * @return 64-bit hash of the value
+ */
+unsigned long long virg_bloom_hash(virg_t type, void *val)
+{
+	unsigned long long x = 0;
+	float f;
+	double d;
+
+	switch(type) {
+		case VIRG_INT:
+			x = (unsigned)((int*)val)[0];
+			break;
+		case VIRG_INT64:
+			x = ((unsigned long long*)val)[0];
+			break;
+		case VIRG_FLOAT:
+			f = ((float*)val)[0];
+			if(f == 0)
+				f = 0;
+			memcpy(&x, &f, sizeof(float));
+			break;
+		case VIRG_DOUBLE:
+			d = ((double*)val)[0];
+			if(d == 0)
+				d = 0;
+			memcpy(&x, &d, sizeof(double));
+			break;
+		case VIRG_CHAR:
+			x = ((unsigned char*)val)[0];
+			break;
+		default:
+			break;
+	}
+
+	// splitmix64 finalizer
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+
+	return x;
+}
+
 struct timeval virg_starttime;
 struct timeval virg_endtime;
 
@@ -169,9 +222,7 @@ void virg_print_tablet(virginian *v, virg_tablet_meta *m, const char *filename)
 			fprintf(f, "\n");
 		}
 
-		if(!m->last_tablet)
-			virg_db_loadnext(v, &m);
-		else
+		if(m->last_tablet || virg_db_loadnext(v, &m) == VIRG_FAIL)
 			break;
 	}
 
@@ -316,16 +367,18 @@ void virg_print_slots(virginian *v)
         fprintf(stderr, "== slots ======================================\n");
         fprintf(stderr, " used   ");
         unsigned i;
-        for(i = 0; i < VIRG_MEM_TABLETS; i++)
+        for(i = 0; i < VIRG_TABLET_SLOTS; i++)
                 fprintf(stderr, "%i,", v->tablet_slot_status[i]);
         fprintf(stderr, "\n");
         fprintf(stderr, " id     ");
-        for(i = 0; i < VIRG_MEM_TABLETS; i++)
+        for(i = 0; i < VIRG_TABLET_SLOTS; i++)
 		if(v->tablet_slot_status[i] == 0)
 			fprintf(stderr, ",");
 		else
 			fprintf(stderr, "%u,", v->tablet_slot_ids[i]);
         fprintf(stderr, "\n");
+        fprintf(stderr, " hits %llu misses %llu\n", v->tablet_hits,
+		v->tablet_misses);
         fprintf(stderr, "-----------------------------------------------\n");
 }
 
@@ -367,7 +420,7 @@ int virg_lock_sum(virginian *v)
 {
 	int x = 0, i;
 
-	for(i = 0; i < VIRG_MEM_TABLETS; i++)
+	for(i = 0; i < VIRG_TABLET_SLOTS; i++)
 		if(v->tablet_slot_status[i] > 1)
 			x += v->tablet_slot_status[i] - 1;
 
@@ -20,6 +20,9 @@
  * @defgroup tablet Tablet Functions
  * @defgroup vm Virtual Machine Functions
  * @defgroup reader Tablet Reader Functions
+ * @defgroup appender Table Appender Functions
+ * @defgroup index Tablet Index Functions
+ * @defgroup io Asynchronous I/O Functions
  */
 
 #ifdef _XOPEN_SOURCE
@@ -39,10 +42,23 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
+/**
+ * Compiling with VIRG_NOCUDA leaves out the GPU virtual machine and every call
+ * to CUDA, so that the CPU engine can be built and run on machines without it.
+ * Tablet slots can't be pinned without CUDA, so this implies VIRG_NOPINNED.
+ */
+#ifdef VIRG_NOCUDA
+#ifndef VIRG_NOPINNED
+#define VIRG_NOPINNED
+#endif
+#else
 #include <cuda.h>
 #include <cuda_runtime_api.h>
 #include <driver_types.h>
+#endif
 
 /// shortcut for 2^10
 #define VIRG_KB			1024
@@ -54,10 +70,12 @@
 /// acceptable error in floating point comparisons
 #define VIRG_FLOAT_ERROR		0.0001
 
-/// size of tablets, must be equal for the db file and the database
+/// default size of tablets, the size is chosen when a database is created
 #define VIRG_TABLET_SIZE		(8 * VIRG_MB)
-/// rows to allocate when a tablet is created
-#define VIRG_TABLET_INITIAL_KEYS	256
+/// smallest tablet size, tablet sizes must be powers of two
+#define VIRG_TABLET_MIN_SIZE	(256 * VIRG_KB)
+/// largest tablet size
+#define VIRG_TABLET_MAX_SIZE	(256 * VIRG_MB)
 /// rows to add when a tablet is full and rows still need to be added 
 #define VIRG_TABLET_KEY_INCREMENT	(2048 * 128)
 /// initial size of the fixed block
@@ -65,16 +83,43 @@
 /// initial size of the variable block
 #define VIRG_TABLET_INITIAL_VARIABLE	0
 /// size reserved for the variable block when the fixed is maxed out
-#define VIRG_TABLET_MAXED_VARIABLE	(VIRG_TABLET_SIZE / 16)
+#define VIRG_TABLET_MAXED_VARIABLE(size)	((size) / 16)
+/// size of the buffer each virg_table_load() thread reads its part of the
+/// file through, which no line of a CSV file may be longer than
+#define VIRG_LOAD_BUFFER		(4 * VIRG_MB)
+/// smallest part of a file given to each virg_table_load() thread
+#define VIRG_LOAD_CHUNK			(4 * VIRG_MB)
 /// initial area reserved for the variable size block of result tablets
 #define VIRG_RESULT_INITIAL_VARIABLE	(512 * VIRG_KB)
-/// initial disk slot meta informations to allocate for tablets
-#define VIRG_TABLET_INFO_SIZE		16
-/// meta information structs to add when all are used up and we need another
-#define VIRG_TABLET_INFO_INCREMENT	32
+/// bytes at the start of the database file holding the virg_db struct
+#define VIRG_DB_HEADER				(4 * VIRG_KB)
+/// disk slots in each extent of the database file, see virg_db
+#define VIRG_EXTENT_TABLETS			32
+/// bytes at the start of each extent holding its virg_tablet_info structs,
+/// keeping the tablets after them page aligned
+#define VIRG_EXTENT_INFO			(4 * VIRG_KB)
+/// offset in the database file of the extent holding a disk slot
+#define VIRG_EXTENT_OFFSET(db, disk_slot)									   \
+	(VIRG_DB_HEADER + (off_t)((disk_slot) / VIRG_EXTENT_TABLETS) *			   \
+	(VIRG_EXTENT_INFO + VIRG_EXTENT_TABLETS * (off_t)(db)->tablet_size))
+/// offset in the database file of the tablet in a disk slot
+#define VIRG_DISK_OFFSET(db, disk_slot)										   \
+	(VIRG_EXTENT_OFFSET(db, disk_slot) + VIRG_EXTENT_INFO +					   \
+	(off_t)((disk_slot) % VIRG_EXTENT_TABLETS) * (off_t)(db)->tablet_size)
+/// initial number of buckets in the tablet id to disk slot index
+#define VIRG_INDEX_INITIAL_SIZE		256
+/// key used to mark an empty bucket in a tablet index
+#define VIRG_INDEX_EMPTY		0xFFFFFFFF
 
 /// maximum table columns supported
 #define VIRG_MAX_COLUMNS 		16
+/// maximum number of ranges in a packed tablet, see virg_tablet_iov()
+#define VIRG_TABLET_IOV			(VIRG_MAX_COLUMNS + 4)
+/// bit of a column set standing for the key pointer and variable blocks, the
+/// other bits stand for the fixed-size columns, see virg_db_loadcols()
+#define VIRG_OTHER_BLOCKS		0x80000000
+/// column set containing every part of a tablet
+#define VIRG_ALL_COLUMNS		0xFFFFFFFF
 /// maximum tables supported
 #define VIRG_MAX_TABLES			16
 /// maximum column name length supported
@@ -82,8 +127,67 @@
 /// maximum table name length supported
 #define VIRG_MAX_TABLE_NAME		32
 
-/// tablet slots to allocate in memory
-#define VIRG_MEM_TABLETS		64
+/// largest number of tablet slots, those used depend on the memory budget
+#define VIRG_MEM_TABLETS		1024
+/// smallest number of tablet slots, whatever the memory budget
+#define VIRG_MEM_MIN_TABLETS	8
+/// default memory budget of the tablet slots, see virg_db_resize()
+#define VIRG_MEM_BUDGET			((size_t)512 * VIRG_MB)
+/// largest number of tablet slots in the result arena, which follow the
+/// VIRG_MEM_TABLETS slots of data tablets
+#define VIRG_RESULT_TABLETS		64
+/// default number of result arena slots filled before result tablets are
+/// spilled, see virg_db_resultslot()
+#define VIRG_RESULT_SLOTS		8
+/// number of tablet slots, data tablet slots followed by the result arena
+#define VIRG_TABLET_SLOTS		(VIRG_MEM_TABLETS + VIRG_RESULT_TABLETS)
+/// bit set in the ids of result tablets, which are numbered apart from the
+/// tablets of the database and never written to its file
+#define VIRG_RESULT_ID			0x80000000u
+/// whether a tablet id is the id of a result tablet
+#define VIRG_IS_RESULT(id)		(((id) & VIRG_RESULT_ID) != 0)
+/// largest number of NUMA nodes that tablet slots are spread across
+#define VIRG_NUMA_NODES			8
+/// largest number of CPUs whose NUMA node is known
+#define VIRG_NUMA_CPUS			1024
+/// NUMA node of CPUs that aren't online
+#define VIRG_NUMA_NONE			0xFF
+/// NUMA node whose memory backs a tablet slot, the slots being dealt out to the
+/// nodes in turn
+#define VIRG_SLOT_NODE(v, slot)	((slot) % (v)->numa_nodes)
+/// size of the huge pages that tablet slots can be backed by
+#define VIRG_HUGE_PAGE			(2 * VIRG_MB)
+/// virtual address space reserved for mapping the database file
+#define VIRG_FILEMAP_SIZE		((size_t)256 * VIRG_GB)
+/// status of a tablet slot that is being evicted or filled, which can't be locked
+#define VIRG_SLOT_CLAIMED		-1
+/// default replacement policy used to pick tablets to evict from tablet slots
+#define VIRG_SLOT_POLICY		VIRG_2Q
+/// slots the 2Q probationary queue may fill before it is evicted from first
+#define VIRG_2Q_PROBATION(slots)	((slots) / 4)
+/// ids of tablets evicted from the 2Q probationary queue that are remembered,
+/// half the number of slots in use, up to this many
+#define VIRG_2Q_GHOSTS			(VIRG_MEM_TABLETS / 2)
+/// default number of tablets read ahead of table scans, 0 disables read-ahead
+#define VIRG_READAHEAD			2
+/// read-ahead requests that can be waiting for the prefetch thread
+#define VIRG_PREFETCH_QUEUE		16
+/// threads performing tablet reads and writes when io_uring isn't used
+#define VIRG_IO_THREADS			4
+/// tablet reads and writes that can be in flight at once with io_uring
+#define VIRG_IO_DEPTH			64
+/// log2 of the number of bits in each Bloom filter of a tablet
+#define VIRG_BLOOM_BITS			21
+/// size in bytes of each Bloom filter of a tablet
+#define VIRG_BLOOM_SIZE			((1 << VIRG_BLOOM_BITS) / 8)
+/// bits set in a Bloom filter for each value
+#define VIRG_BLOOM_HASHES		3
+/// number of the Bloom filter of the key column, the fixed-size columns use
+/// their column numbers
+#define VIRG_BLOOM_KEY			VIRG_MAX_COLUMNS
+/// space in the Bloom filter file for the filters of each disk slot, after a
+/// header block holding the tablet id and the set of filters stored
+#define VIRG_BLOOM_REGION		((size_t)(VIRG_MAX_COLUMNS + 2) * VIRG_BLOOM_SIZE)
 /// tablet slots to allocate in gpu memory
 #define VIRG_GPU_TABLETS		2
 /// maximum number of tables to read from supported in vm
@@ -113,6 +217,9 @@
 #define VIRG_THREADSPERBLOCK_MASK	0xFFFFFF80
 /// number of threads to use for the multicore cpu virtual machine
 #define VIRG_MULTITHREADS		8
+/// threads that can insert rows into a table at once, each into its own
+/// tablet, see virg_table_tail()
+#define VIRG_APPEND_LANES		16
 
 /// used to return a function failure
 #define VIRG_FAIL		0
@@ -125,6 +232,12 @@
 #define VIRG_MAX(a, b)		(a < b ? b : a)
 /// convenience macro to verify a number is a power of 2
 #define VIRG_ISPWR2(x)		((x != 0) && ((x & (~x + 1)) == x))
+/// atomically add to an integer and return its new value
+#define VIRG_ATOMIC_ADD(x, n)		__sync_add_and_fetch(&(x), n)
+/// atomically replace an integer if it holds the old value, true on success
+#define VIRG_ATOMIC_CAS(x, old, new)	__sync_bool_compare_and_swap(&(x), old, new)
+/// multiplicative hash of a tablet id to its home bucket in a tablet index
+#define VIRG_INDEX_HASH(key, mask)	(((unsigned)(key) * 2654435761u) & (mask))
 
 /// print out an error with the file and line
 #define VIRG_ERROR(x)		fprintf(stderr, "::: Virginian error %s line %d:: " x "\n", __FILE__, __LINE__);
@@ -136,6 +249,7 @@
 		return VIRG_FAIL;													   \
 	}
 
+#ifndef VIRG_NOCUDA
 /// return failure and print it if there is an outstanding cuda error
 #define VIRG_CUDCHK(desc) VIRG_CUDCHKCALL(cudaGetLastError(), desc)
 
@@ -147,6 +261,7 @@
 			desc, cudaGetErrorString(r), __FILE__, __LINE__);				   \
 		return VIRG_FAIL;													   \
 	}}
+#endif
 
 
 /** VIRG_DEBUG_CHECK calls are like VIRG_CHECK calls but only get compiled in if
@@ -207,6 +322,40 @@ typedef enum {
 /// used when operating on two types to get the more general type
 virg_t virg_generalizetype(virg_t t1, virg_t t2);
 
+/// replacement policies used to choose which tablet slot to evict
+typedef enum {
+	/// evict unlocked tablets in round-robin order
+	VIRG_RR		= 0,
+	/// second-chance clock using a reference bit set when a tablet is reused
+	VIRG_CLOCK	= 1,
+	/// 2Q, tablets are only moved to the main clock-managed queue if they are
+	/// reused after having been evicted from a small probationary FIFO queue
+	VIRG_2Q		= 2
+} virg_policy;
+
+/// kinds of memory backing a tablet slot, see virg_db_slotalloc()
+typedef enum {
+	/// the slot hasn't been given memory yet
+	VIRG_PAGES_NONE		= 0,
+	/// normal pages
+	VIRG_PAGES_SMALL	= 1,
+	/// transparent huge pages, requested with madvise(MADV_HUGEPAGE) and used
+	/// by the kernel when it has huge pages free
+	VIRG_PAGES_THP		= 2,
+	/// huge pages reserved with MAP_HUGETLB
+	VIRG_PAGES_HUGETLB	= 3
+} virg_pages;
+
+/// formats of the files that virg_table_load() can load rows from
+typedef enum {
+	/// one row per line, the key then each of the fixed-size columns in order,
+	/// separated by commas
+	VIRG_CSV	= 0,
+	/// rows of raw little-endian values, the key then each of the fixed-size
+	/// columns in order, with no padding
+	VIRG_BINARY	= 1
+} virg_format;
+
 /// size in bytes of variables types, indexed by their enumeration values
 static const size_t virg_sizes[7] = {
 	sizeof(int),			// 0
@@ -236,6 +385,150 @@ typedef struct {
 } virg_tablet_info;
 
 
+/**
+ * @brief Hash index from tablet ids to slot numbers
+ *
+ * Open-addressing hash table with linear probing used to find the main-memory
+ * tablet slot or the on-disk slot of a tablet from its id without iterating
+ * over every slot. The number of buckets is always a power of 2 and is doubled
+ * whenever the table becomes half full. Empty buckets have a key of
+ * VIRG_INDEX_EMPTY. These indexes only exist in memory; the disk slot index is
+ * rebuilt from the virg_tablet_info structs when a database is opened.
+ */
+typedef struct {
+	/// tablet id stored in each bucket
+	unsigned	*keys;
+	/// slot number associated with the tablet id in each bucket
+	unsigned	*vals;
+	/// number of buckets, a power of 2
+	unsigned	size;
+	/// number of buckets in use
+	unsigned	used;
+} virg_index;
+
+/**
+ * @brief Asynchronous read or write of part of a file
+ *
+ * Describes a single transfer submitted with virg_io_submit(). Once every byte
+ * has been transferred, or the transfer has failed, the done callback is run on
+ * an I/O thread. The request must not be changed or reused until then.
+ */
+typedef struct virg_io_req {
+	/// file descriptor to read from or write to
+	int			fd;
+	/// 1 to write the buffer to the file, 0 to read the file into it
+	int			write;
+	/// memory ranges to read into or write from, which are advanced past the
+	/// bytes transferred as the transfer progresses
+	struct iovec	*iov;
+	/// number of memory ranges remaining
+	int			iovcnt;
+	/// total number of bytes to transfer
+	size_t		len;
+	/// position in the file of the transfer
+	off_t		offset;
+	/// bytes transferred so far, or -1 if the transfer failed
+	ssize_t		result;
+	/// called on an I/O thread when the transfer is complete, may be NULL
+	void		(*done)(struct virg_io_req *req);
+	/// passed through to the done callback
+	void		*arg;
+	/// next request waiting for an I/O thread
+	struct virg_io_req	*next;
+} virg_io_req;
+
+/**
+ * @brief State of the asynchronous I/O engine
+ *
+ * Transfers are performed with io_uring if Virginian is compiled with
+ * VIRG_IOURING and the kernel supports it, in which case a single thread reaps
+ * completions. Otherwise, a pool of VIRG_IO_THREADS threads takes requests from
+ * a queue and performs them with preadv() and pwritev().
+ */
+typedef struct {
+	/// io_uring file descriptor, or -1 if the thread pool is used
+	int			ring;
+	/// mapped io_uring submission ring
+	void		*sq_ring;
+	/// size of the mapped submission ring
+	size_t		sq_ring_size;
+	/// mapped io_uring completion ring, which may be the same as sq_ring
+	void		*cq_ring;
+	/// size of the mapped completion ring
+	size_t		cq_ring_size;
+	/// mapped io_uring submission queue entries
+	void		*sqes;
+	/// size of the mapped submission queue entries
+	size_t		sqes_size;
+	/// number of submission queue entries
+	unsigned	depth;
+	/// tail of the submission ring
+	volatile unsigned	*sq_tail;
+	/// mask applied to positions in the submission ring
+	volatile unsigned	*sq_mask;
+	/// entries referenced by each position in the submission ring
+	volatile unsigned	*sq_array;
+	/// head of the completion ring
+	volatile unsigned	*cq_head;
+	/// tail of the completion ring
+	volatile unsigned	*cq_tail;
+	/// mask applied to positions in the completion ring
+	volatile unsigned	*cq_mask;
+	/// entries of the completion ring
+	void		*cqes;
+	/// threads performing transfers or reaping io_uring completions
+	pthread_t	threads		[VIRG_IO_THREADS];
+	/// number of threads that were started
+	unsigned	num_threads;
+	/// protects the request queue, the submission ring and the counters
+	pthread_mutex_t		lock;
+	/// signalled when a request is queued or the threads must exit
+	pthread_cond_t		cond;
+	/// signalled when a request completes
+	pthread_cond_t		idle;
+	/// first request waiting for a thread in the pool
+	virg_io_req	*head;
+	/// last request waiting for a thread in the pool
+	virg_io_req	*tail;
+	/// requests submitted that haven't completed
+	unsigned	inflight;
+	/// tells the threads to exit
+	int			stop;
+} virg_io;
+
+/**
+ * @brief Transfer state of a tablet slot
+ *
+ * Holds the requests and memory ranges used to read and write the tablet in a
+ * tablet slot. Each slot is given one along with its memory by
+ * virg_db_slotalloc(), rather than the virginian struct holding them for every
+ * slot, which would make it too big to be declared on a thread's stack.
+ */
+typedef struct {
+	/// state struct of the database system, for the requests' callbacks
+	struct virginian_	*v;
+	/// tablet slot that the transfers are for
+	unsigned		slot;
+	/// requests used for the asynchronous read of the slot's tablet, one for
+	/// each contiguous part of the file that is read
+	virg_io_req		req		[VIRG_TABLET_IOV];
+	/// memory ranges of the packed form of the slot's tablet being transferred
+	struct iovec	iov		[VIRG_TABLET_IOV];
+} virg_slot_io;
+
+/**
+ * @brief Union used to store any of the possible types of virg_t in a single memory
+ * location, used for the 4th argument for opcodes
+ */
+typedef union {
+	int 			i;
+	float			f;
+	long long int	li;
+	double			d;
+	char			c;
+	char			*s;
+}__attribute__((aligned(8))) virg_var;
+
 /**
  * @brief Tablet meta information
  *
@@ -269,6 +562,9 @@ typedef struct {
 	int			in_table;
 	/// id of the table that this tablet is a part of, if applicable
 	unsigned	table_id;
+	/// boolean indicating whether the tablet was written to disk with only its
+	/// used rows, see virg_tablet_iov()
+	int			packed;
 
 	/// relative ptr to the beginning of the key column
 	size_t		key_block;
@@ -297,23 +593,22 @@ typedef struct {
 	/// relative pointer from fixed_block indicating the beginning of the column
 	size_t		fixed_offset	[VIRG_MAX_COLUMNS];
 
+	/// boolean indicating whether the zone map of key_min, key_max, fixed_min
+	/// and fixed_max holds the range of each column, see virg_tablet_zones()
+	int			zones;
+	/// smallest key in the tablet
+	virg_var	key_min;
+	/// largest key in the tablet
+	virg_var	key_max;
+	/// smallest value of each of the fixed-size columns
+	virg_var	fixed_min	[VIRG_MAX_COLUMNS];
+	/// largest value of each of the fixed-size columns
+	virg_var	fixed_max	[VIRG_MAX_COLUMNS];
+
 	/// pointer to the disk info struct associated with this tablet
 	virg_tablet_info	*info;
 }__attribute__((aligned(64))) virg_tablet_meta;
 
-/**
- * @brief Union used to store any of the possible types of virg_t in a single memory
- * location, used for the 4th argument for opcodes
- */
-typedef union {
-	int 			i;
-	float			f;
-	long long int	li;
-	double			d;
-	char			c;
-	char			*s;
-}__attribute__((aligned(8))) virg_var;
-
 /**
  * @brief Opcode, including arguments
  *
@@ -372,6 +667,11 @@ typedef struct {
 	virg_result_node	*head_result;
 	/// pointer to the tail node of the result tablet list
 	virg_result_node	*tail_result;
+	/// columns of the table used by the opcode program, see virg_vm_columns()
+	unsigned		columns;
+	/// number of tablets that the zone maps showed to have no result rows and
+	/// were skipped, see virg_vm_skip()
+	unsigned		tablets_skipped;
 	/// used to return timing data
 	float			timing1, timing2, timing3;
 } virg_vm;
@@ -430,9 +730,14 @@ typedef struct {
  * This structure is used to manage the database file that is currently open in
  * the database. It is the head of the database file, is loaded into memory when
  * the database is opened, and is accessed in memory until the database is
- * closed, when it is written to the start of the table. This has a fixed size,
+ * closed, when it is written to the start of the file. This has a fixed size,
  * but the list of tablets in the database managed with virg_tablet_info structs
- * necessarily has a variable size, and is stored just after this on disk.
+ * necessarily has a variable size. After the VIRG_DB_HEADER bytes holding this
+ * struct, the file is a chain of extents, each of VIRG_EXTENT_TABLETS disk
+ * slots preceded by VIRG_EXTENT_INFO bytes holding their virg_tablet_info
+ * structs, and an extent is added to the end of the file when the disk slots
+ * run out. The location of a disk slot, given by VIRG_DISK_OFFSET(), never
+ * changes, so adding tablets never moves those already written.
  *
  * Note that the fd (file descriptor) variable is meaningless when this data
  * is written to disk.
@@ -440,12 +745,13 @@ typedef struct {
 typedef struct {
 	/// number of tablets on disk
 	unsigned		num_tablets;
-	/// number of virg_tablet_info structs that have been allocated
+	/// number of virg_tablet_info structs that have been allocated, a multiple
+	/// of VIRG_EXTENT_TABLETS
 	unsigned		alloced_tablets;
-	/// used to assign unique ids to each data and result tablet
+	/// used to assign unique ids to each data tablet
 	unsigned		tablet_id_counter;
-	/// size of this struct plus all the virg_tablet_info structs
-	size_t			block_size;
+	/// size of every tablet of the database, in memory and on disk
+	size_t			tablet_size;
 	/// maps table id to name
 	char			tables[VIRG_MAX_TABLES][VIRG_MAX_TABLE_NAME];
 	/// maps table id to the id of its first tablet
@@ -458,6 +764,9 @@ typedef struct {
 	unsigned		table_tablets[VIRG_MAX_TABLES];
 	/// note which table slots have been used
 	int				table_status[VIRG_MAX_TABLES];
+	/// column set of the fixed-size columns of each table that are given Bloom
+	/// filters along with the key, see virg_table_bloom()
+	unsigned		bloom_columns[VIRG_MAX_TABLES];
 	/// pointer to the block allocated to store virg_tablet_info structs
 	virg_tablet_info	*tablet_info;
 } virg_db;
@@ -470,25 +779,176 @@ typedef struct {
  * functions. This holds the tablet slot allocations, virg_db struct, and
  * virtual machine execution options.
  */
-typedef struct {
+typedef struct virginian_ {
 	/// database file state
 	virg_db			db;
 	/// id of the tablet in each slot, valid only if status is above 0
-	unsigned		tablet_slot_ids		[VIRG_MEM_TABLETS];
-	/// use status of the tablet slot, 0 for unused, 1 for used, >1 for each lock
-	int				tablet_slot_status	[VIRG_MEM_TABLETS];
+	unsigned		tablet_slot_ids		[VIRG_TABLET_SLOTS];
+	/// use status of the tablet slot, 0 for unused, 1 for used, >1 for each
+	/// lock, VIRG_SLOT_CLAIMED while a tablet is being moved in or out of it
+	/// locks are added and released with atomic operations on this value
+	int				tablet_slot_status	[VIRG_TABLET_SLOTS];
 	/// number of tablet slots which are unused
 	unsigned		tablet_slots_taken;
-	/// round-robin counter to kick out tablets
+	/// round-robin counter or clock hand used to kick out tablets
 	unsigned		tablet_slot_counter;
-	/// pointer to each main-memory tablet slot
-	virg_tablet_meta	*tablet_slots		[VIRG_MEM_TABLETS];
-	/// pointer to the beginning of the allocated gpu tablet slots
+	/// replacement policy used to pick the tablet slot to evict
+	virg_policy		slot_policy;
+	/// set for each slot whose tablet has changed since it was read from disk,
+	/// clean tablets are evicted without being written
+	int				tablet_slot_dirty	[VIRG_TABLET_SLOTS];
+	/// reference bit of each slot, set when its tablet is loaded from memory
+	int				tablet_slot_ref		[VIRG_TABLET_SLOTS];
+	/// 2Q queue of each slot, 0 for the probationary queue and 1 for the main
+	int				tablet_slot_queue	[VIRG_TABLET_SLOTS];
+	/// order in which tablets entered their slots, used for FIFO eviction
+	unsigned		tablet_slot_age		[VIRG_TABLET_SLOTS];
+	/// counter used to assign tablet_slot_age values
+	unsigned		tablet_age_counter;
+	/// ring of tablets recently evicted from the 2Q probationary queue
+	unsigned		ghost_ids			[VIRG_2Q_GHOSTS];
+	/// next position to be overwritten in the ring of ghost ids
+	unsigned		ghost_head;
+	/// maps ids in the ghost ring to their position
+	virg_index		ghost_index;
+	/// number of tablet loads that found the tablet already in memory
+	unsigned long long	tablet_hits;
+	/// number of tablet loads that had to read the tablet from disk
+	unsigned long long	tablet_misses;
+	/// number of changed tablets written to the database file, see
+	/// virg_db_peek()
+	unsigned long long	disk_writes;
+	/// threads waiting for the tablet being read into each slot, each of which
+	/// is given a lock when the read completes
+	unsigned		tablet_slot_waiters	[VIRG_TABLET_SLOTS];
+	/// requests and memory ranges of the transfers of each slot's tablet, NULL
+	/// until the slot is first used, see virg_db_slotalloc()
+	virg_slot_io	*tablet_slot_io		[VIRG_TABLET_SLOTS];
+	/// requests of each slot's tablet read that haven't completed
+	int				tablet_slot_pending	[VIRG_TABLET_SLOTS];
+	/// set if any request of each slot's tablet read has failed
+	int				tablet_slot_failed	[VIRG_TABLET_SLOTS];
+	/// parts of each slot's tablet that are in memory, VIRG_ALL_COLUMNS unless
+	/// the tablet was loaded with virg_db_loadcols()
+	unsigned		tablet_slot_cols	[VIRG_TABLET_SLOTS];
+	/// pointer to the tablet in each main-memory tablet slot
+	virg_tablet_meta	*tablet_slots		[VIRG_TABLET_SLOTS];
+	/// memory allocated for each tablet slot, which tablet_slots points to
+	/// unless the tablet is accessed in place in the file mapping, NULL until
+	/// the slot is first used, see virg_db_slotalloc()
+	virg_tablet_meta	*tablet_slot_alloc	[VIRG_TABLET_SLOTS];
+	/// pointer to the beginning of the allocated gpu tablet slots, NULL until
+	/// they are first needed, see virg_vm_gpuinit()
 	void			*gpu_slots;
-	/// mutex for multi-core manipulation of the tablet slots
+	/// set once the cuda device has been set up by virg_vm_gpuinit()
+	int				gpu_ready;
+	/// kind of memory backing each tablet slot
+	virg_pages		tablet_slot_pages	[VIRG_TABLET_SLOTS];
+	/// size of the memory allocated for each tablet slot, see virg_db_slots()
+	size_t			slot_size;
+	/// number of tablet slots in use, the rest are empty and have no memory
+	unsigned		slot_count;
+	/// bytes of memory that the tablet slots may use, see virg_db_resize()
+	size_t			mem_budget;
+	/// number of result arena slots filled before result tablets are spilled,
+	/// up to VIRG_RESULT_TABLETS, see virg_db_resultslot()
+	unsigned		result_slots;
+	/// clock hand used to pick the result tablet to spill
+	unsigned		result_slot_counter;
+	/// used to assign ids to result tablets, see VIRG_RESULT_ID
+	unsigned		result_id_counter;
+	/// number of NUMA nodes that tablet slots and threads are spread across,
+	/// see virg_db_numa()
+	unsigned		numa_nodes;
+	/// kernel id of each NUMA node
+	unsigned		numa_node_ids		[VIRG_NUMA_NODES];
+	/// NUMA node of each CPU, VIRG_NUMA_NONE if it isn't online
+	unsigned char	numa_cpu_node		[VIRG_NUMA_CPUS];
+	/// maps the ids of tablets in memory to their tablet slot
+	virg_index		slot_index;
+	/// maps the ids of tablets in the open database file to their disk slot
+	virg_index		disk_index;
+	/// stack of the unused disk slots of the open database file, the next to
+	/// be given out by virg_db_place() on top, see virg_db_freeslots()
+	unsigned		*disk_free;
+	/// number of disk slots on the stack of unused disk slots
+	unsigned		disk_free_count;
+	/// mutex for changing which tablets are in the tablet slots, not needed
+	/// for locking a tablet that is already in memory
 	pthread_mutex_t		slot_lock;
+	/// signalled with slot_lock when a tablet has been read into its slot
+	pthread_cond_t		slot_cond;
+	/// held while tablets are linked onto the end of a table for inserts, see
+	/// virg_table_tail()
+	pthread_mutex_t		append_lock;
+	/// held by a thread while it inserts rows into a table through its append
+	/// lane, see virg_table_lanelock()
+	pthread_mutex_t		append_lane_lock	[VIRG_MAX_TABLES][VIRG_APPEND_LANES];
+	/// whether an appender holds the append lane of a table, see
+	/// virg_appender_init()
+	int			append_session		[VIRG_MAX_TABLES][VIRG_APPEND_LANES];
+	/// thread whose appender holds the append lane of a table
+	pthread_t	append_owner		[VIRG_MAX_TABLES][VIRG_APPEND_LANES];
+	/// tablet that each append lane inserts the rows of each table into, or
+	/// VIRG_INDEX_EMPTY, changed with append_lock
+	unsigned	append_tablet		[VIRG_MAX_TABLES][VIRG_APPEND_LANES];
+	/// number of threads that have been given append lanes
+	unsigned	append_lane_counter;
+	/// number of queries being executed, changed with slot_lock
+	unsigned	scans;
+	/// set with slot_lock while virg_db_compact() joins tablets together,
+	/// queries wait on slot_cond for it to be cleared before they start
+	int			joining;
+	/// tablets to read ahead of table scans, 0 to disable read-ahead
+	unsigned	readahead;
+	/// background thread reading tablets ahead of table scans
+	pthread_t	prefetch_thread;
+	/// whether the prefetch thread has been started
+	int			prefetch_running;
+	/// tells the prefetch thread to exit
+	int			prefetch_stop;
+	/// protects the read-ahead queue
+	pthread_mutex_t		prefetch_lock;
+	/// signalled when read-ahead is requested or the prefetch thread must stop
+	pthread_cond_t		prefetch_cond;
+	/// ring of tablets whose successors are to be read ahead
+	unsigned	prefetch_queue		[VIRG_PREFETCH_QUEUE];
+	/// columns to read of the tablets read ahead for each queued request
+	unsigned	prefetch_cols		[VIRG_PREFETCH_QUEUE];
+	/// NUMA node of the thread that made each queued request
+	unsigned	prefetch_nodes		[VIRG_PREFETCH_QUEUE];
+	/// NUMA node of the thread whose request the prefetch thread is handling,
+	/// see virg_db_localnode()
+	unsigned	prefetch_node;
+	/// next tablet id, or VIRG_INDEX_EMPTY for the last tablet, of tablets
+	/// that the prefetch thread has started reading
+	virg_index	prefetch_next;
+	/// next free position in the read-ahead queue
+	unsigned	prefetch_head;
+	/// next request in the read-ahead queue to be handled
+	unsigned	prefetch_tail;
+	/// asynchronous I/O engine used to read and write tablets
+	virg_io		io;
 	/// file descriptor for the open database
 	int			dbfd;
+	/// file descriptor of the Bloom filter file of the open database, see
+	/// virg_db_bloom()
+	int			bloomfd;
+	/// file descriptor of the file that result tablets are spilled to, which
+	/// is removed as soon as it is opened, see virg_db_spillopen()
+	int			spillfd;
+	/// maps the ids of spilled result tablets to their place in the spill file
+	virg_index	spill_index;
+	/// stack of unused places in the spill file
+	unsigned	*spill_free;
+	/// number of places on the stack of unused places in the spill file
+	unsigned	spill_free_count;
+	/// number of tablets that the spill file has room for
+	unsigned	spill_slots;
+	/// shared mapping of the open database file, NULL if not mapped
+	char		*dbmap;
+	/// size of the database file as far as the mapping is concerned
+	size_t		dbmap_filesize;
 	/// threads per block for gpu execution
 	unsigned	threads_per_block;
 	/// number of threads to use for multi-core cpu execution
@@ -501,6 +961,15 @@ typedef struct {
 	int			use_stream;
 	/// enables mapped execution, only used if stream is false
 	int			use_mmap;
+	/// enables zero-copy access to tablets through a mapping of the db file
+	int			use_filemap;
+	/// backs tablet slots with huge pages where possible
+	int			use_hugepages;
+	/// places tablet slots on NUMA nodes and pins cpu threads to them
+	int			use_numa;
+	/// size of the tablets of databases made with virg_db_create(), a power of
+	/// two from VIRG_TABLET_MIN_SIZE to VIRG_TABLET_MAX_SIZE
+	size_t		tablet_size;
 } virginian;
 
 /**
@@ -519,6 +988,8 @@ typedef struct {
 	unsigned		num_rows;
 	unsigned		num_tablets;
 	unsigned		tablets_proced;
+	int				tablets_done;
+	int				failed;
 	pthread_mutex_t		tab_lock;
 	pthread_mutex_t		res_lock;
 } virg_vm_arg;
@@ -540,6 +1011,54 @@ typedef struct {
 	char			buffer	[VIRG_ROW_BUFFER];
 } virg_reader;
 
+/**
+ * @brief State of an append session
+ *
+ * An appender adds rows to the end of a table through the append lane of the
+ * thread that opened it, keeping the tablet it fills locked and pointers to
+ * where the next row's values go, so that appending a row is only a copy of
+ * its values. See virg_appender_init().
+ */
+typedef struct {
+	/// table that rows are appended to
+	unsigned		table_id;
+	/// append lane held by the appender, see virg_table_lane()
+	unsigned		lane;
+	/// locked tablet that rows are appended to
+	virg_tablet_meta	*tab;
+	/// rows in the tablet, including those not yet published to queries
+	unsigned		rows;
+	/// rows the tablet has room for
+	unsigned		possible_rows;
+	/// number of fixed-size columns
+	unsigned		columns;
+	/// where the key of the next row goes
+	char			*key;
+	/// stride of the key column
+	size_t			key_stride;
+	/// where the value of each fixed-size column of the next row goes
+	char			*fixed		[VIRG_MAX_COLUMNS];
+	/// stride of each fixed-size column
+	size_t			fixed_stride	[VIRG_MAX_COLUMNS];
+} virg_appender;
+
+/**
+ * @brief What was loaded by a table warm-up
+ *
+ * Filled in by virg_table_warm() so that the caller can tell how much of the
+ * tables is in memory and how fast it got there.
+ */
+typedef struct {
+	/// number of tablets in memory when the warm-up returned
+	unsigned		tablets;
+	/// size of those tablets in bytes
+	size_t			bytes;
+	/// time taken by the warm-up in seconds
+	double			seconds;
+	/// bytes per second loaded by the warm-up
+	double			throughput;
+} virg_warm_stats;
+
 /**
  * @brief Array of data structure sizes used for testing
  *
@@ -568,22 +1087,66 @@ static const size_t virg_testsizes[15] = {
 	sizeof(virginian)
 };
 
-int virg_db_alloc(virginian *v, virg_tablet_meta **meta, int id);
+int virg_db_alloc(virginian *v, virg_tablet_meta **meta, unsigned id);
+int virg_db_bloom(virginian *v, unsigned slot);
+int virg_db_bloomopen(virginian *v, const char *file, int flags);
+int virg_db_spillopen(virginian *v, const char *file);
+int virg_db_bloomtest(virginian *v, unsigned tablet_id, unsigned disk_slot,
+	unsigned filter, virg_t type, virg_var *val);
 int virg_db_open(virginian *v, const char *file);
 int virg_db_create(virginian *v, const char *file);
 int virg_db_close(virginian *v);
 int virg_db_clear(virginian *v, unsigned slot);
 int virg_db_write(virginian *v, unsigned slot);
 int virg_db_load(virginian *v, unsigned tablet_id, virg_tablet_meta **tab);
+int virg_db_loadcols(virginian *v, unsigned tablet_id, unsigned cols,
+	virg_tablet_meta **tab);
 int virg_db_loadnext(virginian *v, virg_tablet_meta **tab);
+int virg_db_loadnextcols(virginian *v, virg_tablet_meta **tab, unsigned cols);
 int virg_db_findslot(virginian *v, unsigned *slot_);
+int virg_db_victim(virginian *v, unsigned *slot_);
+int virg_db_resultslot(virginian *v, unsigned *slot_);
+int virg_db_spill(virginian *v, unsigned slot);
+void virg_db_admit(virginian *v, unsigned slot);
+int virg_db_map(virginian *v);
+int virg_db_unmap(virginian *v);
+int virg_db_read(virginian *v, unsigned tablet_id, unsigned slot,
+	unsigned waiters, unsigned cols, virg_tablet_meta *meta);
+int virg_db_readahead(virginian *v, unsigned tablet_id, unsigned cols,
+	virg_tablet_meta *meta);
+int virg_db_peek(virginian *v, unsigned tablet_id, virg_tablet_meta *meta,
+	unsigned *disk_slot);
+int virg_db_place(virginian *v, unsigned slot);
+int virg_db_freeslots(virginian *v);
+int virg_db_compact(virginian *v);
+int virg_db_slots(virginian *v, size_t size);
+int virg_db_slotalloc(virginian *v, unsigned slot);
+int virg_db_slotfree(virginian *v, unsigned slot);
+int virg_db_resize(virginian *v, size_t budget);
+int virg_db_numa(virginian *v);
+unsigned virg_db_localnode(virginian *v);
+int virg_db_flush(virginian *v);
+int virg_db_prefetch(virginian *v, unsigned tablet_id, unsigned cols);
+int virg_db_prefetch_start(virginian *v);
+int virg_db_prefetch_stop(virginian *v);
 
 int virg_table_addcolumn(virginian *v,
 	unsigned table_id, const char *name, virg_t type);
+int virg_table_append_batch(virginian *v, unsigned table_id, const char *keys,
+	const char **columns, unsigned rows);
+int virg_table_bloom(virginian *v, unsigned table_id, unsigned column);
 int virg_table_create(virginian *v, const char *name, virg_t key_type);
 int virg_table_insert(virginian *v, unsigned table_id, char *key,
 	char *data, char *blob);
+unsigned virg_table_lane(virginian *v);
+int virg_table_lanelock(virginian *v, unsigned table_id, unsigned lane);
+int virg_table_load(virginian *v, unsigned table_id, const char *file,
+	virg_format format, unsigned threads, unsigned *rows);
 int virg_table_loadmem(virginian *v, unsigned table_id);
+int virg_table_tail(virginian *v, unsigned table_id, unsigned lane,
+	virg_tablet_meta **tab);
+int virg_table_warm(virginian *v, const unsigned *table_ids, unsigned tables,
+	size_t budget, virg_warm_stats *stats);
 int virg_table_getid(virginian *v, const char* name, unsigned *id);
 int virg_table_getcolumn(virginian *v, unsigned tid, const char* name,
 	unsigned *id);
@@ -592,24 +1155,38 @@ int virg_table_getcolumntype(virginian *v, unsigned tid, unsigned cid,
 int virg_table_getkeytype(virginian *v, unsigned tid, virg_t *type);
 int virg_table_numrows(virginian *v, unsigned id, unsigned *rows);
 
-int virg_tablet_addcolumn(virg_tablet_meta *tab, const char *name, virg_t type);
+int virg_tablet_addcolumn(virginian *v, virg_tablet_meta *tab, const char *name,
+	virg_t type);
 int virg_tablet_addrows(virginian *v, virg_tablet_meta *tab, unsigned rows);
 int virg_tablet_addmaxrows(virginian *v, virg_tablet_meta *tab);
 int virg_tablet_create(virginian *v, int *id, virg_t key_type,
 	unsigned table_id);
 int virg_tablet_check(virg_tablet_meta *t);
-int virg_tablet_growfixed(virg_tablet_meta *tab, size_t size);
+int virg_tablet_dirty(virginian *v, virg_tablet_meta *tab);
+int virg_tablet_iov(virg_tablet_meta *tab, unsigned cols, struct iovec *iov,
+	off_t *pos, size_t *len);
+int virg_tablet_growfixed(virginian *v, virg_tablet_meta *tab, size_t size);
 int virg_tablet_lock(virginian *v, unsigned tablet_id);
+int virg_tablet_pin(virginian *v, unsigned tablet_id, unsigned *slot_);
+int virg_tablet_presize(virginian *v, virg_tablet_meta *tab);
 int virg_tablet_unlock(virginian *v, unsigned tablet_id);
 int virg_tablet_addtail(virginian *v, virg_tablet_meta *head,
-	virg_tablet_meta **tail, unsigned possible_rows);
+	virg_tablet_meta **tail);
 int virg_tablet_remove(virginian *v, unsigned id);
+int virg_tablet_zones(virg_tablet_meta *tab, unsigned first);
 
 int virg_vm_addop(virg_vm *vm, int op, int p1, int p2, int p3, virg_var p4);
 int virg_vm_allocresult(virginian *v, virg_vm *vm,
 	virg_tablet_meta **meta, virg_tablet_meta *template_);
 int virg_vm_execute(virginian *v, virg_vm *vm);
+unsigned virg_vm_columns(virg_vm *vm);
 int virg_vm_freeresults(virginian *v, virg_vm *vm);
+int virg_vm_loadnext(virginian *v, virg_vm *vm, virg_tablet_meta **tab,
+	int *done);
+int virg_vm_skip(virginian *v, virg_vm *vm, virg_tablet_meta *tab,
+	unsigned disk_slot);
+int virg_vm_bindthread(virginian *v, pthread_attr_t *attr, unsigned thread);
+int virg_vm_gpuinit(virginian *v);
 virg_vm *virg_vm_init();
 void virg_vm_cleanup(virginian *v, virg_vm *vm);
 void virginia_single(virginian *v, virg_vm *vm, virg_tablet_meta *tab,
@@ -622,6 +1199,32 @@ int virg_vm_gpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab_,
 const size_t *virg_gpu_getsizes();
 const size_t *virg_cpu_getsizes();
 
+int virg_index_init(virg_index *idx, unsigned size);
+void virg_index_free(virg_index *idx);
+void virg_index_clear(virg_index *idx);
+int virg_index_find(virg_index *idx, unsigned key, unsigned *val);
+int virg_index_insert(virg_index *idx, unsigned key, unsigned val);
+int virg_index_remove(virg_index *idx, unsigned key);
+
+int virg_io_init(virg_io *io);
+int virg_io_free(virg_io *io);
+int virg_io_submit(virg_io *io, virg_io_req *req);
+void virg_io_complete(virg_io *io, virg_io_req *req);
+void virg_io_advance(virg_io_req *req, size_t bytes);
+int virg_io_drain(virg_io *io);
+void *virg_io_worker(void *arg);
+int virg_io_uring_init(virg_io *io);
+void virg_io_uring_push(virg_io *io, virg_io_req *req);
+void *virg_io_uring_reap(void *arg);
+void virg_io_uring_free(virg_io *io);
+
+int virg_appender_flush(virginian *v, virg_appender *a);
+int virg_appender_free(virginian *v, virg_appender *a);
+int virg_appender_init(virginian *v, virg_appender *a, unsigned table_id);
+int virg_appender_next(virginian *v, virg_appender *a);
+int virg_appender_row(virginian *v, virg_appender *a, const char *key,
+	const char *data);
+
 int virg_reader_init(virginian *v, virg_reader *r, virg_vm *vm);
 int virg_reader_free(virginian *v, virg_reader *r);
 int virg_reader_row(virginian *v, virg_reader *r);
@@ -637,6 +1240,7 @@ int virg_query(virginian *v, virg_reader **reader, const char *query);
 void virg_release(virginian *v, virg_reader *reader);
 
 size_t virg_sizeof(virg_t type);
+unsigned long long virg_bloom_hash(virg_t type, void *val);
 const char* virg_opstring(int op);
 void virg_print_tablet(virginian *v, virg_tablet_meta *m, const char* filename);
 void virg_print_tablet_meta(virg_tablet_meta *m);
@@ -23,13 +23,16 @@ int virg_vm_allocresult(virginian *v, virg_vm *vm, virg_tablet_meta **meta, virg
 {
 	virg_tablet_meta *tab;
 
-	// get a new tablet slot using new id
-	unsigned id = v->db.tablet_id_counter++;
-	virg_db_alloc(v, &tab, id);
+	// get a new tablet slot in the result arena using a new result id, which
+	// wraps around before it could be mistaken for VIRG_INDEX_EMPTY
+	unsigned id = VIRG_RESULT_ID |
+		(VIRG_ATOMIC_ADD(v->result_id_counter, 1) % (VIRG_RESULT_ID - 1));
+	VIRG_CHECK(virg_db_alloc(v, &tab, id) == VIRG_FAIL,
+		"Could not allocate result tablet")
 
 #ifdef VIRG_DEBUG
 	memset((char*)tab + sizeof(virg_tablet_meta), 0xDEADBEEF,
-		VIRG_TABLET_SIZE - sizeof(virg_tablet_meta));
+		v->db.tablet_size - sizeof(virg_tablet_meta));
 #endif
 
 	// if we don't have a result tablet to copy set attributes to defaults
@@ -58,10 +61,13 @@ int virg_vm_allocresult(virginian *v, virg_vm *vm, virg_tablet_meta **meta, virg
 		template_->last_tablet = 0;
 		tab->id = id;
 		template_->next = tab->id;
+		virg_tablet_dirty(v, template_);
 	}
 
 	tab->rows = 0;
 	tab->next = 0;
+	// result rows aren't added to the zone map
+	tab->zones = 0;
 
 	// allocate a new node for the linked list of results
 	virg_result_node *node = malloc(sizeof(virg_result_node));
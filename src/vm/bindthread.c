@@ -0,0 +1,46 @@
+#define _GNU_SOURCE // cpu_set_t, pthread_attr_setaffinity_np()
+#include "virginian.h"
+#include <sched.h>
+
+/**
+ * @ingroup vm
+ * @brief Pin a multi-core execution thread to the CPUs of a NUMA node
+ *
+ * Sets the CPU affinity of the thread attributes attr to the CPUs of one of the
+ * NUMA nodes found by virg_db_numa(), dealing the threads created by
+ * virg_vm_cpu() out to the nodes in turn so that each node has as many threads
+ * scanning the tablets in its memory. Nothing is done if there's only one node,
+ * virginian.use_numa is off, or the node has no CPUs online, in which case the
+ * thread may run anywhere.
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param attr		Attributes of the thread to be created
+ * @param thread	Number of the thread
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_vm_bindthread(virginian *v, pthread_attr_t *attr, unsigned thread)
+{
+	unsigned node, cpu, cpus = 0;
+	cpu_set_t set;
+
+	if(!v->use_numa || v->numa_nodes < 2)
+		return VIRG_SUCCESS;
+
+	node = thread % v->numa_nodes;
+
+	CPU_ZERO(&set);
+	for(cpu = 0; cpu < VIRG_NUMA_CPUS && cpu < CPU_SETSIZE; cpu++)
+		if(v->numa_cpu_node[cpu] == node) {
+			CPU_SET(cpu, &set);
+			cpus++;
+		}
+
+	if(cpus == 0)
+		return VIRG_SUCCESS;
+
+	VIRG_CHECK(pthread_attr_setaffinity_np(attr, sizeof(set), &set),
+		"Could not set thread affinity")
+
+	return VIRG_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#include "virginian.h"
+
+/**
+ * @ingroup vm
+ * @brief Find the columns used by a virtual machine's opcode program
+ *
+ * Builds the column set of the fixed-size columns read by the OP_Column ops of
+ * the stored statement, so that the tablets scanned by the query can be loaded
+ * with only those columns using virg_db_loadcols(). The key column is always
+ * loaded, so OP_Rowid needs nothing added to the set.
+ *
+ * @param vm Pointer to the context struct of the virtual machine
+ * @return The column set used by the statement
+ */
+unsigned virg_vm_columns(virg_vm *vm)
+{
+	unsigned cols = 0;
+
+	for(unsigned i = 0; i < vm->num_ops; i++)
+		if(vm->stmt[i].op == OP_Column)
+			cols |= 1u << vm->stmt[i].p2;
+
+	return cols;
+}
+
@@ -33,12 +33,25 @@ int virg_vm_execute(virginian *v, virg_vm *vm)
 		&&NOP, &&NOP, &&NOP, &&NOP, &&NOP, &&NOP, &&NOP, &&NOP, &&NOP, &&NOP,
 		&&NOP };
 
-	int p1, p2, p3;
+	int p1, p2, p3, r;
 	virg_tablet_meta *tab, *res;
 
 	vm->num_tables = 0;
 	vm->pc = 0;
 	vm->head_result = NULL;
+	vm->columns = virg_vm_columns(vm);
+	vm->tablets_skipped = 0;
+
+	// the gpu is only set up when a query first runs on it
+	if(v->use_gpu)
+		VIRG_CHECK(virg_vm_gpuinit(v) == VIRG_FAIL, "Could not set up the GPU")
+
+	// keep virg_db_compact() from joining tablets during the scan
+	pthread_mutex_lock(&v->slot_lock);
+	while(v->joining)
+		pthread_cond_wait(&v->slot_cond, &v->slot_lock);
+	v->scans++;
+	pthread_mutex_unlock(&v->slot_lock);
 
 	// get a new result tablet
 	virg_vm_allocresult(v, vm, &res, NULL);
@@ -64,13 +77,15 @@ op_Table:
 	assert(vm->num_tables < VIRG_VM_TABLES);
 	// load the table into the first available table slot
 	vm->table[vm->num_tables++] = p1;
-	// get a lock on the first tablet of the loaded table
-	virg_db_load(v, v->db.first_tablet[p1], &tab);
+	// get a lock on the first tablet of the loaded table, with only the
+	// columns that the statement uses
+	virg_db_loadcols(v, v->db.first_tablet[p1], vm->columns, &tab);
 	vm->pc++;
 	goto next;
 
 op_ResultColumn: // type
-	virg_tablet_addcolumn(res, vm->stmt[vm->pc].p4.s, (virg_t)p1);
+	virg_tablet_addcolumn(v, res, vm->stmt[vm->pc].p4.s, (virg_t)p1);
+	virg_tablet_dirty(v, res);
 	vm->pc++;
 	goto next;
 
@@ -82,10 +97,15 @@ op_Parallel:
 	vm->pc++;
 	// choose the execution location based on the properties of the virginian
 	// state struct
+#ifndef VIRG_NOCUDA
 	if(v->use_gpu)
-		virg_vm_gpu(v, vm, &tab, &res, 0);
+		r = virg_vm_gpu(v, vm, &tab, &res, 0);
 	else
-		virg_vm_cpu(v, vm, &tab, &res, 0);
+#endif
+		r = virg_vm_cpu(v, vm, &tab, &res, 0);
+	// a tablet that can't be loaded would leave the results short
+	if(r == VIRG_FAIL)
+		goto failed;
 	vm->pc = p3;
 	goto next;
 
@@ -93,11 +113,26 @@ op_Finish:
 	// unlock our hold on the current data and result tablets
 	virg_tablet_unlock(v, tab->id);
 	virg_tablet_unlock(v, res->id);
+	pthread_mutex_lock(&v->slot_lock);
+	v->scans--;
+	pthread_mutex_unlock(&v->slot_lock);
 	return VIRG_SUCCESS;
 
+// execution problem, the results are incomplete
+failed:
+	virg_tablet_unlock(v, tab->id);
+	virg_tablet_unlock(v, res->id);
+	pthread_mutex_lock(&v->slot_lock);
+	v->scans--;
+	pthread_mutex_unlock(&v->slot_lock);
+	VIRG_CHECK(1, "Could not execute the data parallel section")
+
 // opcode problem that resulted in a weird pc
 NOP:
 	fprintf(stderr, "Invalid OP\n");
+	pthread_mutex_lock(&v->slot_lock);
+	v->scans--;
+	pthread_mutex_unlock(&v->slot_lock);
 	return VIRG_FAIL;
 }
 
@@ -0,0 +1,52 @@
+#include "virginian.h"
+
+/**
+ * @ingroup vm
+ * @brief Set up the CUDA device and GPU tablet slots the first time they are
+ * needed
+ *
+ * Creating the CUDA context and allocating GPU memory takes far longer than
+ * the rest of virg_init(), so it is put off until the GPU is first used, by
+ * virg_vm_execute() with virginian.use_gpu set, or by virg_db_slotalloc() when
+ * tablet slots are pinned. The device flags that allow mapped memory are set
+ * before anything else creates the context, which is only done once, while the
+ * GPU tablet slots are allocated again after virg_db_slots() has freed them
+ * for a new tablet size. If Virginian is compiled with VIRG_NOCUDA, this always
+ * fails.
+ *
+ * @param v Pointer to the state struct of the database system
+ * @return VIRG_SUCCESS or VIRG_FAIL depending on errors during the function
+ * call
+ */
+int virg_vm_gpuinit(virginian *v)
+{
+#ifdef VIRG_NOCUDA
+	(void)v;
+	VIRG_CHECK(1, "Compiled without CUDA")
+#else
+	if(!v->gpu_ready) {
+		// set proper flags, first one enables mapped memory
+		cudaSetDeviceFlags(cudaDeviceMapHost | cudaDeviceScheduleSpin |
+			cudaDeviceScheduleBlockingSync);
+		VIRG_CUDCHK("set device flags");
+
+		// initialize cuda context
+		cudaSetDevice(VIRG_CUDADEVICE);
+		VIRG_CUDCHK("set device");
+
+		v->gpu_ready = 1;
+	}
+
+	if(v->gpu_slots == NULL && VIRG_GPU_TABLETS > 0 && v->slot_size > 0) {
+		// initialize gpu tablets as a single block
+		cudaError_t r = cudaMalloc((void**)&v->gpu_slots,
+			v->slot_size * VIRG_GPU_TABLETS);
+		VIRG_CHECK(r != cudaSuccess, "Problem allocating GPU tablet memory");
+#ifdef VIRG_DEBUG
+		cudaMemset(v->gpu_slots, 0xDEADBEEF, v->slot_size * VIRG_GPU_TABLETS);
+#endif
+	}
+
+	return VIRG_SUCCESS;
+#endif
+}
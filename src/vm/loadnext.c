@@ -0,0 +1,57 @@
+#include "virginian.h"
+
+/**
+ * @ingroup vm
+ * @brief Advance a data tablet pointer to the next tablet that may have result
+ * rows
+ *
+ * Works like virg_db_loadnextcols() with the columns that the opcode program
+ * uses, but first looks at the meta information of the following tablets that
+ * are only on disk with virg_db_peek(). Those that virg_vm_skip() finds to have
+ * no result rows, using their zone maps and Bloom filters, are counted in
+ * virg_vm.tablets_skipped and passed over without being loaded. Tablets that
+ * are already in memory are always loaded, and are left for the caller to check
+ * with virg_vm_skip(). As with virg_db_loadnextcols(), the current tablet must
+ * not be the last one in its string. If all of the remaining tablets are
+ * skipped, done is set and the tablet pointer is left unchanged, which ends
+ * the scan like reaching the last tablet does.
+ *
+ * @param v		Pointer to the state struct of the database system
+ * @param vm	Pointer to the context struct of the virtual machine
+ * @param tab	Pointer to a tablet pointer to be pointed to the next tablet
+ * @param done	Set to 1 if all of the remaining tablets were skipped, left
+ * unchanged otherwise
+ * @return VIRG_SUCCESS, or VIRG_FAIL if the next tablet couldn't be loaded, in
+ * which case the tablet pointer is left unchanged
+ */
+int virg_vm_loadnext(virginian *v, virg_vm *vm, virg_tablet_meta **tab,
+	int *done)
+{
+	virg_tablet_meta meta;
+	virg_tablet_meta *t;
+	unsigned id = tab[0]->next;
+	unsigned disk_slot;
+
+	while(virg_db_peek(v, id, &meta, &disk_slot) == VIRG_SUCCESS &&
+		virg_vm_skip(v, vm, &meta, disk_slot)) {
+		vm->tablets_skipped++;
+		if(meta.last_tablet) {
+			done[0] = 1;
+			return VIRG_SUCCESS;
+		}
+		id = meta.next;
+	}
+
+	// load the next tablet while the current one is still locked
+	VIRG_CHECK(virg_db_loadcols(v, id, vm->columns, &t) == VIRG_FAIL,
+		"Could not load tablet")
+
+	virg_tablet_unlock(v, tab[0]->id);
+	tab[0] = t;
+
+	// have the tablets after it read while this one is processed
+	if(t->in_table && !t->last_tablet)
+		virg_db_prefetch(v, t->id, vm->columns);
+
+	return VIRG_SUCCESS;
+}
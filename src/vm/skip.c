@@ -0,0 +1,305 @@
+#include "virginian.h"
+
+/// largest number of opcodes followed when looking for a result row
+#define SKIP_STEPS 1024
+
+/// registers outside of the register file can't be followed
+#define SKIP_REG(x) if((x) < 0 || (x) >= VIRG_REGS) return 1;
+
+/**
+ * Range of values that a register can hold for the rows of a tablet, if known,
+ * and the Bloom filter of the column it was loaded from, or -1
+ */
+typedef struct {
+	virg_t		type;
+	int			known;
+	virg_var	min;
+	virg_var	max;
+	int			filter;
+} skip_range;
+
+/**
+ * What is known about the tablet being considered
+ */
+typedef struct {
+	virginian			*v;
+	virg_vm				*vm;
+	virg_tablet_meta	*tab;
+	unsigned			disk_slot;
+	unsigned			steps;
+} skip_ctx;
+
+/**
+ * Compare two values of the same type, returning a negative number, 0 or a
+ * positive number like strcmp()
+ */
+static int skip_cmp(virg_t type, virg_var *a, virg_var *b)
+{
+	switch(type) {
+		case VIRG_INT:		return (a->i > b->i) - (a->i < b->i);
+		case VIRG_INT64:	return (a->li > b->li) - (a->li < b->li);
+		case VIRG_FLOAT:	return (a->f > b->f) - (a->f < b->f);
+		case VIRG_DOUBLE:	return (a->d > b->d) - (a->d < b->d);
+		case VIRG_CHAR:		return (a->c > b->c) - (a->c < b->c);
+		default:			return 0;
+	}
+}
+
+/**
+ * Find whether a comparison op can be true and whether it can be false for
+ * some row, given the ranges of its two registers
+ */
+static void skip_compare(int op, skip_range *a, skip_range *b, int *can_true,
+	int *can_false)
+{
+	*can_true = 1;
+	*can_false = 1;
+
+	if(!a->known || !b->known || a->type != b->type)
+		return;
+
+	virg_t t = a->type;
+	if(t != VIRG_INT && t != VIRG_INT64 && t != VIRG_FLOAT &&
+		t != VIRG_DOUBLE && t != VIRG_CHAR)
+		return;
+
+	// compare the ends of the ranges
+	int lo_hi = skip_cmp(t, &a->min, &b->max);
+	int hi_lo = skip_cmp(t, &a->max, &b->min);
+	int single = skip_cmp(t, &a->min, &a->max) == 0 &&
+		skip_cmp(t, &b->min, &b->max) == 0 && skip_cmp(t, &a->min, &b->min) == 0;
+
+	switch(op) {
+		case OP_Lt:
+			*can_true = lo_hi < 0;
+			*can_false = hi_lo >= 0;
+			break;
+		case OP_Le:
+			*can_true = lo_hi <= 0;
+			*can_false = hi_lo > 0;
+			break;
+		case OP_Gt:
+			*can_true = hi_lo > 0;
+			*can_false = lo_hi <= 0;
+			break;
+		case OP_Ge:
+			*can_true = hi_lo >= 0;
+			*can_false = lo_hi < 0;
+			break;
+		case OP_Eq:
+			*can_true = lo_hi <= 0 && hi_lo >= 0;
+			*can_false = !single;
+			break;
+		case OP_Neq:
+			*can_true = !single;
+			*can_false = lo_hi <= 0 && hi_lo >= 0;
+			break;
+	}
+}
+
+/**
+ * Find whether an equality comparison between a column with a Bloom filter and
+ * a constant can't be true for any row, because the filter doesn't contain the
+ * constant
+ */
+static int skip_bloom(skip_ctx *ctx, skip_range *a, skip_range *b)
+{
+	if(ctx->disk_slot == VIRG_INDEX_EMPTY || a->type != b->type)
+		return 0;
+
+	// make the column the first register
+	if(a->filter < 0) {
+		skip_range *t = a;
+		a = b;
+		b = t;
+	}
+
+	if(a->filter < 0 || !b->known || skip_cmp(b->type, &b->min, &b->max) != 0)
+		return 0;
+
+	return virg_db_bloomtest(ctx->v, ctx->tab->id, ctx->disk_slot, a->filter,
+		b->type, &b->min) == VIRG_FAIL;
+}
+
+/**
+ * Follow the opcode program from pc for the rows of a tablet, taking both
+ * branches of a comparison when the zone map can't decide it, and return 1 if
+ * a row may reach OP_Result while still valid. Anything that isn't understood
+ * is assumed to lead to a result row.
+ */
+static int skip_walk(skip_ctx *ctx, int pc, int valid, skip_range *reg)
+{
+	virg_vm *vm = ctx->vm;
+	virg_tablet_meta *tab = ctx->tab;
+	skip_range r[VIRG_REGS];
+	int can_true, can_false;
+
+	while(valid) {
+		if(pc < 0 || (unsigned)pc >= vm->num_ops || ++ctx->steps > SKIP_STEPS)
+			return 1;
+
+		virg_op *op = &vm->stmt[pc];
+
+		switch(op->op) {
+			case OP_Column:
+				SKIP_REG(op->p1)
+				if(op->p2 < 0 || (unsigned)op->p2 >= tab->fixed_columns)
+					return 1;
+				reg[op->p1].type = tab->fixed_type[op->p2];
+				reg[op->p1].known = tab->zones;
+				reg[op->p1].min = tab->fixed_min[op->p2];
+				reg[op->p1].max = tab->fixed_max[op->p2];
+				reg[op->p1].filter = op->p2;
+				break;
+			case OP_Rowid:
+				SKIP_REG(op->p1)
+				reg[op->p1].type = tab->key_type;
+				reg[op->p1].known = tab->zones;
+				reg[op->p1].min = tab->key_min;
+				reg[op->p1].max = tab->key_max;
+				reg[op->p1].filter = VIRG_BLOOM_KEY;
+				break;
+			case OP_Integer:
+				SKIP_REG(op->p1)
+				reg[op->p1].type = VIRG_INT;
+				reg[op->p1].known = 1;
+				reg[op->p1].min.i = op->p2;
+				reg[op->p1].max.i = op->p2;
+				reg[op->p1].filter = -1;
+				break;
+			case OP_Float:
+				SKIP_REG(op->p1)
+				reg[op->p1].type = VIRG_FLOAT;
+				reg[op->p1].known = 1;
+				reg[op->p1].min.f = op->p4.f;
+				reg[op->p1].max.f = op->p4.f;
+				reg[op->p1].filter = -1;
+				break;
+			case OP_Cast:
+				SKIP_REG(op->p2)
+				reg[op->p2].type = (virg_t)op->p1;
+				reg[op->p2].known = 0;
+				reg[op->p2].filter = -1;
+				break;
+			case OP_Add:
+			case OP_Sub:
+			case OP_Mul:
+			case OP_Div:
+				SKIP_REG(op->p1)
+				SKIP_REG(op->p2)
+				reg[op->p1].type = reg[op->p2].type;
+				reg[op->p1].known = 0;
+				reg[op->p1].filter = -1;
+				break;
+			case OP_Invalid:
+				valid = 0;
+				break;
+			case OP_Nop:
+				break;
+			case OP_Result:
+				return 1;
+			case OP_Le:
+			case OP_Lt:
+			case OP_Ge:
+			case OP_Gt:
+			case OP_Eq:
+			case OP_Neq:
+			case OP_And:
+			case OP_Or:
+			case OP_Not:
+				if(op->op == OP_And || op->op == OP_Or || op->op == OP_Not) {
+					can_true = 1;
+					can_false = 1;
+				}
+				else {
+					SKIP_REG(op->p1)
+					SKIP_REG(op->p2)
+					skip_compare(op->op, &reg[op->p1], &reg[op->p2],
+						&can_true, &can_false);
+
+					// a value missing from the column's Bloom filter is never
+					// equal to it
+					if(((op->op == OP_Eq && can_true) ||
+						(op->op == OP_Neq && can_false)) &&
+						skip_bloom(ctx, &reg[op->p1], &reg[op->p2])) {
+						if(op->op == OP_Eq)
+							can_true = 0;
+						else
+							can_false = 0;
+					}
+				}
+
+				// ops only jump forward, which bounds the recursion
+				if(op->p3 <= pc)
+					return 1;
+
+				// a row that jumps keeps its validity only if the op says so
+				if(can_true && !can_false) {
+					valid = op->p4.i;
+					pc = op->p3;
+					continue;
+				}
+				if(can_true && op->p4.i) {
+					memcpy(r, reg, sizeof(r));
+					if(skip_walk(ctx, op->p3, 1, r))
+						return 1;
+				}
+				break;
+			default:
+				return 1;
+		}
+
+		pc++;
+	}
+
+	return 0;
+}
+
+/**
+ * @ingroup vm
+ * @brief Find whether a tablet can be skipped by a query
+ *
+ * The data parallel section of an opcode program, from virg_vm.pc, is followed
+ * using the ranges of the columns in the tablet's zone map instead of their
+ * values, which is enough to decide comparisons between columns and constants,
+ * such as those that the SQL compiler generates for WHERE conditions. If no row
+ * of the tablet can reach OP_Result while valid, the tablet doesn't need to be
+ * processed at all. Tablets without a valid zone map are never skipped this way.
+ *
+ * If the tablet's disk slot is given, equality comparisons between a constant
+ * and the key or a column with a Bloom filter, see virg_table_bloom(), are also
+ * decided false when the filter shows that no row holds the constant. This works
+ * with or without a zone map and only reads a few bytes of the filters, so it
+ * is used to skip tablets before they are loaded, using their meta information
+ * from virg_db_peek().
+ *
+ * @param v			Pointer to the state struct of the database system
+ * @param vm		Pointer to the context struct of the virtual machine
+ * @param tab		Pointer to the tablet's meta information
+ * @param disk_slot	Disk slot of the tablet, or VIRG_INDEX_EMPTY to not use its
+ * Bloom filters
+ * @return 1 if the tablet has no result rows, 0 if it may have some
+ */
+int virg_vm_skip(virginian *v, virg_vm *vm, virg_tablet_meta *tab,
+	unsigned disk_slot)
+{
+	skip_range reg[VIRG_REGS];
+	skip_ctx ctx;
+
+	if(!tab->zones && (disk_slot == VIRG_INDEX_EMPTY || v->bloomfd == -1))
+		return 0;
+
+	ctx.v = v;
+	ctx.vm = vm;
+	ctx.tab = tab;
+	ctx.disk_slot = disk_slot;
+	ctx.steps = 0;
+
+	memset(reg, 0, sizeof(reg));
+	unsigned i;
+	for(i = 0; i < VIRG_REGS; i++)
+		reg[i].filter = -1;
+
+	return !skip_walk(&ctx, vm->pc, 1, reg);
+}
+
@@ -307,8 +307,8 @@ void *virginia_multi(void *arg_)
 		pthread_mutex_lock(&arg->tab_lock);
 		// if the current row position is at the end of the current tablet
 		if(arg->row >= arg->tab->rows) {
-			// if this is the last tablet
-			if(arg->tab->last_tablet) {
+			// if this is the last tablet, or the rest have been skipped
+			if(arg->tab->last_tablet || arg->tablets_done) {
 				// unlock data and result tablets and exit
 				pthread_mutex_unlock(&arg->tab_lock);
 				if(tab != NULL)
@@ -320,10 +320,30 @@ void *virginia_multi(void *arg_)
 			// if we haven't yet locked a tablet in this thread
 			if(tab != NULL)
 				virg_tablet_unlock(v, tab->id);
-			virg_db_loadnext(v, &arg->tab);
+			tab = NULL;
+
+			// skipping the rest of the tablets on disk leaves none to load,
+			// so come back round to exit, as every thread does if the next
+			// tablet can't be loaded
+			if(virg_vm_loadnext(v, vm, &arg->tab, &arg->tablets_done) ==
+				VIRG_FAIL) {
+				arg->failed = 1;
+				arg->tablets_done = 1;
+			}
+			if(arg->tablets_done) {
+				pthread_mutex_unlock(&arg->tab_lock);
+				continue;
+			}
 			virg_tablet_lock(v, arg->tab->id);
 			tab = arg->tab;
+
+			// a tablet whose zone map shows that it has no result rows is
+			// used up straight away
 			arg->row = 0;
+			if(virg_vm_skip(v, vm, tab, VIRG_INDEX_EMPTY)) {
+				arg->row = tab->rows;
+				vm->tablets_skipped++;
+			}
 		}
 
 		// if we are just starting and no tablet has yet been assigned
@@ -489,20 +509,24 @@ op_Result: // start reg, num regs
 
 	// if the result tablet is full
 	if(res->rows + simd_rows >= res->possible_rows) {
-		// if the local result tablet is the global result tablet
-		if(res == arg->res) {
-			// unlock current tablet and allocate another one
-			virg_tablet_unlock(v, res->id);
+		// if the local result tablet isn't the global result tablet, move to
+		// the current global result tablet
+		if(res != arg->res) {
 			virg_tablet_unlock(v, res->id);
-			virg_vm_allocresult(v, vm, &arg->res, arg->res);
 			virg_tablet_lock(v, arg->res->id);
+			res = arg->res;
 		}
-		else {
-			// otherwise move to the current global result tablet
+
+		// the global result tablet may have filled up too
+		if(res->rows + simd_rows >= res->possible_rows) {
+			// allocate another tablet, then unlock the current one, which
+			// must stay in memory while it is used as the template
+			virg_vm_allocresult(v, vm, &arg->res, arg->res);
+			virg_tablet_unlock(v, res->id);
 			virg_tablet_unlock(v, res->id);
 			virg_tablet_lock(v, arg->res->id);
+			res = arg->res;
 		}
-		res = arg->res;
 	}
 
 	// allocate area
@@ -516,9 +540,10 @@ op_Result: // start reg, num regs
 	// check if theres still room in the result tablet and allocate a new one if
 	// not
 	if(res->rows + simd_rows >= res->possible_rows - 300) {
-		virg_tablet_unlock(v, res->id);
-		virg_tablet_unlock(v, res->id);
+		virg_tablet_meta *temp = res;
 		virg_vm_allocresult(v, vm, &res, res);
+		virg_tablet_unlock(v, temp->id);
+		virg_tablet_unlock(v, temp->id);
 		res_[0] = res;
 		virg_tablet_lock(v, res->id);
 	}
@@ -572,6 +597,9 @@ op_Result: // start reg, num regs
 		memcpy(ptr1, ptr2, block_size * stride);
 	}
 
+	// the result rows must be written back if the tablet is evicted
+	virg_tablet_dirty(v, res);
+
 	for(i = 0; i < simd_rows; i++)
 		context.row_pc[i]++;
 	context.pc++;
@@ -15,9 +15,14 @@ const size_t *virg_cpu_getsizes()
  * based on the virginian.use_multi. If this value is false, we loop and call
  * virginia_single for every tablet to be processes. Otherwise, we create
  * virginian.multi_threads threads which greedily process as many data tablets
- * as they can and wait for them to finish before returning. If num_tablets is
- * 0, then there is no restriction on how many data tablets will be processed in
- * this function.
+ * as they can and wait for them to finish before returning. On machines with
+ * several NUMA nodes, these threads are pinned to the nodes in turn with
+ * virg_vm_bindthread(), so that the tablets each loads, or has read ahead for
+ * it, are placed in its local memory by virg_db_findslot(). If num_tablets is
+ * 0, then there is no restriction on how many data tablets will be processed
+ * in this function. Either way, tablets that virg_vm_skip() finds to have no
+ * result rows aren't processed, and those on disk aren't even loaded, see
+ * virg_vm_loadnext().
  *
  * @param v		Pointer to the state struct of the database system
  * @param vm	Pointer to the context struct of the virtual machine
@@ -31,18 +36,25 @@ const size_t *virg_cpu_getsizes()
 int virg_vm_cpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab, virg_tablet_meta **res, unsigned num_tablets)
 {
 	unsigned proced = 0;
+	int done = 0;
 
 	// if the virginian struct is set to execute using only a single core
 	if(!v->use_multi) {
 		// infinite loop
 		while(1) {
-			// add an extra lock to the current data and result tablets that
-			// will be released at a lower level within virginia_single()
-			virg_tablet_lock(v, tab[0]->id);
-			virg_tablet_lock(v, res[0]->id);
+			// skip tablets whose zone maps show that they have no result rows
+			if(virg_vm_skip(v, vm, tab[0], VIRG_INDEX_EMPTY))
+				vm->tablets_skipped++;
+			else {
+				// add an extra lock to the current data and result tablets
+				// that will be released at a lower level within
+				// virginia_single()
+				virg_tablet_lock(v, tab[0]->id);
+				virg_tablet_lock(v, res[0]->id);
 
-			// single core execution function
-			virginia_single(v, vm, tab[0], res, 0, tab[0]->rows);
+				// single core execution function
+				virginia_single(v, vm, tab[0], res, 0, tab[0]->rows);
+			}
 
 			// we've processed another tablet
 			proced++;
@@ -51,8 +63,11 @@ int virg_vm_cpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab, virg_tablet_m
 			if((num_tablets != 0 && proced >= num_tablets) || tab[0]->last_tablet)
 				break;
 
-			// load the next data tablet
-			virg_db_loadnext(v, tab);
+			// load the next data tablet that may have result rows, if any
+			VIRG_CHECK(virg_vm_loadnext(v, vm, tab, &done) == VIRG_FAIL,
+				"Could not load tablet")
+			if(done)
+				break;
 		}
 	}
 	else {
@@ -66,6 +81,12 @@ int virg_vm_cpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab, virg_tablet_m
 		arg.tab = tab[0];
 		arg.res = res[0];
 		arg.row = 0;
+		arg.tablets_done = 0;
+		arg.failed = 0;
+		if(virg_vm_skip(v, vm, tab[0], VIRG_INDEX_EMPTY)) {
+			arg.row = tab[0]->rows;
+			vm->tablets_skipped++;
+		}
 		arg.num_rows = 0;
 		arg.num_tablets = num_tablets;
 		arg.tablets_proced = 0;
@@ -74,10 +95,17 @@ int virg_vm_cpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab, virg_tablet_m
 		VIRG_CHECK(pthread_mutex_init(&arg.tab_lock, NULL), "Could not init mutex")
 		VIRG_CHECK(pthread_mutex_init(&arg.res_lock, NULL), "Could not init mutex")
 
-		// create tablet processing threads
+		// create tablet processing threads, pinned to the cpus of each numa
+		// node in turn, or anywhere if they can't run there
 		unsigned i;
-		for(i = 0; i < v->multi_threads; i++)
-			pthread_create(&thread[i], NULL, virginia_multi, (void*) &arg);
+		for(i = 0; i < v->multi_threads; i++) {
+			pthread_attr_t attr;
+			pthread_attr_init(&attr);
+			if(virg_vm_bindthread(v, &attr, i) == VIRG_FAIL ||
+				pthread_create(&thread[i], &attr, virginia_multi, (void*) &arg))
+				pthread_create(&thread[i], NULL, virginia_multi, (void*) &arg);
+			pthread_attr_destroy(&attr);
+		}
 
 		// wait for all threads to run out of data to process and finish
 		for(i = 0; i < v->multi_threads; i++)
@@ -88,6 +116,9 @@ int virg_vm_cpu(virginian *v, virg_vm *vm, virg_tablet_meta **tab, virg_tablet_m
 
 		VIRG_CHECK(pthread_mutex_destroy(&arg.res_lock), "Could not destroy mutex")
 		VIRG_CHECK(pthread_mutex_destroy(&arg.tab_lock), "Could not destroy mutex")
+
+		// a thread couldn't load the next tablet, so the results are short
+		VIRG_CHECK(arg.failed, "Could not load tablet")
 	}
 	
 	return VIRG_SUCCESS;
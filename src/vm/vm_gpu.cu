@@ -38,6 +38,9 @@ __constant__ virg_vm vm;
  */
 __constant__ virg_tablet_meta meta[VIRG_GPU_TABLETS];
 
+/// GPU constant memory copy of the tablet size of the open database
+__constant__ size_t tablet_size;
+
 /// total number of result rows output during mapped memory vm execution
 __device__ unsigned row_counter;
 
@@ -107,6 +110,7 @@ __global__ void virginia_gpu(unsigned tab_slot, unsigned res_slot, void* tab_,
 int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_meta **res, unsigned num_tablets)
 {
 	unsigned proced = 0;
+	int failed = 0;
 	//num_tablets = 5;
 
 	VIRG_CHECK(v->threads_per_block != VIRG_THREADSPERBLOCK,
@@ -114,6 +118,11 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 	VIRG_CHECK(v->threads_per_block == v->threads_per_block & 0xFFFFFFC0,
 		"Threads per block must be a multiple of 64");
 
+	// the kernel finds the end of the scratch tablet with the tablet size
+	cudaMemcpyToSymbol((char*)&tablet_size, (char*)&v->db.tablet_size,
+		sizeof(size_t), 0, cudaMemcpyHostToDevice);
+	VIRG_CUDCHK("tablet size const memcpy");
+
 	// execute GPU kernels in serial with no overlapping memory copies
 	if(v->use_stream == 0 && v->use_mmap == 0)
 	{
@@ -132,7 +141,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 		VIRG_CUDCHK("serial const memcpy 2");
 
 		void *tab_slot = v->gpu_slots;
-		void *res_slot = (char*)v->gpu_slots + VIRG_TABLET_SIZE;
+		void *res_slot = (char*)v->gpu_slots + v->db.tablet_size;
 
 		// create timers
 		cudaEvent_t start, data, kernel, results;
@@ -174,7 +183,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 
 #ifdef VIRG_DEBUG
 			cudaMemset((char*)res_slot + sizeof(virg_tablet_meta),
-				0xDEADBEEF, VIRG_TABLET_SIZE - sizeof(virg_tablet_meta));
+				0xDEADBEEF, v->db.tablet_size - sizeof(virg_tablet_meta));
 #endif
 
 			// record we're done with data transfer
@@ -184,7 +193,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 
 			// kernel launch
 			void* tab_arg = v->gpu_slots;
-			void* res_arg = (char*)v->gpu_slots + VIRG_TABLET_SIZE;
+			void* res_arg = (char*)v->gpu_slots + v->db.tablet_size;
 
 			virginia_gpu<<<blocks, v->threads_per_block>>>
 				(0, 1, tab_arg, res_arg, 0, 0, NULL);
@@ -197,7 +206,8 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 
 			// transfer result tablet back from GPU memory
 			cudaMemcpy((char*)res[0], res_slot,
-				VIRG_TABLET_SIZE, cudaMemcpyDeviceToHost);
+				v->db.tablet_size, cudaMemcpyDeviceToHost);
+			virg_tablet_dirty(v, res[0]);
 
 			//virg_print_tablet_meta(res[0]);
 
@@ -221,8 +231,11 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			if(tab[0]->last_tablet || (num_tablets != 0 && proced >= num_tablets))
 				break;
 
-			// load next data tablet
-			virg_db_loadnext(v, tab);
+			// load next data tablet, stopping if it can't be loaded
+			if(virg_db_loadnextcols(v, tab, vm_->columns) == VIRG_FAIL) {
+				failed = 1;
+				break;
+			}
 			// if this tablet has no rows, break from this loop
 			// this occurs when a new data tablet is created during an insert
 			// operation but no rows have been added to it yet
@@ -334,7 +347,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			// note that we don't exit here because we need to wait for the
 			// other streams to finish
 			if(!tab[0]->last_tablet && !(num_tablets != 0 && proced + 1 > num_tablets)) {
-				virg_db_load(v, tab[0]->next, &temp_tab);
+				virg_db_loadcols(v, tab[0]->next, vm_->columns, &temp_tab);
 				virg_vm_allocresult(v, vm_, &temp_res, res[0]);
 			}
 
@@ -342,7 +355,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			cudaEventRecord(ev_start[i], stream[i]);
 
 			// start tablet memcpy for this stream
-			cudaMemcpyAsync((char*)v->gpu_slots + (i * 2) * VIRG_TABLET_SIZE,
+			cudaMemcpyAsync((char*)v->gpu_slots + (i * 2) * v->db.tablet_size,
 				(char*)tab[0], tab[0]->size, cudaMemcpyHostToDevice, stream[i]);
 			//virg_print_tablet_meta(tab[0]);
 			VIRG_CUDCHK("tab memcpy");
@@ -365,7 +378,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 
 			// copy meta information to global memory as well so that the rows
 			// variable can be updated during query execution
-			cudaMemcpyAsync((char*)v->gpu_slots + (i * 2 + 1) * VIRG_TABLET_SIZE,
+			cudaMemcpyAsync((char*)v->gpu_slots + (i * 2 + 1) * v->db.tablet_size,
 				(char*)res[0], sizeof(virg_tablet_meta), cudaMemcpyHostToDevice, stream[i]);
 			VIRG_CUDCHK("res setup memcpy");
 
@@ -373,8 +386,8 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			cudaEventRecord(ev_data[i], stream[i]);
 
 			// launch the kernel for this stream
-			void *tab_arg = (char*)v->gpu_slots + (i * 2) * VIRG_TABLET_SIZE;
-			void *res_arg = (char*)v->gpu_slots + (i * 2 + 1) * VIRG_TABLET_SIZE;
+			void *tab_arg = (char*)v->gpu_slots + (i * 2) * v->db.tablet_size;
+			void *res_arg = (char*)v->gpu_slots + (i * 2 + 1) * v->db.tablet_size;
 			virginia_gpu<<<blocks, v->threads_per_block, 0, stream[i]>>>
 				(i * 2, i * 2 + 1, tab_arg, res_arg, 0, 0, NULL);
 			VIRG_CUDCHK("kernel");
@@ -383,9 +396,10 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			cudaEventRecord(ev_kernel[i], stream[i]);
 
 			// copy result tablet back for this stream
-			cudaMemcpyAsync((char*)res[0], (char*)v->gpu_slots + (i * 2 + 1) * VIRG_TABLET_SIZE,
-				VIRG_TABLET_SIZE, cudaMemcpyDeviceToHost, stream[i]);
+			cudaMemcpyAsync((char*)res[0], (char*)v->gpu_slots + (i * 2 + 1) * v->db.tablet_size,
+				v->db.tablet_size, cudaMemcpyDeviceToHost, stream[i]);
 			VIRG_CUDCHK("res memcpy");
+			virg_tablet_dirty(v, res[0]);
 
 			// record that we're done with the result transfer for this stream
 			cudaEventRecord(ev_results[i], stream[i]);
@@ -448,6 +462,10 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 #ifdef VIRG_NOPINNED
 		VIRG_CHECK(1, "cannot use mapped execution without pinned memory");
 #endif
+		// tablets accessed in place in the database file mapping are not in
+		// pinned memory and can't be mapped into the gpu address space
+		VIRG_CHECK(v->dbmap != NULL,
+			"cannot use mapped execution with a mapped database file");
 
 		// copy virtual machine context into gpu constant memory
 		cudaMemcpyToSymbol((char*)&vm, (char*)vm_,
@@ -500,7 +518,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 				sizeof(unsigned), 0, cudaMemcpyHostToDevice);
 			cudaMemcpyToSymbol((char*)&threadblock_order, (char*)&zero,
 				sizeof(unsigned), 0, cudaMemcpyHostToDevice);
-			cudaMemset((char*)v->gpu_slots + VIRG_TABLET_SIZE, 0,
+			cudaMemset((char*)v->gpu_slots + v->db.tablet_size, 0,
 				sizeof(unsigned) * blocks);
 			VIRG_CUDCHK("row_counter set");
 
@@ -528,6 +546,7 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			// copy the number of tablet result rows from gpu memory
 			cudaMemcpyFromSymbol((char*)&res[0]->rows, (char*)&row_counter,
 				sizeof(unsigned), 0, cudaMemcpyDeviceToHost);
+			virg_tablet_dirty(v, res[0]);
 
 			// record that we're done transferring results information
 			// this should also be negligible
@@ -552,8 +571,11 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 			if(tab[0]->last_tablet || (num_tablets != 0 && proced >= num_tablets))
 				break;
 
-			// load next data tablet
-			virg_db_loadnext(v, tab);
+			// load next data tablet, stopping if it can't be loaded
+			if(virg_db_loadnextcols(v, tab, vm_->columns) == VIRG_FAIL) {
+				failed = 1;
+				break;
+			}
 
 			// if this data tablet has no rows, finish
 			if(tab[0]->rows == 0)
@@ -574,6 +596,9 @@ int virg_vm_gpu(virginian *v, virg_vm *vm_, virg_tablet_meta **tab, virg_tablet_
 	// wait for all cuda operations to finish
 	cudaDeviceSynchronize();
 
+	// a data tablet couldn't be loaded, so the results are short
+	VIRG_CHECK(failed, "Could not load tablet")
+
 	return VIRG_SUCCESS;
 }
 
@@ -1000,7 +1025,7 @@ __device__ __forceinline__ void op_Result OPARGS
 			
 			if(num_rows > 0) {
 				unsigned *threadswritten = (unsigned*)((char*)scratch +
-					VIRG_TABLET_SIZE);
+					tablet_size);
 				unsigned result_blockid = block_start / VIRG_THREADSPERBLOCK;//blockDim.x;
 
 				unsigned blockbreak = ((block_start + num_rows - 1) &